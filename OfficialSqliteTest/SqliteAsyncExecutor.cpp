@@ -0,0 +1,161 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteAsyncExecutor.cpp $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#include "SqliteAsyncExecutor.h"
+#include "SqliteWrapper.h"
+
+#include <algorithm>
+
+namespace A3D
+{
+    SqliteAsyncExecutor::SqliteAsyncExecutor(SqliteWrapper& wrapper, SqliteAsyncQueryOptions const& options)
+        : m_wrapper(wrapper),
+        m_resume(options.resume),
+        m_isStopping(false)
+    {
+        size_t threadCount = std::max<size_t>(options.threadCount, 1);
+        for (size_t i = 0; i < threadCount; ++i)
+        {
+            m_threads.emplace_back(&SqliteAsyncExecutor::WorkerLoop, this);
+        }
+    }
+
+    SqliteAsyncExecutor::~SqliteAsyncExecutor()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_isStopping = true;
+        }
+        m_wake.notify_all();
+        for (std::thread& thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    void SqliteAsyncExecutor::Submit(const char* statementText, std::vector<SqliteValue> values, SqliteQueryCallback callback)
+    {
+        std::unique_ptr<Task> task(new Task());
+        task->statementText = statementText;
+        task->values = std::move(values);
+        task->callback = std::move(callback);
+        task->start = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_readyTasks.push_back(std::move(task));
+        }
+        m_wake.notify_one();
+    }
+
+    void SqliteAsyncExecutor::Resume(std::function<void()> continuation)
+    {
+        if (m_resume)
+            m_resume(std::move(continuation));
+        else
+            continuation();
+    }
+
+    void SqliteAsyncExecutor::WorkerLoop()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            // The queries whose delay has passed go before the new ones
+            std::unique_ptr<Task> task;
+            if (!m_waitingTasks.empty() && m_waitingTasks.begin()->first <= std::chrono::steady_clock::now())
+            {
+                task = std::move(m_waitingTasks.begin()->second);
+                m_waitingTasks.erase(m_waitingTasks.begin());
+            }
+            else if (!m_readyTasks.empty())
+            {
+                task = std::move(m_readyTasks.front());
+                m_readyTasks.pop_front();
+            }
+            else if (m_isStopping && m_waitingTasks.empty())
+            {
+                return;
+            }
+            else
+            {
+                if (m_waitingTasks.empty())
+                {
+                    m_wake.wait(lock);
+                }
+                else
+                {
+                    // A copy: another thread may run and erase the task while this one waits
+                    std::chrono::steady_clock::time_point due = m_waitingTasks.begin()->first;
+                    m_wake.wait_until(lock, due);
+                }
+                continue;
+            }
+
+            lock.unlock();
+            Run(std::move(task));
+            lock.lock();
+        }
+    }
+
+    void SqliteAsyncExecutor::Run(std::unique_ptr<Task> task)
+    {
+        // A single attempt: neither the busy handler nor the retries of the wrapper sleep on this thread
+        SqliteQueryResult result;
+        SqliteWrapper::SetNoWaitOnBusy(true);
+        SqliteStatement statement;
+        result.succeeded = m_wrapper.Prepare(task->statementText.c_str(), statement, result.retValue);
+        if (result.succeeded)
+        {
+            for (size_t i = 0; i < task->values.size(); ++i)
+            {
+                if (!statement.BindValue((int)i + 1, task->values[i]))
+                {
+                    result.succeeded = false;
+                    result.retValue = SQLITE_RANGE;
+                    break;
+                }
+            }
+        }
+        if (result.succeeded)
+        {
+            result.succeeded = statement.ForEachRow(result.retValue, [&result](SqliteRow const& row)
+            {
+                int columnCount = row.GetColumnCount();
+                result.results.resize((size_t)columnCount);
+                for (int column = 0; column < columnCount; ++column)
+                {
+                    std::string_view text = row.GetText(column);
+                    result.results[column].emplace_back(text.data(), text.size());
+                }
+                return true;
+            });
+        }
+        statement.Release();
+        SqliteWrapper::SetNoWaitOnBusy(false);
+
+        if (!result.succeeded && (result.retValue == SQLITE_BUSY || result.retValue == SQLITE_LOCKED))
+        {
+            unsigned int remainingMs = m_wrapper.GetRemainingTimeMs(task->start);
+            if (remainingMs > 0)
+            {
+                unsigned int delayMs = std::min(m_wrapper.m_retryPolicy.GetDelayMs(task->retries), remainingMs);
+                ++task->retries;
+                if (SqliteMetrics* metrics = m_wrapper.GetEnabledMetrics())
+                    metrics->RecordBusyRetries(1);
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_waitingTasks.emplace(std::chrono::steady_clock::now() + std::chrono::milliseconds(delayMs), std::move(task));
+                }
+                m_wake.notify_one();
+                return;
+            }
+        }
+        result.retries = task->retries;
+        task->callback(std::move(result));
+    }
+}
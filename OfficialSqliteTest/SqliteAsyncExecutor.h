@@ -0,0 +1,171 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteAsyncExecutor.h $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#pragma once
+#include "SqliteValue.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// The awaitables need C++20 coroutines, the rest of the executor builds as C++17
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <coroutine>
+#define A3D_SQLITE_COROUTINES
+#endif
+#endif
+
+namespace A3D
+{
+    class SqliteWrapper;
+
+    //--------------------------------------------------------------------------------------
+    // Outcome of an asynchronous query.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    struct SqliteQueryResult
+    {
+        bool succeeded = false;
+        int retValue = 0;                                            // Return code of the last attempt, SQLITE_DONE on success.
+        int retries = 0;                                             // Attempts that found the database locked.
+        std::vector<std::vector<std::string>> results;               // results[column][row], NULL being an empty string.
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Called on a thread of the executor with the result of a query. It must not wait for
+    // other queries of the same executor.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    typedef std::function<void(SqliteQueryResult&& result)> SqliteQueryCallback;
+
+    //--------------------------------------------------------------------------------------
+    // Called with the continuation of a coroutine whose query completed, to run it where
+    // the application wants, for instance by posting it to its own executor.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    typedef std::function<void(std::function<void()> continuation)> SqliteResumeScheduler;
+
+    //--------------------------------------------------------------------------------------
+    // Settings of SqliteWrapper::SetAsyncQueryOptions().
+    //+---------------+---------------+---------------+---------------+---------------+------
+    struct SqliteAsyncQueryOptions
+    {
+        size_t threadCount = 2;                                      // Threads running the queries, at least 1.
+        SqliteResumeScheduler resume;                                // Not set = coroutines resume on the thread that ran their query.
+    };
+
+    //--------------------------------------------------------------------------------------
+    // A few threads running the queries submitted by any thread, in submission order. A
+    // query finding the database locked never sleeps on its thread: it is put aside until
+    // the delay of the retry policy of the wrapper has passed, and the thread runs other
+    // queries meanwhile, until the timeout of the wrapper. Used through
+    // SqliteWrapper::QueryAsync() and, with C++20 coroutines, co_await SqliteWrapper::Query().
+    //+---------------+---------------+---------------+---------------+---------------+------
+    class SqliteAsyncExecutor
+    {
+    private:
+        struct Task
+        {
+            std::string statementText;
+            std::vector<SqliteValue> values;
+            SqliteQueryCallback callback;
+            std::chrono::steady_clock::time_point start;
+            int retries = 0;
+        };
+
+        SqliteWrapper& m_wrapper;
+        SqliteResumeScheduler m_resume;
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::deque<std::unique_ptr<Task>> m_readyTasks;
+        std::multimap<std::chrono::steady_clock::time_point, std::unique_ptr<Task>> m_waitingTasks; // Backing off, by time to run again.
+        bool m_isStopping;
+        std::vector<std::thread> m_threads;
+
+        void WorkerLoop();
+        void Run(std::unique_ptr<Task> task);
+
+    public:
+        SqliteAsyncExecutor(SqliteWrapper& wrapper, SqliteAsyncQueryOptions const& options);
+        SqliteAsyncExecutor(SqliteAsyncExecutor const&) = delete;
+        SqliteAsyncExecutor& operator=(SqliteAsyncExecutor const&) = delete;
+
+        //--------------------------------------------------------------------------------------
+        // @description Stop the threads once all the submitted queries are completed.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        ~SqliteAsyncExecutor();
+
+        //--------------------------------------------------------------------------------------
+        // @description Queue a query.
+        // @param       statementText   The request, with '?' parameters. Only its first statement is executed.
+        // @param       values          The parameters, the first one being bound to '?1'.
+        // @param       callback        Called on a thread of the executor with the result.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void Submit(const char* statementText, std::vector<SqliteValue> values, SqliteQueryCallback callback);
+
+        //--------------------------------------------------------------------------------------
+        // @description Run the continuation of a coroutine through the resume scheduler.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void Resume(std::function<void()> continuation);
+    };
+
+#ifdef A3D_SQLITE_COROUTINES
+    //--------------------------------------------------------------------------------------
+    // Awaitable returned by SqliteWrapper::Query(): co_await suspends the caller until the
+    // query is completed, and gives its result.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    class SqliteQueryAwaitable
+    {
+    private:
+        SqliteAsyncExecutor* m_executor;                             // Null if the result is already known.
+        std::string m_statementText;
+        std::vector<SqliteValue> m_values;
+        SqliteQueryResult m_result;
+
+    public:
+        SqliteQueryAwaitable(SqliteAsyncExecutor& executor, const char* statementText, std::vector<SqliteValue> values)
+            : m_executor(&executor),
+            m_statementText(statementText),
+            m_values(std::move(values))
+        {
+        }
+
+        // Completed with the result, the coroutine does not suspend
+        explicit SqliteQueryAwaitable(SqliteQueryResult result)
+            : m_executor(nullptr),
+            m_result(std::move(result))
+        {
+        }
+
+        bool await_ready() const noexcept
+        {
+            return m_executor == nullptr;
+        }
+
+        void await_suspend(std::coroutine_handle<> caller)
+        {
+            // The caller may be resumed, and this awaitable destroyed, before Submit() returns
+            m_executor->Submit(m_statementText.c_str(), std::move(m_values), [this, caller](SqliteQueryResult&& result)
+            {
+                m_result = std::move(result);
+                m_executor->Resume([caller]() { caller.resume(); });
+            });
+        }
+
+        SqliteQueryResult await_resume()
+        {
+            return std::move(m_result);
+        }
+    };
+#endif
+}
@@ -0,0 +1,175 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteBackup.cpp $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#include "SqliteBackup.h"
+#include "SqliteWrapper.h"
+
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+namespace A3D
+{
+    // First column of the first row of a pragma, as text
+    static std::string getPragma(sqlite3* database, const char* statementText)
+    {
+        std::string value;
+        sqlite3_a3d_stmt* statement = nullptr;
+        if (SQLITE_OK == sqlite3_a3d_prepare_v2(database, statementText, -1, &statement, nullptr)
+            && SQLITE_ROW == sqlite3_a3d_step(statement))
+        {
+            const char* text = reinterpret_cast<const char*>(sqlite3_a3d_column_text(statement, 0));
+            value = text ? text : "";
+        }
+        sqlite3_a3d_finalize(statement);
+        return value;
+    }
+
+    bool SqliteWrapper::Backup(const char* destinationPath, int& retValue, SqliteBackupOptions const& options, SqliteBackupCallback const& callback, SqliteBackupProgress* pProgress)
+    {
+        retValue = SQLITE_MISUSE;
+        if (!IsReady() || !destinationPath)
+            return false;
+
+        // A database in memory is only visible through the connection of the wrapper. Its own
+        // writes are then copied to the backup as they happen, without restarting it.
+        sqlite3* source = nullptr;
+        if (!m_databasePath.empty() && m_databasePath != ":memory:")
+        {
+            retValue = sqlite3_a3d_open_v2(m_databasePath.c_str(), &source, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX | (m_openFlags & SQLITE_OPEN_URI), nullptr);
+            if (retValue != SQLITE_OK)
+            {
+                std::cout << "Backup: could not open the source: " << sqlite3_a3d_errmsg(source) << std::endl;
+                sqlite3_a3d_close_v2(source);
+                return false;
+            }
+        }
+        sqlite3* destination = nullptr;
+        retValue = sqlite3_a3d_open_v2(destinationPath, &destination, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX, nullptr);
+        if (retValue != SQLITE_OK)
+        {
+            std::cout << "Backup: could not open " << destinationPath << ": " << sqlite3_a3d_errmsg(destination) << std::endl;
+            sqlite3_a3d_close_v2(destination);
+            sqlite3_a3d_close_v2(source);
+            return false;
+        }
+
+        bool isLocked = !source && LockConnection(false, nullptr, nullptr);
+        sqlite3* sourceDatabase = source ? source : m_database;
+        int pageSize = atoi(getPragma(sourceDatabase, "PRAGMA page_size").c_str());
+        // A read transaction left open on the source connection keeps its snapshot of the WAL from one step to the next
+        bool holdsSnapshot = source && options.keepSnapshot && getPragma(source, "PRAGMA journal_mode") == "wal"
+            && SQLITE_OK == sqlite3_a3d_exec(source, "BEGIN; SELECT count(*) FROM sqlite_master", nullptr, nullptr, nullptr);
+        sqlite3_a3d_backup* backup = sqlite3_a3d_backup_init(destination, "main", sourceDatabase, "main");
+        if (isLocked)
+        {
+            UnlockConnection(false);
+        }
+        if (!backup)
+        {
+            retValue = sqlite3_a3d_errcode(destination);
+            std::cout << "Backup: " << sqlite3_a3d_errmsg(destination) << std::endl;
+            sqlite3_a3d_close_v2(destination);
+            sqlite3_a3d_close_v2(source);
+            return false;
+        }
+
+        SqliteBackupProgress progress;
+        auto start = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point waitStart;
+        int waitRetries = -1;                                        // -1 = not waiting for a lock.
+        while (true)
+        {
+            int pagesPerStep = progress.restarts >= options.maxRestarts ? -1 : options.pagesPerStep;
+            isLocked = !source && LockConnection(false, nullptr, nullptr);
+            retValue = sqlite3_a3d_backup_step(backup, pagesPerStep);
+            int remainingPages = sqlite3_a3d_backup_remaining(backup);
+            int totalPages = sqlite3_a3d_backup_pagecount(backup);
+            if (isLocked)
+            {
+                UnlockConnection(false);
+            }
+
+            if (retValue == SQLITE_BUSY || retValue == SQLITE_LOCKED)
+            {
+                // A writer holds the source or the destination: wait for it within the timeout of the wrapper
+                if (waitRetries < 0)
+                {
+                    waitStart = std::chrono::steady_clock::now();
+                    waitRetries = 0;
+                }
+                unsigned int remainingMs = GetRemainingTimeMs(waitStart);
+                if (remainingMs == 0)
+                {
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(std::min(m_retryPolicy.GetDelayMs(waitRetries++), remainingMs)));
+                continue;
+            }
+            if (retValue != SQLITE_OK && retValue != SQLITE_DONE)
+            {
+                break;
+            }
+            waitRetries = -1;
+
+            // Started over from the first page if more pages remain than the step could leave. Only
+            // the writes of other connections restart it, and they cannot make the source grow meanwhile.
+            int previousPages = progress.steps == 0 ? progress.totalPages : progress.remainingPages;
+            int expectedPages = pagesPerStep < 0 ? 0 : std::max(0, previousPages - pagesPerStep);
+            bool restarted = source && progress.steps > 0 && remainingPages > expectedPages;
+            if (restarted)
+            {
+                ++progress.restarts;
+            }
+            progress.copiedPages += (uint64_t)std::max(0, (restarted || progress.steps == 0 ? totalPages : previousPages) - remainingPages);
+            progress.totalPages = totalPages;
+            progress.remainingPages = remainingPages;
+            ++progress.steps;
+            progress.elapsedMs = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+            double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            progress.bytesPerSecond = elapsedSeconds > 0 ? progress.copiedPages * (double)pageSize / elapsedSeconds : 0;
+            if (callback && !callback(progress))
+            {
+                retValue = SQLITE_INTERRUPT;
+                break;
+            }
+            if (retValue == SQLITE_DONE)
+            {
+                break;
+            }
+
+            // Between two steps, the source is not locked and writers can commit
+            if (options.pauseMs > 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(options.pauseMs));
+            else
+                std::this_thread::yield();
+        }
+
+        int finishValue = sqlite3_a3d_backup_finish(backup);
+        if (retValue == SQLITE_DONE)
+        {
+            retValue = finishValue;
+        }
+        if (retValue != SQLITE_OK)
+        {
+            std::cout << "Backup: " << destinationPath << " failed: " << sqlite3_a3d_errstr(retValue) << std::endl;
+        }
+        if (holdsSnapshot)
+        {
+            sqlite3_a3d_exec(source, "COMMIT", nullptr, nullptr, nullptr);
+        }
+        sqlite3_a3d_close_v2(destination);
+        sqlite3_a3d_close_v2(source);
+        if (pProgress)
+            *pProgress = progress;
+        return retValue == SQLITE_OK;
+    }
+}
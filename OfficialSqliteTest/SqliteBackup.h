@@ -0,0 +1,45 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteBackup.h $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#pragma once
+#include <stdint.h>
+#include <functional>
+
+namespace A3D
+{
+    //--------------------------------------------------------------------------------------
+    // Progress of SqliteWrapper::Backup(), reported after each step.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    struct SqliteBackupProgress
+    {
+        int totalPages = 0;                                          // Pages of the source database.
+        int remainingPages = 0;                                      // Pages still to copy.
+        uint64_t copiedPages = 0;                                    // Pages copied so far, those copied again after a restart included.
+        int steps = 0;
+        int restarts = 0;                                            // Times the copy started over because another connection wrote the source.
+        uint64_t elapsedMs = 0;
+        double bytesPerSecond = 0;                                   // Pages copied per second, times the page size.
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Called by SqliteWrapper::Backup() after each step. Returns false to cancel the backup.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    typedef std::function<bool(SqliteBackupProgress const& progress)> SqliteBackupCallback;
+
+    //--------------------------------------------------------------------------------------
+    // Settings of SqliteWrapper::Backup().
+    //+---------------+---------------+---------------+---------------+---------------+------
+    struct SqliteBackupOptions
+    {
+        int pagesPerStep = 256;                                      // Pages copied by each step, writers can commit between two steps. -1 = all at once.
+        unsigned int pauseMs = 0;                                    // Wait between two steps. 0 = only yield.
+        int maxRestarts = 8;                                         // After that many restarts, the rest is copied in a single step.
+        bool keepSnapshot = true;                                    // In WAL mode, copy the database as it was when the backup started: no restart, and writers
+                                                                     // are never blocked, but the WAL cannot be checkpointed past that point until the end.
+    };
+}
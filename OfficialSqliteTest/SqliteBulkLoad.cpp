@@ -0,0 +1,453 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteBulkLoad.cpp $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#include "SqliteBulkLoad.h"
+#include "SqliteWrapper.h"
+
+#include <stdint.h>
+#include <algorithm>
+#include <iostream>
+#include <queue>
+#include <utility>
+
+namespace A3D
+{
+    // Spilled values are stored as their type, then the integer, the double or the size and bytes
+    static bool WriteValue(FILE* file, SqliteValue const& value)
+    {
+        unsigned char type = (unsigned char)value.GetType();
+        if (fwrite(&type, 1, 1, file) != 1)
+            return false;
+        switch (type)
+        {
+        case SQLITE_INTEGER:
+        {
+            sqlite3_a3d_int64 integer = value.GetInt64();
+            return fwrite(&integer, sizeof(integer), 1, file) == 1;
+        }
+        case SQLITE_FLOAT:
+        {
+            double number = value.GetDouble();
+            return fwrite(&number, sizeof(number), 1, file) == 1;
+        }
+        case SQLITE_TEXT:
+        case SQLITE_BLOB:
+        {
+            uint32_t size = (uint32_t)value.GetBytes().size();
+            return fwrite(&size, sizeof(size), 1, file) == 1 && (size == 0 || fwrite(value.GetBytes().data(), size, 1, file) == 1);
+        }
+        default:
+            return true;
+        }
+    }
+
+    static bool ReadValue(FILE* file, int type, SqliteValue& value, std::string& buffer)
+    {
+        switch (type)
+        {
+        case SQLITE_INTEGER:
+        {
+            sqlite3_a3d_int64 integer;
+            if (fread(&integer, sizeof(integer), 1, file) != 1)
+                return false;
+            value.SetInt64(integer);
+            return true;
+        }
+        case SQLITE_FLOAT:
+        {
+            double number;
+            if (fread(&number, sizeof(number), 1, file) != 1)
+                return false;
+            value.SetDouble(number);
+            return true;
+        }
+        case SQLITE_TEXT:
+        case SQLITE_BLOB:
+        {
+            uint32_t size;
+            if (fread(&size, sizeof(size), 1, file) != 1)
+                return false;
+            buffer.resize(size);
+            if (size > 0 && fread(&buffer[0], size, 1, file) != 1)
+                return false;
+            if (type == SQLITE_TEXT)
+                value.SetText(buffer.data(), (int)size);
+            else
+                value.SetBlob(buffer.data(), (int)size);
+            return true;
+        }
+        case SQLITE_NULL:
+            value.SetNull();
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Return 1 if a row was read, 0 at the end of the run and -1 on error
+    static int ReadRow(FILE* file, std::vector<SqliteValue>& row, std::string& buffer)
+    {
+        for (size_t i = 0; i < row.size(); ++i)
+        {
+            unsigned char type;
+            if (fread(&type, 1, 1, file) != 1)
+                return i == 0 && feof(file) ? 0 : -1;
+            if (!ReadValue(file, type, row[i], buffer))
+                return -1;
+        }
+        return 1;
+    }
+
+    SqliteExternalSorter::SqliteExternalSorter(std::vector<size_t> const& keyColumns, size_t memoryBudget)
+        : m_keyColumns(keyColumns),
+        m_memoryBudget(memoryBudget),
+        m_memoryBytes(0),
+        m_columnCount(0)
+    {
+    }
+
+    SqliteExternalSorter::~SqliteExternalSorter()
+    {
+        CloseRuns();
+    }
+
+    int SqliteExternalSorter::CompareRows(std::vector<SqliteValue> const& left, std::vector<SqliteValue> const& right) const
+    {
+        for (size_t column : m_keyColumns)
+        {
+            int comparison = left[column].Compare(right[column]);
+            if (comparison != 0)
+                return comparison;
+        }
+        return 0;
+    }
+
+    bool SqliteExternalSorter::SpillRun()
+    {
+        std::sort(m_rows.begin(), m_rows.end(), [this](std::vector<SqliteValue> const& left, std::vector<SqliteValue> const& right) { return CompareRows(left, right) < 0; });
+
+        // Removed by the system when closed
+        FILE* file = tmpfile();
+        if (!file)
+        {
+            std::cout << "SqliteExternalSorter: could not create a temporary file" << std::endl;
+            return false;
+        }
+        m_runFiles.push_back(file);
+        for (std::vector<SqliteValue> const& row : m_rows)
+        {
+            for (SqliteValue const& value : row)
+            {
+                if (!WriteValue(file, value))
+                {
+                    std::cout << "SqliteExternalSorter: could not write a temporary file" << std::endl;
+                    return false;
+                }
+            }
+        }
+        if (fflush(file) != 0 || fseek(file, 0, SEEK_SET) != 0)
+        {
+            std::cout << "SqliteExternalSorter: could not write a temporary file" << std::endl;
+            return false;
+        }
+        m_rows.clear();
+        m_memoryBytes = 0;
+        return true;
+    }
+
+    void SqliteExternalSorter::CloseRuns()
+    {
+        for (FILE* file : m_runFiles)
+        {
+            fclose(file);
+        }
+        m_runFiles.clear();
+        m_rows.clear();
+        m_memoryBytes = 0;
+    }
+
+    bool SqliteExternalSorter::Add(std::vector<SqliteValue> const& row)
+    {
+        m_columnCount = row.size();
+        m_rows.push_back(row);
+        m_memoryBytes += sizeof(row) + row.size() * sizeof(SqliteValue);
+        for (SqliteValue const& value : row)
+        {
+            m_memoryBytes += value.GetBytes().size();
+        }
+        if (m_memoryBudget > 0 && m_memoryBytes >= m_memoryBudget)
+        {
+            return SpillRun();
+        }
+        return true;
+    }
+
+    bool SqliteExternalSorter::ForEachRow(std::function<bool(std::vector<SqliteValue> const& row)> const& visitor, int& retValue)
+    {
+        bool succeeded = true;
+        if (m_runFiles.empty())
+        {
+            std::sort(m_rows.begin(), m_rows.end(), [this](std::vector<SqliteValue> const& left, std::vector<SqliteValue> const& right) { return CompareRows(left, right) < 0; });
+            for (std::vector<SqliteValue> const& row : m_rows)
+            {
+                if (!visitor(row))
+                {
+                    succeeded = false;
+                    break;
+                }
+            }
+            CloseRuns();
+            return succeeded;
+        }
+
+        // Spill the last rows too, then merge the runs: the heap holds the runs by their current row
+        if (!m_rows.empty() && !SpillRun())
+        {
+            retValue = SQLITE_IOERR;
+            CloseRuns();
+            return false;
+        }
+        std::vector<Run> runs(m_runFiles.size());
+        auto isGreater = [this, &runs](size_t left, size_t right) { return CompareRows(runs[left].row, runs[right].row) > 0; };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(isGreater)> heap(isGreater);
+        std::string buffer;
+        int readResult = 0;
+        for (size_t i = 0; i < runs.size() && readResult >= 0; ++i)
+        {
+            runs[i].file = m_runFiles[i];
+            runs[i].row.resize(m_columnCount);
+            readResult = ReadRow(runs[i].file, runs[i].row, buffer);
+            if (readResult > 0)
+                heap.push(i);
+        }
+        while (readResult >= 0 && !heap.empty())
+        {
+            size_t i = heap.top();
+            heap.pop();
+            if (!visitor(runs[i].row))
+            {
+                succeeded = false;
+                break;
+            }
+            readResult = ReadRow(runs[i].file, runs[i].row, buffer);
+            if (readResult > 0)
+                heap.push(i);
+        }
+        if (readResult < 0)
+        {
+            std::cout << "SqliteExternalSorter: could not read a temporary file" << std::endl;
+            retValue = SQLITE_IOERR;
+            succeeded = false;
+        }
+        CloseRuns();
+        return succeeded;
+    }
+
+    size_t SqliteExternalSorter::GetRunCount() const
+    {
+        return m_runFiles.size();
+    }
+
+    bool SqliteWrapper::BulkLoad(const char* tableName, SqliteRowSource const& rowSource, int& retValue, SqliteBulkLoadOptions const& options, size_t* pnLoadedRows)
+    {
+        retValue = 0;
+        if (pnLoadedRows)
+            *pnLoadedRows = 0;
+
+        // The pragmas cannot be changed inside a transaction, and the load commits by itself
+        if (IsInTransaction())
+        {
+            std::cout << "BulkLoad: cannot be called inside a transaction" << std::endl;
+            retValue = SQLITE_MISUSE;
+            return false;
+        }
+
+        // Columns in declaration order, and the position of each one in the primary key
+        size_t columnCount = 0;
+        std::vector<std::pair<int, size_t>> primaryKey;
+        {
+            SqliteStatement statement;
+            if (!Prepare("SELECT pk FROM pragma_table_info(?1)", statement, retValue))
+                return false;
+            statement.BindText(1, tableName);
+            bool succeeded = statement.ForEachRow(retValue, [&](SqliteRow const& row)
+            {
+                if (row.GetInt(0) > 0)
+                    primaryKey.emplace_back(row.GetInt(0), columnCount);
+                ++columnCount;
+                return true;
+            });
+            if (!succeeded)
+                return false;
+        }
+        if (columnCount == 0)
+        {
+            std::cout << "BulkLoad: no such table: " << tableName << std::endl;
+            retValue = SQLITE_ERROR;
+            return false;
+        }
+
+        // Indexes created by CREATE INDEX without UNIQUE: the ones behind constraints cannot be dropped
+        std::vector<std::pair<std::string, std::string>> indexes;
+        if (options.dropIndexes)
+        {
+            SqliteStatement statement;
+            if (!Prepare("SELECT m.name, m.sql FROM pragma_index_list(?1) AS l JOIN sqlite_master AS m ON m.name = l.name "
+                "WHERE l.origin = 'c' AND NOT l.\"unique\" AND m.sql IS NOT NULL", statement, retValue))
+                return false;
+            statement.BindText(1, tableName);
+            bool succeeded = statement.ForEachRow(retValue, [&](SqliteRow const& row)
+            {
+                indexes.emplace_back(std::string(row.GetText(0)), std::string(row.GetText(1)));
+                return true;
+            });
+            if (!succeeded)
+                return false;
+        }
+
+        // Switching a WAL database to another journal mode would need exclusive access
+        std::string previousJournalMode;
+        std::string previousSynchronous;
+        if (!options.journalMode.empty())
+        {
+            ExecStatement("PRAGMA journal_mode", retValue, [&](SqliteRow const& row) { previousJournalMode = row.GetText(0); return false; });
+            if (previousJournalMode == "wal" || !ExecStatement(("PRAGMA journal_mode = " + options.journalMode).c_str()))
+                previousJournalMode.clear();
+        }
+        if (!options.synchronous.empty())
+        {
+            ExecStatement("PRAGMA synchronous", retValue, [&](SqliteRow const& row) { previousSynchronous = row.GetText(0); return false; });
+            if (!ExecStatement(("PRAGMA synchronous = " + options.synchronous).c_str()))
+                previousSynchronous.clear();
+        }
+        retValue = 0;
+
+        size_t droppedIndexes = 0;
+        bool succeeded = true;
+        for (; succeeded && droppedIndexes < indexes.size(); ++droppedIndexes)
+        {
+            if (!ExecStatement(("DROP INDEX " + QuoteIdentifier(indexes[droppedIndexes].first)).c_str(), retValue))
+            {
+                std::cout << "BulkLoad: could not drop index " << indexes[droppedIndexes].first << ": " << LastErrorMessage() << std::endl;
+                succeeded = false;
+                break;
+            }
+        }
+
+        // One prepared insert for all the rows, committed every 'rowsPerTransaction' rows
+        SqliteStatement insert;
+        if (succeeded)
+        {
+            std::string insertText = "INSERT INTO " + QuoteIdentifier(tableName) + " VALUES(?";
+            for (size_t i = 1; i < columnCount; ++i)
+            {
+                insertText += ", ?";
+            }
+            insertText += ")";
+            succeeded = Prepare(insertText.c_str(), insert, retValue);
+        }
+        size_t committedRows = 0;
+        size_t pendingRows = 0;
+        auto insertRow = [&](std::vector<SqliteValue> const& row)
+        {
+            if (pendingRows == 0 && !ExecStatement("BEGIN IMMEDIATE TRANSACTION", retValue))
+                return false;
+            for (size_t i = 0; i < row.size(); ++i)
+            {
+                if (!insert.BindValue((int)i + 1, row[i]))
+                {
+                    retValue = SQLITE_RANGE;
+                    return false;
+                }
+            }
+            if (!insert.Exec(retValue))
+                return false;
+            if (++pendingRows == options.rowsPerTransaction)
+            {
+                if (!ExecStatement("COMMIT", retValue))
+                    return false;
+                committedRows += pendingRows;
+                pendingRows = 0;
+            }
+            return true;
+        };
+
+        std::unique_ptr<SqliteExternalSorter> sorter;
+        if (options.sortByPrimaryKey && !primaryKey.empty())
+        {
+            std::sort(primaryKey.begin(), primaryKey.end());
+            std::vector<size_t> keyColumns;
+            for (std::pair<int, size_t> const& keyColumn : primaryKey)
+            {
+                keyColumns.push_back(keyColumn.second);
+            }
+            sorter.reset(new SqliteExternalSorter(keyColumns, options.sortMemoryBytes));
+        }
+
+        std::vector<SqliteValue> row;
+        while (succeeded && rowSource(row))
+        {
+            if (row.size() != columnCount)
+            {
+                std::cout << "BulkLoad: a row has " << row.size() << " values, table " << tableName << " has " << columnCount << " columns" << std::endl;
+                retValue = SQLITE_RANGE;
+                succeeded = false;
+            }
+            else if (sorter)
+            {
+                if (!sorter->Add(row))
+                {
+                    retValue = SQLITE_IOERR;
+                    succeeded = false;
+                }
+            }
+            else
+            {
+                succeeded = insertRow(row);
+            }
+        }
+        if (succeeded && sorter)
+        {
+            succeeded = sorter->ForEachRow(insertRow, retValue);
+        }
+        if (succeeded && pendingRows > 0)
+        {
+            succeeded = ExecStatement("COMMIT", retValue);
+            if (succeeded)
+                committedRows += pendingRows;
+        }
+        if (!succeeded && IsInTransaction())
+        {
+            RollBackTransaction();
+        }
+        insert.Release();
+        sorter.reset();
+        if (pnLoadedRows)
+            *pnLoadedRows = committedRows;
+
+        // Indexes are built again even if the load failed, each one in a single pass over the table
+        int indexRetValue = 0;
+        for (size_t i = 0; i < droppedIndexes; ++i)
+        {
+            if (!ExecStatement(indexes[i].second.c_str(), indexRetValue))
+            {
+                std::cout << "BulkLoad: could not create index " << indexes[i].first << " again: " << LastErrorMessage() << std::endl;
+                if (succeeded)
+                    retValue = indexRetValue;
+                succeeded = false;
+            }
+        }
+
+        int pragmaRetValue = 0;
+        if (!previousSynchronous.empty())
+            ExecStatement(("PRAGMA synchronous = " + previousSynchronous).c_str(), pragmaRetValue);
+        if (!previousJournalMode.empty())
+            ExecStatement(("PRAGMA journal_mode = " + previousJournalMode).c_str(), pragmaRetValue);
+        return succeeded;
+    }
+}
@@ -0,0 +1,90 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteBulkLoad.h $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#pragma once
+#include "SqliteValue.h"
+#include <stdio.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace A3D
+{
+    //--------------------------------------------------------------------------------------
+    // Called by SqliteWrapper::BulkLoad() for each row to load. Fill 'row' with one value
+    // per column of the table, in declaration order, and return true; return false once
+    // there are no more rows. 'row' keeps the values of the previous row.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    typedef std::function<bool(std::vector<SqliteValue>& row)> SqliteRowSource;
+
+    //--------------------------------------------------------------------------------------
+    // Settings of SqliteWrapper::BulkLoad(). The default ones trade durability for speed:
+    // a crash during the load can corrupt the database, which must then be loaded again.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    struct SqliteBulkLoadOptions
+    {
+        size_t rowsPerTransaction = 100000;                          // Rows inserted between two commits. 0 = a single transaction.
+        bool sortByPrimaryKey = false;                               // Insert in primary key order, through an external sort.
+        size_t sortMemoryBytes = 64 * 1024 * 1024;                   // Rows kept in memory before a sorted run is spilled to a temporary file. 0 = no limit.
+        bool dropIndexes = true;                                     // Drop the non-unique indexes during the load and build them again at the end.
+        std::string journalMode = "MEMORY";                          // journal_mode during the load. Empty = unchanged. A WAL database stays in WAL mode.
+        std::string synchronous = "OFF";                             // synchronous during the load. Empty = unchanged.
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Rows sorted on some of their columns: in memory up to a budget, then in sorted runs
+    // spilled to temporary files that are merged when the rows are read back.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    class SqliteExternalSorter
+    {
+    private:
+        struct Run
+        {
+            FILE* file;
+            std::vector<SqliteValue> row;
+        };
+
+        std::vector<size_t> m_keyColumns;
+        size_t m_memoryBudget;
+        size_t m_memoryBytes;
+        size_t m_columnCount;
+        std::vector<std::vector<SqliteValue>> m_rows;
+        std::vector<FILE*> m_runFiles;
+
+        int CompareRows(std::vector<SqliteValue> const& left, std::vector<SqliteValue> const& right) const;
+        bool SpillRun();
+        void CloseRuns();
+
+    public:
+        //--------------------------------------------------------------------------------------
+        // @param       keyColumns      Indexes of the columns of the sort key, most significant first.
+        // @param       memoryBudget    Approximate size of the rows kept in memory (bytes). 0 = no limit.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        SqliteExternalSorter(std::vector<size_t> const& keyColumns, size_t memoryBudget);
+        SqliteExternalSorter(SqliteExternalSorter const&) = delete;
+        SqliteExternalSorter& operator=(SqliteExternalSorter const&) = delete;
+        ~SqliteExternalSorter();
+
+        //--------------------------------------------------------------------------------------
+        // @description Add a row, spilling a sorted run when the memory budget is exceeded.
+        // @param       row     The row. All the rows must have the same number of values.
+        // @return      False if a temporary file could not be written, true otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool Add(std::vector<SqliteValue> const& row);
+
+        //--------------------------------------------------------------------------------------
+        // @description Visit all the rows in key order. The sorter is empty afterwards.
+        // @param       visitor     Called with each row, returns false to stop early.
+        // @param       retValue    Set to SQLITE_IOERR if a temporary file could not be read.
+        // @return      False if the visit stopped early or on error, true otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool ForEachRow(std::function<bool(std::vector<SqliteValue> const& row)> const& visitor, int& retValue);
+
+        size_t GetRunCount() const;
+    };
+}
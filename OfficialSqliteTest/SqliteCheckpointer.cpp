@@ -0,0 +1,184 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteCheckpointer.cpp $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#include "SqliteCheckpointer.h"
+#include "SqliteWrapper.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace A3D
+{
+    SqliteCheckpointer::SqliteCheckpointer(SqliteWrapper& wrapper, std::string const& databasePath, SqliteCheckpointPolicy const& policy)
+        : m_wrapper(wrapper),
+        m_policy(policy),
+        m_connection(nullptr),
+        m_walFrames(0),
+        m_checkpointedFrames(0),
+        m_commitCount(0),
+        m_isStopping(false)
+    {
+        // Only used by the checkpointer thread
+        if (SQLITE_OK != sqlite3_a3d_open_v2(databasePath.c_str(), &m_connection, SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX, nullptr))
+        {
+            std::cout << "SqliteCheckpointer: could not open " << databasePath << std::endl;
+            sqlite3_a3d_close_v2(m_connection);
+            m_connection = nullptr;
+            return;
+        }
+        // A TRUNCATE checkpoint waits for the readers of the WAL to finish
+        sqlite3_a3d_busy_timeout(m_connection, (int)std::max(m_policy.maxStallMs, 100u));
+        // The WAL of a connection is only opened by its first read, a checkpoint does nothing before
+        sqlite3_a3d_exec(m_connection, "PRAGMA schema_version", nullptr, nullptr, nullptr);
+        m_thread = std::thread(&SqliteCheckpointer::CheckpointLoop, this);
+    }
+
+    SqliteCheckpointer::~SqliteCheckpointer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_isStopping.store(true);
+        }
+        m_wake.notify_all();
+        m_walShrunk.notify_all();
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+        if (m_connection)
+        {
+            sqlite3_a3d_close_v2(m_connection);
+        }
+    }
+
+    bool SqliteCheckpointer::IsRunning() const
+    {
+        return m_connection != nullptr;
+    }
+
+    bool SqliteCheckpointer::IsOverHardLimit() const
+    {
+        return m_policy.hardLimitFrames > 0 && m_walFrames.load(std::memory_order_relaxed) >= m_policy.hardLimitFrames;
+    }
+
+    bool SqliteCheckpointer::HasWork() const
+    {
+        return IsOverHardLimit() || (m_policy.passiveFrames > 0
+            && m_walFrames.load(std::memory_order_relaxed) - m_checkpointedFrames.load(std::memory_order_relaxed) >= m_policy.passiveFrames);
+    }
+
+    int SqliteCheckpointer::WalHook(void* checkpointer, sqlite3* /*connection*/, const char* /*schema*/, int frames)
+    {
+        SqliteCheckpointer* self = static_cast<SqliteCheckpointer*>(checkpointer);
+        // The WAL starts again from its beginning once fully checkpointed
+        if (frames < self->m_checkpointedFrames.load(std::memory_order_relaxed))
+        {
+            self->m_checkpointedFrames.store(0, std::memory_order_relaxed);
+        }
+        self->m_walFrames.store(frames, std::memory_order_relaxed);
+        self->m_commitCount.fetch_add(1, std::memory_order_relaxed);
+        if (!self->HasWork())
+        {
+            return SQLITE_OK;
+        }
+
+        std::unique_lock<std::mutex> lock(self->m_mutex);
+        self->m_wake.notify_one();
+        if (self->IsOverHardLimit())
+        {
+            // Backpressure: the connection of the wrapper is held until the WAL is truncated
+            auto start = std::chrono::steady_clock::now();
+            self->m_walShrunk.wait_for(lock, std::chrono::milliseconds(self->m_policy.maxStallMs),
+                [self]() { return self->m_isStopping.load() || !self->IsOverHardLimit(); });
+            if (SqliteMetrics* metrics = self->m_wrapper.GetEnabledMetrics())
+            {
+                metrics->RecordBackpressure(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+            }
+        }
+        return SQLITE_OK;
+    }
+
+    void SqliteCheckpointer::CheckpointLoop()
+    {
+        uint64_t seenCommitCount = m_commitCount.load();
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_isStopping.load())
+        {
+            // A checkpoint blocked by the readers is only tried again after the next commit or idle period
+            auto isReady = [this, &seenCommitCount]() { return m_isStopping.load() || (m_commitCount.load() != seenCommitCount && HasWork()); };
+            if (m_policy.idleMs > 0)
+            {
+                m_wake.wait_for(lock, std::chrono::milliseconds(m_policy.idleMs), isReady);
+            }
+            else
+            {
+                m_wake.wait(lock, isReady);
+            }
+            if (m_isStopping.load())
+            {
+                break;
+            }
+
+            int mode;
+            uint64_t commitCount = m_commitCount.load();
+            if (IsOverHardLimit())
+            {
+                mode = SQLITE_CHECKPOINT_TRUNCATE;
+            }
+            else if (HasWork())
+            {
+                mode = SQLITE_CHECKPOINT_PASSIVE;
+            }
+            else if (commitCount == seenCommitCount && m_walFrames.load() > 0)
+            {
+                // Idle: nothing was committed during a whole period
+                mode = SQLITE_CHECKPOINT_TRUNCATE;
+            }
+            else
+            {
+                seenCommitCount = commitCount;
+                continue;
+            }
+            seenCommitCount = commitCount;
+
+            lock.unlock();
+            Checkpoint(mode);
+            lock.lock();
+            m_walShrunk.notify_all();
+        }
+    }
+
+    void SqliteCheckpointer::Checkpoint(int mode)
+    {
+        auto start = std::chrono::steady_clock::now();
+        int logFrames = 0;
+        int checkpointedFrames = 0;
+        int retValue = sqlite3_a3d_wal_checkpoint_v2(m_connection, nullptr, mode, &logFrames, &checkpointedFrames);
+        uint64_t durationNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+        if (retValue == SQLITE_OK && mode == SQLITE_CHECKPOINT_TRUNCATE)
+        {
+            m_walFrames.store(0);
+            m_checkpointedFrames.store(0);
+        }
+        else if (retValue == SQLITE_OK || retValue == SQLITE_BUSY)
+        {
+            // A checkpoint stopped by the readers still copied what it could, as a PASSIVE one
+            m_checkpointedFrames.store(checkpointedFrames);
+        }
+        else
+        {
+            std::cout << "SqliteCheckpointer: checkpoint failed: " << sqlite3_a3d_errmsg(m_connection) << std::endl;
+        }
+        if (SqliteMetrics* metrics = m_wrapper.GetEnabledMetrics())
+        {
+            metrics->RecordCheckpoint(durationNs, checkpointedFrames);
+        }
+    }
+}
@@ -0,0 +1,86 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteCheckpointer.h $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#pragma once
+extern "C" {
+    #include "sqlite3.h"
+}
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace A3D
+{
+    class SqliteWrapper;
+
+    //--------------------------------------------------------------------------------------
+    // When the background checkpointer of a SqliteWrapper copies the WAL back into the
+    // database. Sizes are in WAL frames, one frame per page written.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    struct SqliteCheckpointPolicy
+    {
+        int passiveFrames = 1000;                                    // Frames not yet checkpointed that trigger a PASSIVE checkpoint. 0 = never.
+        unsigned int idleMs = 2000;                                  // Time without commit after which the WAL is checkpointed and truncated. 0 = never.
+        int hardLimitFrames = 20000;                                 // WAL size beyond which commits wait for a TRUNCATE checkpoint. 0 = no limit.
+        unsigned int maxStallMs = 1000;                              // Longest wait of a commit beyond the hard limit.
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Thread checkpointing the WAL of a wrapper through its own connection, so that it
+    // never waits for the connection of the wrapper. It replaces the automatic checkpoint
+    // of SQLite, driven by the WAL hook called after each commit. Started with
+    // SqliteWrapper::StartCheckpointer().
+    //+---------------+---------------+---------------+---------------+---------------+------
+    class SqliteCheckpointer
+    {
+    private:
+        SqliteWrapper& m_wrapper;
+        SqliteCheckpointPolicy m_policy;
+        sqlite3* m_connection;
+
+        std::atomic<int> m_walFrames;                                // Size of the WAL after the last commit.
+        std::atomic<int> m_checkpointedFrames;                       // Frames of the WAL already copied to the database.
+        std::atomic<uint64_t> m_commitCount;
+        std::atomic<bool> m_isStopping;
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_walShrunk;
+        std::thread m_thread;
+
+        bool HasWork() const;
+        bool IsOverHardLimit() const;
+        void CheckpointLoop();
+        void Checkpoint(int mode);
+
+    public:
+        //--------------------------------------------------------------------------------------
+        // @param       wrapper         The wrapper, its database in WAL mode. Must outlive the checkpointer.
+        // @param       databasePath    Path of the database file of the wrapper.
+        // @param       policy          When to checkpoint.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        SqliteCheckpointer(SqliteWrapper& wrapper, std::string const& databasePath, SqliteCheckpointPolicy const& policy);
+        SqliteCheckpointer(SqliteCheckpointer const&) = delete;
+        SqliteCheckpointer& operator=(SqliteCheckpointer const&) = delete;
+
+        //--------------------------------------------------------------------------------------
+        // @description Stop the thread. The WAL hook must be removed from the wrapper first.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        ~SqliteCheckpointer();
+
+        bool IsRunning() const;
+
+        //--------------------------------------------------------------------------------------
+        // @description WAL hook of the wrapper connection, called by SQLite after each commit.
+        //              Waits there while the WAL is over its hard limit.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        static int WalHook(void* checkpointer, sqlite3* connection, const char* schema, int frames);
+    };
+}
@@ -0,0 +1,173 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteColumnarBatch.cpp $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#include "SqliteColumnarBatch.h"
+
+#include <algorithm>
+
+namespace A3D
+{
+    // Storage type from the declared type of a column, following the SQLite affinity rules
+    static int typeFromDeclaration(const char* declaredType)
+    {
+        if (!declaredType)
+            return SQLITE_TEXT;
+
+        std::string upper(declaredType);
+        for (char& c : upper)
+        {
+            if (c >= 'a' && c <= 'z')
+                c = (char)(c - 'a' + 'A');
+        }
+        if (upper.find("INT") != std::string::npos)
+            return SQLITE_INTEGER;
+        if (upper.find("CHAR") != std::string::npos || upper.find("CLOB") != std::string::npos || upper.find("TEXT") != std::string::npos)
+            return SQLITE_TEXT;
+        if (upper.find("BLOB") != std::string::npos)
+            return SQLITE_BLOB;
+        if (upper.find("REAL") != std::string::npos || upper.find("FLOA") != std::string::npos || upper.find("DOUB") != std::string::npos)
+            return SQLITE_FLOAT;
+        return SQLITE_TEXT;
+    }
+
+    SqliteColumnarBatch::SqliteColumnarBatch(size_t capacity)
+        : m_capacity(capacity > 0 ? capacity : 1),
+        m_rowCount(0),
+        m_hasColumns(false)
+    {
+    }
+
+    void SqliteColumnarBatch::SetColumnTypes(std::vector<int> const& types)
+    {
+        m_requestedTypes = types;
+        Reset();
+    }
+
+    void SqliteColumnarBatch::InitColumns(SqliteRow const& row)
+    {
+        // The arrays of the previous columns are reused
+        int columnCount = row.GetColumnCount();
+        m_columns.resize(columnCount);
+        m_hasColumns = true;
+        for (int i = 0; i < columnCount; ++i)
+        {
+            SqliteColumn& column = m_columns[i];
+            column.name = row.GetColumnName(i) ? row.GetColumnName(i) : "";
+            if ((size_t)i < m_requestedTypes.size())
+                column.type = m_requestedTypes[i];
+            else if (!row.IsNull(i))
+                column.type = row.GetType(i);
+            else
+                column.type = typeFromDeclaration(row.GetDeclaredType(i));
+
+            switch (column.type)
+            {
+            case SQLITE_INTEGER:
+                column.integers.assign(m_capacity, 0);
+                break;
+            case SQLITE_FLOAT:
+                column.floats.assign(m_capacity, 0.0);
+                break;
+            default:
+                column.type = column.type == SQLITE_BLOB ? SQLITE_BLOB : SQLITE_TEXT;
+                column.offsets.assign(m_capacity + 1, 0);
+                break;
+            }
+            column.arena.clear();
+            column.validity.assign((m_capacity + 63) / 64, 0);
+        }
+    }
+
+    void SqliteColumnarBatch::Clear()
+    {
+        m_rowCount = 0;
+        for (SqliteColumn& column : m_columns)
+        {
+            column.arena.clear();
+            std::fill(column.validity.begin(), column.validity.end(), 0);
+        }
+    }
+
+    void SqliteColumnarBatch::Reset()
+    {
+        Clear();
+        m_hasColumns = false;
+    }
+
+    bool SqliteColumnarBatch::AppendRow(SqliteRow const& row)
+    {
+        if (m_rowCount >= m_capacity)
+            return false;
+
+        if (m_rowCount == 0 && (!m_hasColumns || m_columns.size() != (size_t)row.GetColumnCount()))
+            InitColumns(row);
+
+        size_t r = m_rowCount;
+        for (size_t i = 0; i < m_columns.size(); ++i)
+        {
+            SqliteColumn& column = m_columns[i];
+            bool isValid = !row.IsNull((int)i);
+            if (isValid)
+                column.validity[r >> 6] |= uint64_t(1) << (r & 63);
+
+            switch (column.type)
+            {
+            case SQLITE_INTEGER:
+                column.integers[r] = isValid ? row.GetInt64((int)i) : 0;
+                break;
+            case SQLITE_FLOAT:
+                column.floats[r] = isValid ? row.GetDouble((int)i) : 0.0;
+                break;
+            case SQLITE_BLOB:
+                if (isValid)
+                {
+                    SqliteBlob blob = row.GetBlob((int)i);
+                    const char* bytes = reinterpret_cast<const char*>(blob.data);
+                    column.arena.insert(column.arena.end(), bytes, bytes + blob.size);
+                }
+                column.offsets[r + 1] = (uint32_t)column.arena.size();
+                break;
+            default:
+                if (isValid)
+                {
+                    std::string_view text = row.GetText((int)i);
+                    column.arena.insert(column.arena.end(), text.data(), text.data() + text.size());
+                }
+                column.offsets[r + 1] = (uint32_t)column.arena.size();
+                break;
+            }
+        }
+        ++m_rowCount;
+        return true;
+    }
+
+    bool SqliteColumnarBatch::IsFull() const
+    {
+        return m_rowCount >= m_capacity;
+    }
+
+    size_t SqliteColumnarBatch::GetCapacity() const
+    {
+        return m_capacity;
+    }
+
+    size_t SqliteColumnarBatch::GetRowCount() const
+    {
+        return m_rowCount;
+    }
+
+    size_t SqliteColumnarBatch::GetColumnCount() const
+    {
+        return m_columns.size();
+    }
+
+    SqliteColumn const& SqliteColumnarBatch::GetColumn(size_t column) const
+    {
+        return m_columns[column];
+    }
+}
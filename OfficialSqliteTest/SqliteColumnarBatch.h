@@ -0,0 +1,96 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteColumnarBatch.h $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#pragma once
+#include "SqliteRow.h"
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace A3D
+{
+    //--------------------------------------------------------------------------------------
+    // One column of a SqliteColumnarBatch. Depending on its type, values are stored in
+    // 'integers', 'floats', or in 'arena' for text and blobs, value i being the bytes
+    // [offsets[i], offsets[i + 1]). Bit i of 'validity' is cleared when value i is NULL;
+    // the slot of a NULL value holds 0 or an empty string.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    struct SqliteColumn
+    {
+        std::string name;
+        int type = SQLITE_NULL;                                      // SQLITE_INTEGER, SQLITE_FLOAT, SQLITE_TEXT or SQLITE_BLOB. SQLITE_NULL until known.
+        std::vector<sqlite3_a3d_int64> integers;
+        std::vector<double> floats;
+        std::vector<char> arena;
+        std::vector<uint32_t> offsets;
+        std::vector<uint64_t> validity;
+
+        bool IsValid(size_t row) const
+        {
+            return 0 != (validity[row >> 6] & (uint64_t(1) << (row & 63)));
+        }
+
+        std::string_view GetText(size_t row) const
+        {
+            return std::string_view(arena.data() + offsets[row], offsets[row + 1] - offsets[row]);
+        }
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Batch of up to 'capacity' rows stored column by column in contiguous arrays, filled
+    // by SqliteWrapper::ExecColumnar(). The arrays are allocated once and reused by each
+    // batch. Column types are taken from the first row of each statement (or the declared
+    // type when that value is NULL) unless set with SetColumnTypes(); other values are
+    // converted by SQLite.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    class SqliteColumnarBatch
+    {
+    private:
+        std::vector<SqliteColumn> m_columns;
+        std::vector<int> m_requestedTypes;
+        size_t m_capacity;
+        size_t m_rowCount;
+        bool m_hasColumns;                                           // False until the first row of a statement sets the columns.
+
+        void InitColumns(SqliteRow const& row);
+
+    public:
+        explicit SqliteColumnarBatch(size_t capacity = 1024);
+
+        //--------------------------------------------------------------------------------------
+        // @description Force the storage type of each column instead of guessing it.
+        // @param       types   SQLITE_INTEGER, SQLITE_FLOAT, SQLITE_TEXT or SQLITE_BLOB for each column.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void SetColumnTypes(std::vector<int> const& types);
+
+        //--------------------------------------------------------------------------------------
+        // @description Forget the rows of the batch, keeping the columns and allocated memory.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void Clear();
+
+        //--------------------------------------------------------------------------------------
+        // @description Forget the rows and the columns of the batch, keeping the allocated
+        //              memory. The next row sets the names and types of the columns again.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void Reset();
+
+        //--------------------------------------------------------------------------------------
+        // @description Copy the current row of a statement at the end of the batch.
+        // @param       row     The row.
+        // @return      False if the batch is already full, true otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool AppendRow(SqliteRow const& row);
+
+        bool IsFull() const;
+        size_t GetCapacity() const;
+        size_t GetRowCount() const;
+        size_t GetColumnCount() const;
+        SqliteColumn const& GetColumn(size_t column) const;
+    };
+}
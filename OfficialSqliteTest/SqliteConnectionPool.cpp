@@ -0,0 +1,202 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteConnectionPool.cpp $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#include "SqliteConnectionPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+namespace A3D
+{
+    /************************** SqliteConnectionLease ***************************/
+
+    SqliteConnectionLease::SqliteConnectionLease()
+        : m_pool(nullptr),
+        m_connection(nullptr),
+        m_isWriter(false)
+    {
+    }
+
+    SqliteConnectionLease::SqliteConnectionLease(SqliteConnectionPool* pool, SqliteWrapper* connection, bool isWriter)
+        : m_pool(pool),
+        m_connection(connection),
+        m_isWriter(isWriter)
+    {
+    }
+
+    SqliteConnectionLease::SqliteConnectionLease(SqliteConnectionLease&& other) noexcept
+        : m_pool(other.m_pool),
+        m_connection(other.m_connection),
+        m_isWriter(other.m_isWriter)
+    {
+        other.m_pool = nullptr;
+        other.m_connection = nullptr;
+    }
+
+    SqliteConnectionLease& SqliteConnectionLease::operator=(SqliteConnectionLease&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Release();
+            m_pool = other.m_pool;
+            m_connection = other.m_connection;
+            m_isWriter = other.m_isWriter;
+            other.m_pool = nullptr;
+            other.m_connection = nullptr;
+        }
+        return *this;
+    }
+
+    SqliteConnectionLease::~SqliteConnectionLease()
+    {
+        Release();
+    }
+
+    bool SqliteConnectionLease::IsValid() const
+    {
+        return m_connection != nullptr;
+    }
+
+    bool SqliteConnectionLease::IsWriter() const
+    {
+        return m_isWriter;
+    }
+
+    void SqliteConnectionLease::Release()
+    {
+        if (m_pool && m_connection)
+        {
+            m_pool->ReleaseConnection(m_connection, m_isWriter);
+        }
+        m_pool = nullptr;
+        m_connection = nullptr;
+    }
+
+    SqliteWrapper& SqliteConnectionLease::Get() const
+    {
+        return *m_connection;
+    }
+
+    SqliteWrapper* SqliteConnectionLease::operator->() const
+    {
+        return m_connection;
+    }
+
+    /************************** SqliteConnectionPool ***************************/
+
+    SqliteConnectionPool::SqliteConnectionPool(std::string const& databasePath, size_t readerCount, int timeoutMs)
+        : m_databasePath(databasePath),
+        m_isReady(false)
+    {
+        if (readerCount == 0)
+        {
+            readerCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        // The writer creates the database and switches it to WAL mode before any reader opens it
+        m_writer.reset(new SqliteWrapper(databasePath, timeoutMs, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX));
+        if (!m_writer->IsReady())
+        {
+            std::cout << "SqliteConnectionPool: could not open " << databasePath << std::endl;
+            return;
+        }
+
+        int retValue = 0;
+        std::vector<std::vector<std::string>> results;
+        if (!m_writer->ExecStatement("PRAGMA journal_mode=WAL", retValue, results) || results.empty() || results[0].empty() || results[0][0] != "wal")
+        {
+            std::cout << "SqliteConnectionPool: could not enable WAL mode: " << m_writer->LastErrorMessage() << std::endl;
+            return;
+        }
+
+        m_readers.reserve(readerCount);
+        m_freeReaders.reserve(readerCount);
+        for (size_t i = 0; i < readerCount; ++i)
+        {
+            m_readers.emplace_back(new SqliteWrapper(databasePath, timeoutMs, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX));
+            if (!m_readers.back()->IsReady())
+            {
+                std::cout << "SqliteConnectionPool: could not open reader " << i << std::endl;
+                return;
+            }
+            m_freeReaders.push_back(m_readers.back().get());
+        }
+
+        m_isReady = true;
+    }
+
+    SqliteConnectionPool::~SqliteConnectionPool()
+    {
+        // Readers are closed first so the writer, closed last, can checkpoint and remove the WAL file
+        m_readers.clear();
+        m_writer.reset();
+    }
+
+    bool SqliteConnectionPool::IsReady() const
+    {
+        return m_isReady;
+    }
+
+    size_t SqliteConnectionPool::GetReaderCount() const
+    {
+        return m_readers.size();
+    }
+
+    SqliteConnectionLease SqliteConnectionPool::AcquireReader(unsigned int timeoutMs)
+    {
+        if (!m_isReady)
+            return SqliteConnectionLease();
+
+        std::unique_lock<std::mutex> lock(m_readersMutex);
+        if (timeoutMs == 0)
+        {
+            m_readerReleased.wait(lock, [this]() { return !m_freeReaders.empty(); });
+        }
+        else if (!m_readerReleased.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]() { return !m_freeReaders.empty(); }))
+        {
+            return SqliteConnectionLease();
+        }
+
+        SqliteWrapper* reader = m_freeReaders.back();
+        m_freeReaders.pop_back();
+        return SqliteConnectionLease(this, reader, false);
+    }
+
+    SqliteConnectionLease SqliteConnectionPool::AcquireWriter(unsigned int timeoutMs)
+    {
+        if (!m_isReady)
+            return SqliteConnectionLease();
+
+        if (timeoutMs == 0)
+        {
+            m_writerMutex.lock();
+        }
+        else if (!m_writerMutex.try_lock_for(std::chrono::milliseconds(timeoutMs)))
+        {
+            return SqliteConnectionLease();
+        }
+        return SqliteConnectionLease(this, m_writer.get(), true);
+    }
+
+    void SqliteConnectionPool::ReleaseConnection(SqliteWrapper* connection, bool isWriter)
+    {
+        if (isWriter)
+        {
+            m_writerMutex.unlock();
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_readersMutex);
+            m_freeReaders.push_back(connection);
+        }
+        m_readerReleased.notify_one();
+    }
+}
@@ -0,0 +1,116 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteConnectionPool.h $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#pragma once
+#include "SqliteWrapper.h"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace A3D
+{
+    class SqliteConnectionPool;
+
+    //--------------------------------------------------------------------------------------
+    // Exclusive use of one connection of a SqliteConnectionPool, given back to the pool
+    // when the lease is destroyed or released. A lease must not outlive its pool.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    class SqliteConnectionLease
+    {
+    private:
+        friend class SqliteConnectionPool;
+
+        SqliteConnectionPool* m_pool;
+        SqliteWrapper* m_connection;
+        bool m_isWriter;
+
+        SqliteConnectionLease(SqliteConnectionPool* pool, SqliteWrapper* connection, bool isWriter);
+
+    public:
+        SqliteConnectionLease();
+        SqliteConnectionLease(SqliteConnectionLease&& other) noexcept;
+        SqliteConnectionLease& operator=(SqliteConnectionLease&& other) noexcept;
+        SqliteConnectionLease(SqliteConnectionLease const&) = delete;
+        SqliteConnectionLease& operator=(SqliteConnectionLease const&) = delete;
+        ~SqliteConnectionLease();
+
+        //--------------------------------------------------------------------------------------
+        // @description   Check if the lease holds a connection (acquisition may time out).
+        // @return        True if valid, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool IsValid() const;
+        bool IsWriter() const;
+
+        //--------------------------------------------------------------------------------------
+        // @description   Give the connection back to the pool. The lease becomes invalid.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void Release();
+
+        SqliteWrapper& Get() const;
+        SqliteWrapper* operator->() const;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Pool of connections on one database file in WAL mode: a single read-write
+    // connection and N read-only ones, all opened with SQLITE_OPEN_NOMUTEX. Readers run in
+    // parallel with each other and with the writer, so read throughput grows with the
+    // number of cores. Each connection is used by one thread at a time through a lease.
+    // In-memory databases cannot be shared between connections and are not supported.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    class SqliteConnectionPool
+    {
+    private:
+        friend class SqliteConnectionLease;
+
+        std::string m_databasePath;
+        bool m_isReady;
+        std::unique_ptr<SqliteWrapper> m_writer;
+        std::vector<std::unique_ptr<SqliteWrapper>> m_readers;
+
+        std::timed_mutex m_writerMutex;                              // Owned by the current writer lease.
+        std::mutex m_readersMutex;
+        std::condition_variable m_readerReleased;
+        std::vector<SqliteWrapper*> m_freeReaders;                   // Last released on top: its pages are the most likely to be hot.
+
+        void ReleaseConnection(SqliteWrapper* connection, bool isWriter);
+
+    public:
+        //--------------------------------------------------------------------------------------
+        // @description Open the writer, switch the database to WAL mode, then open the readers.
+        // @param       databasePath    Path of the database file, created if needed.
+        // @param       readerCount     Number of read-only connections. 0 = one per hardware thread.
+        // @param       timeoutMs       Retry timeout of each connection (ms). 0 = forever.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        explicit SqliteConnectionPool(std::string const& databasePath, size_t readerCount = 0, int timeoutMs = 3000);
+        ~SqliteConnectionPool();
+
+        //--------------------------------------------------------------------------------------
+        // @description   Check if all the connections are opened and the database is in WAL mode.
+        // @return        True if ready, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool IsReady() const;
+
+        size_t GetReaderCount() const;
+
+        //--------------------------------------------------------------------------------------
+        // @description Lease a read-only connection, waiting for one to be available.
+        // @param       timeoutMs   Maximum wait (ms). 0 = forever.
+        // @return      The lease, not valid if the wait timed out.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        SqliteConnectionLease AcquireReader(unsigned int timeoutMs = 0);
+
+        //--------------------------------------------------------------------------------------
+        // @description Lease the read-write connection, waiting for the current writer to release it.
+        // @param       timeoutMs   Maximum wait (ms). 0 = forever.
+        // @return      The lease, not valid if the wait timed out.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        SqliteConnectionLease AcquireWriter(unsigned int timeoutMs = 0);
+    };
+}
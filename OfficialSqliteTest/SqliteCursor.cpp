@@ -0,0 +1,194 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteCursor.cpp $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#include "SqliteCursor.h"
+
+#include <utility>
+
+namespace A3D
+{
+    SqliteCursor::Iterator::Iterator(SqliteCursor* cursor)
+        : m_cursor(cursor)
+    {
+    }
+
+    SqliteRow SqliteCursor::Iterator::operator*() const
+    {
+        return m_cursor->GetRow();
+    }
+
+    SqliteCursor::Iterator& SqliteCursor::Iterator::operator++()
+    {
+        if (!m_cursor->Next())
+        {
+            m_cursor = nullptr;
+        }
+        return *this;
+    }
+
+    bool SqliteCursor::Iterator::operator==(Iterator const& other) const
+    {
+        return m_cursor == other.m_cursor;
+    }
+
+    bool SqliteCursor::Iterator::operator!=(Iterator const& other) const
+    {
+        return m_cursor != other.m_cursor;
+    }
+
+    SqliteCursor::SqliteCursor()
+        : m_lockedWrapper(nullptr),
+        m_retValue(SQLITE_MISUSE),
+        m_isStarted(false),
+        m_isDone(true)
+    {
+    }
+
+    SqliteCursor::SqliteCursor(SqliteStatement&& statement)
+        : m_lockedWrapper(nullptr),
+        m_statement(std::move(statement)),
+        m_retValue(SQLITE_MISUSE),
+        m_isStarted(false),
+        m_isDone(true)
+    {
+        Open();
+    }
+
+    SqliteCursor::SqliteCursor(SqliteConnectionLease&& lease, SqliteStatement&& statement)
+        : m_lease(std::move(lease)),
+        m_lockedWrapper(nullptr),
+        m_statement(std::move(statement)),
+        m_retValue(SQLITE_MISUSE),
+        m_isStarted(false),
+        m_isDone(true)
+    {
+        Open();
+    }
+
+    SqliteCursor::SqliteCursor(SqliteCursor&& other) noexcept
+        : m_lease(std::move(other.m_lease)),
+        m_lockedWrapper(other.m_lockedWrapper),
+        m_statement(std::move(other.m_statement)),
+        m_retValue(other.m_retValue),
+        m_isStarted(other.m_isStarted),
+        m_isDone(other.m_isDone)
+    {
+        other.m_lockedWrapper = nullptr;
+        other.m_isDone = true;
+    }
+
+    SqliteCursor& SqliteCursor::operator=(SqliteCursor&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Close();
+            m_lease = std::move(other.m_lease);
+            m_lockedWrapper = other.m_lockedWrapper;
+            m_statement = std::move(other.m_statement);
+            m_retValue = other.m_retValue;
+            m_isStarted = other.m_isStarted;
+            m_isDone = other.m_isDone;
+            other.m_lockedWrapper = nullptr;
+            other.m_isDone = true;
+        }
+        return *this;
+    }
+
+    SqliteCursor::~SqliteCursor()
+    {
+        Close();
+    }
+
+    void SqliteCursor::Open()
+    {
+        if (!m_statement.IsValid())
+        {
+            return;
+        }
+        m_lockedWrapper = m_statement.m_wrapper;
+        m_lockedWrapper->LockForCursor();
+        m_retValue = SQLITE_OK;
+        m_isDone = false;
+    }
+
+    bool SqliteCursor::IsValid() const
+    {
+        return m_lockedWrapper != nullptr;
+    }
+
+    bool SqliteCursor::Next()
+    {
+        if (m_isDone)
+        {
+            return false;
+        }
+        m_isStarted = true;
+        if (!m_statement.Step(m_retValue) || m_retValue != SQLITE_ROW)
+        {
+            // The statement is reset now so that its lock on the database does not last until Close()
+            m_isDone = true;
+            m_statement.Reset();
+            return false;
+        }
+        return true;
+    }
+
+    SqliteRow SqliteCursor::GetRow() const
+    {
+        return m_statement.GetRow();
+    }
+
+    int SqliteCursor::GetReturnCode() const
+    {
+        return m_retValue;
+    }
+
+    void SqliteCursor::Close()
+    {
+        m_statement.Release();
+        if (m_lockedWrapper)
+        {
+            m_lockedWrapper->UnlockForCursor();
+            m_lockedWrapper = nullptr;
+        }
+        m_lease.Release();
+        m_isDone = true;
+    }
+
+    SqliteCursor::Iterator SqliteCursor::begin()
+    {
+        if (!m_isStarted)
+        {
+            Next();
+        }
+        return Iterator(m_isDone ? nullptr : this);
+    }
+
+    SqliteCursor::Iterator SqliteCursor::end()
+    {
+        return Iterator(nullptr);
+    }
+
+    bool SqliteWrapper::OpenCursor(const char* statementText, SqliteCursor& cursor, int& retValue, std::vector<SqliteValue> const& values)
+    {
+        cursor.Close();
+        SqliteStatement statement;
+        if (!Prepare(statementText, statement, retValue))
+            return false;
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            if (!statement.BindValue((int)i + 1, values[i]))
+            {
+                retValue = SQLITE_RANGE;
+                return false;
+            }
+        }
+        cursor = SqliteCursor(std::move(statement));
+        return true;
+    }
+}
@@ -0,0 +1,120 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteCursor.h $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#pragma once
+#include "SqliteConnectionPool.h"
+#include <stddef.h>
+#include <iterator>
+
+namespace A3D
+{
+    //--------------------------------------------------------------------------------------
+    // Streaming read of the result of a statement: each row is stepped when the cursor
+    // advances, so any number of rows is read in constant memory, and the iteration can
+    // stop at any time. Works with a range-based for:
+    //
+    //     for (SqliteRow const& row : cursor) { ... }
+    //
+    // then GetReturnCode() tells if the iteration ended with an error. While it is open,
+    // the cursor holds the connection lock of its wrapper (the connection cannot be
+    // reopened under it) and, if given one, the lease of a pooled connection. The thread
+    // of the cursor keeps using the wrapper as usual; a cursor must be used and closed
+    // by the thread that opened it.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    class SqliteCursor
+    {
+    private:
+        SqliteConnectionLease m_lease;
+        SqliteWrapper* m_lockedWrapper;                              // Wrapper whose connection lock is held, nullptr once closed.
+        SqliteStatement m_statement;
+        int m_retValue;
+        bool m_isStarted;
+        bool m_isDone;
+
+        void Open();
+
+    public:
+        //--------------------------------------------------------------------------------------
+        // Input iterator on the rows of a cursor. All the iterators of a cursor share its
+        // current row: advancing one advances the cursor.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        class Iterator
+        {
+        private:
+            SqliteCursor* m_cursor;                                  // nullptr at the end.
+
+        public:
+            typedef std::input_iterator_tag iterator_category;
+            typedef SqliteRow value_type;
+            typedef ptrdiff_t difference_type;
+            typedef SqliteRow const* pointer;
+            typedef SqliteRow reference;
+
+            explicit Iterator(SqliteCursor* cursor);
+            SqliteRow operator*() const;
+            Iterator& operator++();
+            bool operator==(Iterator const& other) const;
+            bool operator!=(Iterator const& other) const;
+        };
+
+        SqliteCursor();
+
+        //--------------------------------------------------------------------------------------
+        // @description Open a cursor on a statement of a SqliteWrapper, its parameters bound.
+        // @param       statement   The statement, owned by the cursor from now on.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        explicit SqliteCursor(SqliteStatement&& statement);
+
+        //--------------------------------------------------------------------------------------
+        // @description Open a cursor on a statement of a pooled connection. The connection is
+        //              given back to the pool when the cursor is closed.
+        // @param       lease       The lease of the connection the statement was prepared on.
+        // @param       statement   The statement, owned by the cursor from now on.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        SqliteCursor(SqliteConnectionLease&& lease, SqliteStatement&& statement);
+
+        SqliteCursor(SqliteCursor&& other) noexcept;
+        SqliteCursor& operator=(SqliteCursor&& other) noexcept;
+        SqliteCursor(SqliteCursor const&) = delete;
+        SqliteCursor& operator=(SqliteCursor const&) = delete;
+        ~SqliteCursor();
+
+        //--------------------------------------------------------------------------------------
+        // @description   Check if the cursor holds a statement and is not closed.
+        // @return        True if valid, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool IsValid() const;
+
+        //--------------------------------------------------------------------------------------
+        // @description Step to the next row.
+        // @return      True if a row is available, false at the end of the result or on error.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool Next();
+
+        //--------------------------------------------------------------------------------------
+        // @description Return a view on the current row, valid until the cursor advances.
+        // @return      The row.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        SqliteRow GetRow() const;
+
+        //--------------------------------------------------------------------------------------
+        // @description Return the code of the last step.
+        // @return      SQLITE_ROW or SQLITE_DONE if everything went well, the error otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        int GetReturnCode() const;
+
+        //--------------------------------------------------------------------------------------
+        // @description Reset the statement and give it back, then release the connection lock
+        //              and the lease. Done by the destructor, the cursor becomes invalid.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void Close();
+
+        Iterator begin();
+        Iterator end();
+    };
+}
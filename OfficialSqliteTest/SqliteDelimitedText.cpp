@@ -0,0 +1,556 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteDelimitedText.cpp $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#include "SqliteDelimitedText.h"
+#include "SqliteCursor.h"
+#include "SqliteThreadPool.h"
+#include "SqliteWrapper.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <utility>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define A3D_DELIMITED_TEXT_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace A3D
+{
+#ifdef A3D_DELIMITED_TEXT_SSE2
+    static inline unsigned int firstBit(unsigned int mask)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return (unsigned int)index;
+#else
+        return (unsigned int)__builtin_ctz(mask);
+#endif
+    }
+#endif
+
+    SqliteMappedFile::SqliteMappedFile()
+        : m_data(nullptr),
+        m_size(0),
+#ifdef _WIN32
+        m_file(INVALID_HANDLE_VALUE),
+        m_mapping(nullptr)
+#else
+        m_file(-1)
+#endif
+    {
+    }
+
+    SqliteMappedFile::~SqliteMappedFile()
+    {
+        Close();
+    }
+
+    bool SqliteMappedFile::Open(const char* path)
+    {
+        Close();
+#ifdef _WIN32
+        m_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        LARGE_INTEGER size;
+        if (m_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_file, &size))
+        {
+            Close();
+            return false;
+        }
+        m_size = (size_t)size.QuadPart;
+        if (m_size == 0)
+            return true;
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        m_data = m_mapping ? static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+#else
+        m_file = open(path, O_RDONLY);
+        struct stat status;
+        if (m_file < 0 || fstat(m_file, &status) != 0)
+        {
+            Close();
+            return false;
+        }
+        m_size = (size_t)status.st_size;
+        if (m_size == 0)
+            return true;
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+        if (data != MAP_FAILED)
+        {
+            // The chunks are read once each, from the start of the file to its end
+            madvise(data, m_size, MADV_SEQUENTIAL);
+            m_data = static_cast<const char*>(data);
+        }
+#endif
+        if (!m_data)
+        {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void SqliteMappedFile::Close()
+    {
+#ifdef _WIN32
+        if (m_data)
+            UnmapViewOfFile(m_data);
+        if (m_mapping)
+            CloseHandle(m_mapping);
+        if (m_file != INVALID_HANDLE_VALUE)
+            CloseHandle(m_file);
+        m_mapping = nullptr;
+        m_file = INVALID_HANDLE_VALUE;
+#else
+        if (m_data)
+            munmap(const_cast<char*>(m_data), m_size);
+        if (m_file >= 0)
+            close(m_file);
+        m_file = -1;
+#endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    const char* SqliteMappedFile::GetData() const
+    {
+        return m_data;
+    }
+
+    size_t SqliteMappedFile::GetSize() const
+    {
+        return m_size;
+    }
+
+    SqliteDelimiterScanner::SqliteDelimiterScanner(char delimiter, char quote)
+        : m_delimiter(delimiter),
+        m_quote(quote)
+    {
+    }
+
+    size_t SqliteDelimiterScanner::FindSpecial(const char* data, size_t size) const
+    {
+        size_t position = 0;
+#ifdef A3D_DELIMITED_TEXT_SSE2
+        const __m128i delimiters = _mm_set1_epi8(m_delimiter);
+        const __m128i quotes = _mm_set1_epi8(m_quote);
+        const __m128i carriageReturns = _mm_set1_epi8('\r');
+        const __m128i lineFeeds = _mm_set1_epi8('\n');
+        for (; position + 16 <= size; position += 16)
+        {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position));
+            __m128i matches = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, delimiters), _mm_cmpeq_epi8(bytes, quotes)),
+                _mm_or_si128(_mm_cmpeq_epi8(bytes, carriageReturns), _mm_cmpeq_epi8(bytes, lineFeeds)));
+            unsigned int mask = (unsigned int)_mm_movemask_epi8(matches);
+            if (mask != 0)
+                return position + firstBit(mask);
+        }
+#endif
+        for (; position < size; ++position)
+        {
+            char c = data[position];
+            if (c == m_delimiter || c == m_quote || c == '\r' || c == '\n')
+                return position;
+        }
+        return size;
+    }
+
+    size_t SqliteDelimiterScanner::CountQuotes(const char* data, size_t size) const
+    {
+        size_t count = 0;
+        size_t position = 0;
+#ifdef A3D_DELIMITED_TEXT_SSE2
+        // Each byte of the accumulator counts up to 255 matches, summed by _mm_sad_epu8() before it can overflow
+        const __m128i quotes = _mm_set1_epi8(m_quote);
+        while (position + 16 <= size)
+        {
+            __m128i counts = _mm_setzero_si128();
+            for (int i = 0; i < 255 && position + 16 <= size; ++i, position += 16)
+            {
+                __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position));
+                counts = _mm_sub_epi8(counts, _mm_cmpeq_epi8(bytes, quotes));
+            }
+            __m128i sums = _mm_sad_epu8(counts, _mm_setzero_si128());
+            count += (size_t)_mm_cvtsi128_si32(sums) + (size_t)_mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+        }
+#endif
+        for (; position < size; ++position)
+        {
+            count += data[position] == m_quote;
+        }
+        return count;
+    }
+
+    size_t SqliteDelimiterScanner::FindChunkEnd(const char* data, size_t size, size_t begin, size_t chunkBytes) const
+    {
+        if (size - begin <= chunkBytes)
+            return size;
+
+        // Inside a quoted field if an odd number of quotes precede the position, "" escapes included
+        size_t position = begin + chunkBytes;
+        bool isQuoted = CountQuotes(data + begin, chunkBytes) % 2 != 0;
+        while (position < size)
+        {
+            if (isQuoted)
+            {
+                const char* quote = static_cast<const char*>(memchr(data + position, m_quote, size - position));
+                if (!quote)
+                    return size;
+                position = (size_t)(quote - data) + 1;
+                isQuoted = false;
+                continue;
+            }
+            position += FindSpecial(data + position, size - position);
+            if (position == size)
+                return size;
+            char c = data[position++];
+            if (c == '\n')
+                return position;
+            if (c == m_quote)
+                isQuoted = true;
+        }
+        return size;
+    }
+
+    size_t SqliteDelimiterScanner::Parse(const char* data, size_t size, bool emptyIsNull, std::vector<SqliteValue>& values, std::vector<size_t>& fieldCounts, size_t maxRecords) const
+    {
+        // An unquoted field, or what follows the closing quote of a quoted one, ends at the
+        // delimiter or at a line break; its quotes and lone CRs are kept
+        auto findFieldEnd = [&](size_t position)
+        {
+            while (true)
+            {
+                position += FindSpecial(data + position, size - position);
+                if (position < size && (data[position] == m_quote || (data[position] == '\r' && (position + 1 == size || data[position + 1] != '\n'))))
+                {
+                    ++position;
+                    continue;
+                }
+                return position;
+            }
+        };
+
+        size_t position = 0;
+        size_t records = 0;
+        std::string text;
+        while (position < size && (maxRecords == 0 || records < maxRecords))
+        {
+            if (data[position] == '\n')
+            {
+                ++position;
+                continue;
+            }
+            if (data[position] == '\r' && position + 1 < size && data[position + 1] == '\n')
+            {
+                position += 2;
+                continue;
+            }
+
+            size_t fieldCount = 0;
+            while (true)
+            {
+                if (position < size && data[position] == m_quote)
+                {
+                    // Up to the closing quote, "" standing for one quote. An unterminated field takes the rest of the input.
+                    text.clear();
+                    ++position;
+                    while (true)
+                    {
+                        const char* quote = static_cast<const char*>(memchr(data + position, m_quote, size - position));
+                        size_t quotePosition = quote ? (size_t)(quote - data) : size;
+                        text.append(data + position, quotePosition - position);
+                        position = quotePosition + 1;
+                        if (position >= size || data[position] != m_quote)
+                            break;
+                        text += m_quote;
+                        ++position;
+                    }
+                    position = std::min(position, size);
+                    size_t end = findFieldEnd(position);
+                    text.append(data + position, end - position);
+                    position = end;
+                    values.emplace_back(text);
+                }
+                else
+                {
+                    size_t start = position;
+                    position = findFieldEnd(position);
+                    if (position == start && emptyIsNull)
+                        values.emplace_back();
+                    else
+                        values.emplace_back(data + start, (int)(position - start));
+                }
+                ++fieldCount;
+
+                if (position < size && data[position] == m_delimiter)
+                {
+                    ++position;
+                    continue;
+                }
+                if (position < size && data[position] == '\r')
+                    ++position;
+                if (position < size)
+                    ++position;
+                break;
+            }
+            fieldCounts.push_back(fieldCount);
+            ++records;
+        }
+        return position;
+    }
+
+    void SqliteDelimiterScanner::AppendField(std::string& output, const char* text, size_t size) const
+    {
+        // An empty string is quoted, so that it is not read back as NULL
+        if (size > 0 && FindSpecial(text, size) == size)
+        {
+            output.append(text, size);
+            return;
+        }
+        output += m_quote;
+        while (size > 0)
+        {
+            const char* quote = static_cast<const char*>(memchr(text, m_quote, size));
+            size_t length = quote ? (size_t)(quote - text) + 1 : size;
+            output.append(text, length);
+            if (quote)
+                output += m_quote;
+            text += length;
+            size -= length;
+        }
+        output += m_quote;
+    }
+
+    bool SqliteWrapper::ImportDelimitedText(const char* filePath, const char* tableName, int& retValue, SqliteDelimitedTextOptions const& options, size_t* pnImportedRows)
+    {
+        retValue = 0;
+        if (pnImportedRows)
+            *pnImportedRows = 0;
+
+        SqliteMappedFile file;
+        if (!file.Open(filePath))
+        {
+            std::cout << "ImportDelimitedText: could not map " << filePath << std::endl;
+            retValue = SQLITE_CANTOPEN;
+            return false;
+        }
+        const char* data = file.GetData();
+        size_t size = file.GetSize();
+        SqliteDelimiterScanner scanner(options.delimiter, options.quote);
+
+        // The first record names the columns of a new table, and is skipped if it is a header
+        std::vector<SqliteValue> firstRecord;
+        std::vector<size_t> firstFieldCounts;
+        size_t headerEnd = scanner.Parse(data, size, false, firstRecord, firstFieldCounts, 1);
+        size_t position = options.hasHeader ? headerEnd : 0;
+        if (options.createTable && !firstRecord.empty())
+        {
+            bool tableExists = false;
+            SqliteStatement statement;
+            if (!Prepare("SELECT 1 FROM pragma_table_info(?1)", statement, retValue))
+                return false;
+            statement.BindText(1, tableName);
+            if (!statement.ForEachRow(retValue, [&](SqliteRow const&) { tableExists = true; return false; }))
+                return false;
+            statement.Release();
+            if (!tableExists)
+            {
+                std::string createText = "CREATE TABLE " + QuoteIdentifier(tableName) + "(";
+                for (size_t i = 0; i < firstRecord.size(); ++i)
+                {
+                    std::string columnName = options.hasHeader ? firstRecord[i].GetBytes() : "c" + std::to_string(i + 1);
+                    createText += (i == 0 ? "" : ", ") + QuoteIdentifier(columnName) + " TEXT";
+                }
+                createText += ")";
+                if (!ExecStatement(createText.c_str(), retValue))
+                {
+                    std::cout << "ImportDelimitedText: could not create table " << tableName << ": " << LastErrorMessage() << std::endl;
+                    return false;
+                }
+            }
+        }
+
+        // Chunks are parsed in parallel, a few ahead of the rows loaded by this thread, and
+        // handed over in file order
+        struct Chunk
+        {
+            std::vector<SqliteValue> values;
+            std::vector<size_t> fieldCounts;
+        };
+        SqliteThreadPool parsers(options.parserThreads);
+        size_t maxPendingChunks = parsers.GetThreadCount() * 2;
+        std::deque<std::pair<std::shared_ptr<Chunk>, std::future<void>>> pendingChunks;
+        auto submitChunks = [&]()
+        {
+            while (position < size && pendingChunks.size() < maxPendingChunks)
+            {
+                size_t begin = position;
+                size_t end = scanner.FindChunkEnd(data, size, begin, options.chunkBytes);
+                std::shared_ptr<Chunk> chunk = std::make_shared<Chunk>();
+                std::future<void> parsed = parsers.Submit([&scanner, &options, data, begin, end, chunk]()
+                {
+                    scanner.Parse(data + begin, end - begin, options.emptyIsNull, chunk->values, chunk->fieldCounts);
+                });
+                pendingChunks.emplace_back(std::move(chunk), std::move(parsed));
+                position = end;
+            }
+        };
+
+        std::shared_ptr<Chunk> chunk;
+        size_t recordIndex = 0;
+        size_t valueIndex = 0;
+        SqliteRowSource rowSource = [&](std::vector<SqliteValue>& row)
+        {
+            while (!chunk || recordIndex == chunk->fieldCounts.size())
+            {
+                chunk.reset();
+                submitChunks();
+                if (pendingChunks.empty())
+                    return false;
+                pendingChunks.front().second.get();
+                chunk = std::move(pendingChunks.front().first);
+                pendingChunks.pop_front();
+                recordIndex = 0;
+                valueIndex = 0;
+            }
+            size_t fieldCount = chunk->fieldCounts[recordIndex++];
+            row.resize(fieldCount);
+            for (size_t i = 0; i < fieldCount; ++i)
+            {
+                row[i] = std::move(chunk->values[valueIndex++]);
+            }
+            return true;
+        };
+        return BulkLoad(tableName, rowSource, retValue, options.load, pnImportedRows);
+    }
+
+    bool SqliteWrapper::ExportDelimitedText(const char* statementText, const char* filePath, int& retValue, SqliteDelimitedTextOptions const& options, size_t* pnExportedRows, std::vector<SqliteValue> const& values)
+    {
+        retValue = 0;
+        if (pnExportedRows)
+            *pnExportedRows = 0;
+
+        // The columns are known once prepared, the cursor only sees them on its rows
+        SqliteStatement statement;
+        if (!Prepare(statementText, statement, retValue))
+            return false;
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            if (!statement.BindValue((int)i + 1, values[i]))
+            {
+                retValue = SQLITE_RANGE;
+                return false;
+            }
+        }
+        int columnCount = sqlite3_a3d_column_count(statement.GetHandle());
+        std::string header;
+        SqliteDelimiterScanner scanner(options.delimiter, options.quote);
+        for (int column = 0; options.hasHeader && column < columnCount; ++column)
+        {
+            const char* columnName = sqlite3_a3d_column_name(statement.GetHandle(), column);
+            if (column > 0)
+                header += options.delimiter;
+            scanner.AppendField(header, columnName, strlen(columnName));
+        }
+        if (options.hasHeader)
+            header += '\n';
+        SqliteCursor cursor(std::move(statement));
+        FILE* file = fopen(filePath, "wb");
+        if (!file)
+        {
+            std::cout << "ExportDelimitedText: could not create " << filePath << std::endl;
+            retValue = SQLITE_CANTOPEN;
+            return false;
+        }
+
+        // A full buffer is written by another thread while the next one is filled
+        SqliteThreadPool writer(1);
+        std::future<void> pendingWrite;
+        std::string buffer;
+        std::string writtenBuffer;
+        bool writeFailed = false;
+        auto flush = [&]()
+        {
+            if (pendingWrite.valid())
+                pendingWrite.get();
+            writtenBuffer.swap(buffer);
+            buffer.clear();
+            pendingWrite = writer.Submit([&]()
+            {
+                if (!writtenBuffer.empty() && fwrite(writtenBuffer.data(), 1, writtenBuffer.size(), file) != writtenBuffer.size())
+                    writeFailed = true;
+            });
+        };
+        buffer.reserve(options.outputBufferBytes + 4096);
+        buffer = header;
+
+        SqliteRow row = cursor.GetRow();
+        size_t exportedRows = 0;
+        while (cursor.Next())
+        {
+            for (int column = 0; column < columnCount; ++column)
+            {
+                if (column > 0)
+                    buffer += options.delimiter;
+                if (!row.IsNull(column))
+                {
+                    std::string_view text = row.GetText(column);
+                    scanner.AppendField(buffer, text.data(), text.size());
+                }
+            }
+            buffer += '\n';
+            ++exportedRows;
+            if (buffer.size() >= options.outputBufferBytes)
+            {
+                flush();
+                if (writeFailed)
+                    break;
+            }
+        }
+        int cursorRetValue = cursor.GetReturnCode();
+        cursor.Close();
+        flush();
+        pendingWrite.get();
+        if (fclose(file) != 0)
+            writeFailed = true;
+
+        if (pnExportedRows)
+            *pnExportedRows = exportedRows;
+        if (writeFailed)
+        {
+            std::cout << "ExportDelimitedText: could not write " << filePath << std::endl;
+            retValue = SQLITE_IOERR;
+            return false;
+        }
+        if (cursorRetValue != SQLITE_DONE)
+        {
+            std::cout << "ExportDelimitedText: " << sqlite3_a3d_errstr(cursorRetValue) << std::endl;
+            retValue = cursorRetValue;
+            return false;
+        }
+        return true;
+    }
+}
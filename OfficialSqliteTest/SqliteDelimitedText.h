@@ -0,0 +1,124 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteDelimitedText.h $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#pragma once
+#include "SqliteBulkLoad.h"
+#include "SqliteValue.h"
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace A3D
+{
+    //--------------------------------------------------------------------------------------
+    // Settings of SqliteWrapper::ImportDelimitedText() and ExportDelimitedText(). Fields
+    // follow RFC 4180: a field holding the delimiter, a quote or a line break is quoted,
+    // and its quotes are doubled. Records end with LF or CRLF.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    struct SqliteDelimitedTextOptions
+    {
+        char delimiter = ',';                                        // ',' for CSV, '\t' for TSV.
+        char quote = '"';
+        bool hasHeader = true;                                       // The first record holds the column names.
+        bool emptyIsNull = false;                                    // Import an unquoted empty field as NULL. Exports write NULL as an empty field and the empty string as "" either way.
+        bool createTable = true;                                     // Import into a new table if it does not exist, with a TEXT column per field of the first record.
+        size_t chunkBytes = 4 * 1024 * 1024;                         // Input parsed by one task. Records never span two chunks.
+        size_t parserThreads = 0;                                    // Threads parsing the chunks. 0 = one per hardware thread.
+        size_t outputBufferBytes = 1024 * 1024;                      // Output written by each fwrite() of an export.
+        SqliteBulkLoadOptions load;                                  // Transactions, indexes and pragmas of the import.
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Read-only mapping of a whole file in memory.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    class SqliteMappedFile
+    {
+    private:
+        const char* m_data;
+        size_t m_size;
+#ifdef _WIN32
+        void* m_file;
+        void* m_mapping;
+#else
+        int m_file;
+#endif
+
+    public:
+        SqliteMappedFile();
+        SqliteMappedFile(SqliteMappedFile const&) = delete;
+        SqliteMappedFile& operator=(SqliteMappedFile const&) = delete;
+        ~SqliteMappedFile();
+
+        //--------------------------------------------------------------------------------------
+        // @description Map a file, unmapping the previous one.
+        // @param       path    The file.
+        // @return      False if it could not be opened or mapped, true otherwise. An empty file
+        //              is mapped with a null data pointer.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool Open(const char* path);
+        void Close();
+
+        const char* GetData() const;
+        size_t GetSize() const;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Finds the bytes that end an unquoted field: the delimiter, the quote, CR and LF. Uses
+    // SSE2 where available, 16 bytes per iteration, and a byte loop otherwise.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    class SqliteDelimiterScanner
+    {
+    private:
+        char m_delimiter;
+        char m_quote;
+
+    public:
+        SqliteDelimiterScanner(char delimiter, char quote);
+
+        //--------------------------------------------------------------------------------------
+        // @description Find the first special byte of a range.
+        // @return      Its offset, or size if there is none.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        size_t FindSpecial(const char* data, size_t size) const;
+
+        //--------------------------------------------------------------------------------------
+        // @description Count the quotes of a range, to know if its end is inside a quoted field.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        size_t CountQuotes(const char* data, size_t size) const;
+
+        //--------------------------------------------------------------------------------------
+        // @description Find the end of the chunk starting at 'begin'. Quotes are only paired,
+        //              not parsed, so quotes inside unquoted fields must come in pairs too.
+        // @param       data        The whole input.
+        // @param       size        Its size.
+        // @param       begin       Start of a record.
+        // @param       chunkBytes  Minimum size of the chunk.
+        // @return      The offset just after the first line break outside quotes past
+        //              begin + chunkBytes, or size.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        size_t FindChunkEnd(const char* data, size_t size, size_t begin, size_t chunkBytes) const;
+
+        //--------------------------------------------------------------------------------------
+        // @description Parse the records of a range. Empty lines are skipped.
+        // @param       data            Start of a record.
+        // @param       size            Size of the range, ending at the end of a record.
+        // @param       emptyIsNull     Parse an unquoted empty field as NULL.
+        // @param       values          Receives the fields of all the records, one after the other.
+        // @param       fieldCounts     Receives the number of fields of each record.
+        // @param       maxRecords      Stop after that many records. 0 = no limit.
+        // @return      The offset after the last parsed record.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        size_t Parse(const char* data, size_t size, bool emptyIsNull, std::vector<SqliteValue>& values, std::vector<size_t>& fieldCounts, size_t maxRecords = 0) const;
+
+        //--------------------------------------------------------------------------------------
+        // @description Append a field to an output buffer, quoted if needed. An empty text
+        //              is always quoted.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void AppendField(std::string& output, const char* text, size_t size) const;
+    };
+}
@@ -0,0 +1,297 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteMetrics.cpp $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#include "SqliteMetrics.h"
+
+#include <algorithm>
+#include <ctype.h>
+
+namespace A3D
+{
+    SqliteLatencyHistogram::SqliteLatencyHistogram()
+    {
+        Clear();
+    }
+
+    int SqliteLatencyHistogram::GetBucket(uint64_t ns)
+    {
+        if (ns < SubBucketCount)
+        {
+            return (int)ns;
+        }
+        int highestBit = 0;
+        for (int shift = 32; shift > 0; shift >>= 1)
+        {
+            if (ns >> (highestBit + shift))
+                highestBit += shift;
+        }
+        // Power of two in the upper bits, then the next SubBucketBits bits select the sub-bucket
+        int subBucket = (int)((ns >> (highestBit - SubBucketBits)) & (SubBucketCount - 1));
+        return (highestBit - SubBucketBits + 1) * SubBucketCount + subBucket;
+    }
+
+    uint64_t SqliteLatencyHistogram::GetBucketValue(int bucket)
+    {
+        if (bucket < SubBucketCount)
+        {
+            return (uint64_t)bucket;
+        }
+        int shift = bucket / SubBucketCount - 1;
+        uint64_t lower = (uint64_t)(SubBucketCount + bucket % SubBucketCount) << shift;
+        // Middle of the bucket
+        return lower + ((uint64_t(1) << shift) >> 1);
+    }
+
+    void SqliteLatencyHistogram::Record(uint64_t ns)
+    {
+        m_buckets[GetBucket(ns)].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_totalNs.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t maxNs = m_maxNs.load(std::memory_order_relaxed);
+        while (ns > maxNs && !m_maxNs.compare_exchange_weak(maxNs, ns, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void SqliteLatencyHistogram::Clear()
+    {
+        for (std::atomic<uint64_t>& bucket : m_buckets)
+        {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        m_count.store(0, std::memory_order_relaxed);
+        m_totalNs.store(0, std::memory_order_relaxed);
+        m_maxNs.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t SqliteLatencyHistogram::GetCount() const
+    {
+        return m_count.load(std::memory_order_relaxed);
+    }
+
+    uint64_t SqliteLatencyHistogram::GetTotalNs() const
+    {
+        return m_totalNs.load(std::memory_order_relaxed);
+    }
+
+    uint64_t SqliteLatencyHistogram::GetMaxNs() const
+    {
+        return m_maxNs.load(std::memory_order_relaxed);
+    }
+
+    uint64_t SqliteLatencyHistogram::GetQuantileNs(double quantile) const
+    {
+        // Buckets are read one by one while other threads record: the sum is only approximately consistent
+        uint64_t total = 0;
+        for (std::atomic<uint64_t> const& bucket : m_buckets)
+        {
+            total += bucket.load(std::memory_order_relaxed);
+        }
+        if (total == 0)
+        {
+            return 0;
+        }
+
+        uint64_t rank = (uint64_t)(quantile * (double)total);
+        if (rank >= total)
+        {
+            rank = total - 1;
+        }
+        uint64_t seen = 0;
+        for (int bucket = 0; bucket < BucketCount; ++bucket)
+        {
+            seen += m_buckets[bucket].load(std::memory_order_relaxed);
+            if (seen > rank)
+            {
+                return std::min(GetBucketValue(bucket), GetMaxNs());
+            }
+        }
+        return GetMaxNs();
+    }
+
+    SqliteMetrics::SqliteMetrics()
+        : m_busyRetries(0),
+        m_reconnects(0),
+        m_lockWaits(0),
+        m_lockWaitNs(0),
+        m_checkpointedFrames(0),
+        m_backpressureWaits(0),
+        m_backpressureWaitNs(0)
+    {
+    }
+
+    std::string SqliteMetrics::Normalize(const char* statementText)
+    {
+        std::string normalized;
+        const char* c = statementText;
+        while (*c)
+        {
+            if (isspace((unsigned char)*c))
+            {
+                while (isspace((unsigned char)*c))
+                    ++c;
+                if (!normalized.empty() && *c)
+                    normalized += ' ';
+            }
+            else if (*c == '\'' || ((*c == 'x' || *c == 'X') && c[1] == '\''))
+            {
+                // String or blob literal, quotes doubled inside
+                c += *c == '\'' ? 1 : 2;
+                while (*c && !(*c == '\'' && c[1] != '\''))
+                {
+                    c += *c == '\'' ? 2 : 1;
+                }
+                if (*c)
+                    ++c;
+                normalized += '?';
+            }
+            else if (*c == '"' || *c == '`' || *c == '[')
+            {
+                // Quoted identifier, kept as is
+                char close = *c == '[' ? ']' : *c;
+                normalized += *c++;
+                while (*c && *c != close)
+                    normalized += *c++;
+                if (*c)
+                    normalized += *c++;
+            }
+            else if (*c == '?')
+            {
+                // Numbered parameter
+                ++c;
+                while (isdigit((unsigned char)*c))
+                    ++c;
+                normalized += '?';
+            }
+            else if (isdigit((unsigned char)*c) || (*c == '.' && isdigit((unsigned char)c[1])))
+            {
+                // Numeric literal, including hexadecimal and exponent forms
+                while (isalnum((unsigned char)*c) || *c == '.' || ((*c == '+' || *c == '-') && (c[-1] == 'e' || c[-1] == 'E')))
+                    ++c;
+                normalized += '?';
+            }
+            else if (isalpha((unsigned char)*c) || *c == '_')
+            {
+                // Identifiers may contain digits
+                while (isalnum((unsigned char)*c) || *c == '_' || *c == '$')
+                    normalized += *c++;
+            }
+            else
+            {
+                normalized += *c++;
+            }
+        }
+        return normalized;
+    }
+
+    SqliteStatementCounters* SqliteMetrics::GetCounters(const char* statementText)
+    {
+        std::string normalized = Normalize(statementText);
+        std::lock_guard<std::mutex> lock(m_statementsMutex);
+        std::unique_ptr<SqliteStatementCounters>& counters = m_statements[normalized];
+        if (!counters)
+        {
+            counters.reset(new SqliteStatementCounters());
+            counters->statementText = normalized;
+        }
+        return counters.get();
+    }
+
+    void SqliteMetrics::RecordBusyRetries(int retries)
+    {
+        m_busyRetries.fetch_add((uint64_t)retries, std::memory_order_relaxed);
+    }
+
+    void SqliteMetrics::RecordReconnect()
+    {
+        m_reconnects.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void SqliteMetrics::RecordLockWait(uint64_t ns)
+    {
+        m_lockWaits.fetch_add(1, std::memory_order_relaxed);
+        m_lockWaitNs.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    void SqliteMetrics::RecordCheckpoint(uint64_t ns, int frames)
+    {
+        m_checkpoints.Record(ns);
+        m_checkpointedFrames.fetch_add(frames > 0 ? (uint64_t)frames : 0, std::memory_order_relaxed);
+    }
+
+    void SqliteMetrics::RecordBackpressure(uint64_t ns)
+    {
+        m_backpressureWaits.fetch_add(1, std::memory_order_relaxed);
+        m_backpressureWaitNs.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    SqliteMetricsSnapshot SqliteMetrics::GetSnapshot()
+    {
+        SqliteMetricsSnapshot snapshot;
+        snapshot.busyRetries = m_busyRetries.load(std::memory_order_relaxed);
+        snapshot.reconnects = m_reconnects.load(std::memory_order_relaxed);
+        snapshot.lockWaits = m_lockWaits.load(std::memory_order_relaxed);
+        snapshot.lockWaitNs = m_lockWaitNs.load(std::memory_order_relaxed);
+        snapshot.checkpoints = m_checkpoints.GetCount();
+        snapshot.checkpointNs = m_checkpoints.GetTotalNs();
+        snapshot.checkpointP99Ns = m_checkpoints.GetQuantileNs(0.99);
+        snapshot.checkpointMaxNs = m_checkpoints.GetMaxNs();
+        snapshot.checkpointedFrames = m_checkpointedFrames.load(std::memory_order_relaxed);
+        snapshot.backpressureWaits = m_backpressureWaits.load(std::memory_order_relaxed);
+        snapshot.backpressureWaitNs = m_backpressureWaitNs.load(std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(m_statementsMutex);
+        snapshot.statements.reserve(m_statements.size());
+        for (auto const& item : m_statements)
+        {
+            SqliteStatementCounters const& counters = *item.second;
+            if (counters.latency.GetCount() == 0)
+                continue;
+
+            SqliteStatementMetrics metrics;
+            metrics.statementText = counters.statementText;
+            metrics.calls = counters.latency.GetCount();
+            metrics.errors = counters.errors.load(std::memory_order_relaxed);
+            metrics.rows = counters.rows.load(std::memory_order_relaxed);
+            metrics.busyRetries = counters.busyRetries.load(std::memory_order_relaxed);
+            metrics.totalNs = counters.latency.GetTotalNs();
+            metrics.lockWaitNs = counters.lockWaitNs.load(std::memory_order_relaxed);
+            metrics.p50Ns = counters.latency.GetQuantileNs(0.50);
+            metrics.p99Ns = counters.latency.GetQuantileNs(0.99);
+            metrics.p999Ns = counters.latency.GetQuantileNs(0.999);
+            metrics.maxNs = counters.latency.GetMaxNs();
+            snapshot.statements.push_back(metrics);
+        }
+        std::sort(snapshot.statements.begin(), snapshot.statements.end(),
+            [](SqliteStatementMetrics const& a, SqliteStatementMetrics const& b) { return a.totalNs > b.totalNs; });
+        return snapshot;
+    }
+
+    void SqliteMetrics::Clear()
+    {
+        m_busyRetries.store(0, std::memory_order_relaxed);
+        m_reconnects.store(0, std::memory_order_relaxed);
+        m_lockWaits.store(0, std::memory_order_relaxed);
+        m_lockWaitNs.store(0, std::memory_order_relaxed);
+        m_checkpoints.Clear();
+        m_checkpointedFrames.store(0, std::memory_order_relaxed);
+        m_backpressureWaits.store(0, std::memory_order_relaxed);
+        m_backpressureWaitNs.store(0, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(m_statementsMutex);
+        for (auto& item : m_statements)
+        {
+            SqliteStatementCounters& counters = *item.second;
+            counters.latency.Clear();
+            counters.errors.store(0, std::memory_order_relaxed);
+            counters.rows.store(0, std::memory_order_relaxed);
+            counters.busyRetries.store(0, std::memory_order_relaxed);
+            counters.lockWaitNs.store(0, std::memory_order_relaxed);
+        }
+    }
+}
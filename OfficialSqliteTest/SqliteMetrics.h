@@ -0,0 +1,158 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteMetrics.h $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace A3D
+{
+    //--------------------------------------------------------------------------------------
+    // Latency histogram with logarithmic buckets, each power of two being split in 8
+    // linear sub-buckets: quantiles are exact to 12.5%, from 1ns to centuries. Recording
+    // is lock-free and may happen from any thread.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    class SqliteLatencyHistogram
+    {
+    private:
+        static const int SubBucketBits = 3;
+        static const int SubBucketCount = 1 << SubBucketBits;
+        static const int BucketCount = (64 - SubBucketBits + 1) * SubBucketCount;
+
+        std::atomic<uint64_t> m_buckets[BucketCount];
+        std::atomic<uint64_t> m_count;
+        std::atomic<uint64_t> m_totalNs;
+        std::atomic<uint64_t> m_maxNs;
+
+        static int GetBucket(uint64_t ns);
+        static uint64_t GetBucketValue(int bucket);
+
+    public:
+        SqliteLatencyHistogram();
+
+        void Record(uint64_t ns);
+        void Clear();
+
+        uint64_t GetCount() const;
+        uint64_t GetTotalNs() const;
+        uint64_t GetMaxNs() const;
+
+        //--------------------------------------------------------------------------------------
+        // @description Return a quantile of the recorded latencies.
+        // @param       quantile    Between 0 and 1, for instance 0.99.
+        // @return      The latency (ns), 0 if nothing was recorded.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        uint64_t GetQuantileNs(double quantile) const;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Live counters of one normalized SQL statement. The latency is the time spent in
+    // SQLite, the wait for the connection lock is counted apart.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    struct SqliteStatementCounters
+    {
+        std::string statementText;                                   // Normalized, with '?' in place of the literals.
+        SqliteLatencyHistogram latency;
+        std::atomic<uint64_t> errors{0};
+        std::atomic<uint64_t> rows{0};
+        std::atomic<uint64_t> busyRetries{0};
+        std::atomic<uint64_t> lockWaitNs{0};
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Copy of the counters of one statement, see SqliteWrapper::GetMetrics().
+    //+---------------+---------------+---------------+---------------+---------------+------
+    struct SqliteStatementMetrics
+    {
+        std::string statementText;
+        uint64_t calls = 0;
+        uint64_t errors = 0;
+        uint64_t rows = 0;
+        uint64_t busyRetries = 0;
+        uint64_t totalNs = 0;
+        uint64_t lockWaitNs = 0;
+        uint64_t p50Ns = 0;
+        uint64_t p99Ns = 0;
+        uint64_t p999Ns = 0;
+        uint64_t maxNs = 0;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Copy of all the counters of a wrapper, statements sorted by decreasing total time.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    struct SqliteMetricsSnapshot
+    {
+        std::vector<SqliteStatementMetrics> statements;
+        uint64_t busyRetries = 0;
+        uint64_t reconnects = 0;
+        uint64_t lockWaits = 0;                                      // Number of acquisitions of the connection lock.
+        uint64_t lockWaitNs = 0;                                     // Total time spent waiting for it.
+        uint64_t checkpoints = 0;                                    // Checkpoints of the background checkpointer.
+        uint64_t checkpointNs = 0;
+        uint64_t checkpointP99Ns = 0;
+        uint64_t checkpointMaxNs = 0;
+        uint64_t checkpointedFrames = 0;
+        uint64_t backpressureWaits = 0;                              // Commits held back because the WAL passed its hard limit.
+        uint64_t backpressureWaitNs = 0;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Counters of a SqliteWrapper, grouped by normalized SQL text so that requests that
+    // only differ by their literals share their counters.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    class SqliteMetrics
+    {
+    private:
+        std::mutex m_statementsMutex;
+        std::unordered_map<std::string, std::unique_ptr<SqliteStatementCounters>> m_statements; // Never erased: counters are referenced by the statement cache.
+
+        std::atomic<uint64_t> m_busyRetries;
+        std::atomic<uint64_t> m_reconnects;
+        std::atomic<uint64_t> m_lockWaits;
+        std::atomic<uint64_t> m_lockWaitNs;
+        SqliteLatencyHistogram m_checkpoints;
+        std::atomic<uint64_t> m_checkpointedFrames;
+        std::atomic<uint64_t> m_backpressureWaits;
+        std::atomic<uint64_t> m_backpressureWaitNs;
+
+    public:
+        SqliteMetrics();
+
+        //--------------------------------------------------------------------------------------
+        // @description Replace numbers, strings and blobs literals by '?' and collapse blanks.
+        // @param       statementText   The SQL text.
+        // @return      The normalized text.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        static std::string Normalize(const char* statementText);
+
+        //--------------------------------------------------------------------------------------
+        // @description Return the counters of a statement, created on first use.
+        // @param       statementText   The SQL text, normalized by this call.
+        // @return      The counters, valid as long as this object.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        SqliteStatementCounters* GetCounters(const char* statementText);
+
+        void RecordBusyRetries(int retries);
+        void RecordReconnect();
+        void RecordLockWait(uint64_t ns);
+        void RecordCheckpoint(uint64_t ns, int frames);
+        void RecordBackpressure(uint64_t ns);
+
+        SqliteMetricsSnapshot GetSnapshot();
+
+        //--------------------------------------------------------------------------------------
+        // @description Set all counters back to zero.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void Clear();
+    };
+}
@@ -0,0 +1,228 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteMultiRowInsert.cpp $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#include "SqliteMultiRowInsert.h"
+#include "SqliteWrapper.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace A3D
+{
+    static std::string JoinIdentifiers(std::vector<std::string> const& names)
+    {
+        std::string joined;
+        for (size_t i = 0; i < names.size(); ++i)
+        {
+            if (i > 0)
+                joined += ", ";
+            joined += SqliteWrapper::QuoteIdentifier(names[i]);
+        }
+        return joined;
+    }
+
+    SqliteMultiRowInsert::SqliteMultiRowInsert()
+        : m_wrapper(nullptr),
+        m_columnCount(0),
+        m_rowsPerStatement(0),
+        m_pendingRows(0),
+        m_insertedRows(0)
+    {
+    }
+
+    SqliteMultiRowInsert::~SqliteMultiRowInsert()
+    {
+        Release();
+    }
+
+    bool SqliteMultiRowInsert::IsValid() const
+    {
+        return m_wrapper != nullptr;
+    }
+
+    std::string SqliteMultiRowInsert::GetStatementText(size_t rowCount) const
+    {
+        std::string row = "(?";
+        for (size_t i = 1; i < m_columnCount; ++i)
+        {
+            row += ", ?";
+        }
+        row += ")";
+
+        std::string statementText;
+        statementText.reserve(m_insertText.size() + rowCount * (row.size() + 2) + m_conflictText.size());
+        statementText = m_insertText;
+        for (size_t i = 0; i < rowCount; ++i)
+        {
+            if (i > 0)
+                statementText += ", ";
+            statementText += row;
+        }
+        statementText += m_conflictText;
+        return statementText;
+    }
+
+    bool SqliteMultiRowInsert::InsertPending(SqliteStatement& statement, int& retValue)
+    {
+        size_t valueCount = m_pendingRows * m_columnCount;
+        m_pendingRows = 0;
+        for (size_t i = 0; i < valueCount; ++i)
+        {
+            if (!statement.BindValue((int)i + 1, m_pendingValues[i]))
+            {
+                retValue = SQLITE_RANGE;
+                return false;
+            }
+        }
+        int updatedRows = 0;
+        bool succeeded = statement.Step(retValue, &updatedRows) && retValue == SQLITE_DONE;
+        statement.Reset();
+        if (succeeded)
+            m_insertedRows += (size_t)updatedRows;
+        return succeeded;
+    }
+
+    bool SqliteMultiRowInsert::AddRow(std::vector<SqliteValue> const& row, int& retValue)
+    {
+        if (!IsValid() || row.size() != m_columnCount)
+        {
+            std::cout << "MultiRowInsert: a row has " << row.size() << " values instead of " << m_columnCount << std::endl;
+            retValue = SQLITE_RANGE;
+            return false;
+        }
+        // The values already in the slots of the batch are overwritten, keeping their buffers
+        std::copy(row.begin(), row.end(), m_pendingValues.begin() + m_pendingRows * m_columnCount);
+        if (++m_pendingRows < m_rowsPerStatement)
+            return true;
+        return InsertPending(m_batchStatement, retValue);
+    }
+
+    bool SqliteMultiRowInsert::Flush(int& retValue)
+    {
+        if (m_pendingRows == 0)
+        {
+            retValue = SQLITE_DONE;
+            return true;
+        }
+        SqliteStatement tailStatement;
+        if (!m_wrapper->Prepare(GetStatementText(m_pendingRows).c_str(), tailStatement, retValue))
+        {
+            m_pendingRows = 0;
+            return false;
+        }
+        bool succeeded = InsertPending(tailStatement, retValue);
+        tailStatement.Release();
+        return succeeded;
+    }
+
+    void SqliteMultiRowInsert::Release()
+    {
+        m_batchStatement.Release();
+        m_wrapper = nullptr;
+        m_insertText.clear();
+        m_conflictText.clear();
+        m_columnCount = 0;
+        m_rowsPerStatement = 0;
+        m_pendingValues.clear();
+        m_pendingRows = 0;
+        m_insertedRows = 0;
+    }
+
+    size_t SqliteMultiRowInsert::GetRowsPerStatement() const
+    {
+        return m_rowsPerStatement;
+    }
+
+    size_t SqliteMultiRowInsert::GetPendingRowCount() const
+    {
+        return m_pendingRows;
+    }
+
+    size_t SqliteMultiRowInsert::GetInsertedRowCount() const
+    {
+        return m_insertedRows;
+    }
+
+    bool SqliteWrapper::PrepareMultiRowInsert(const char* tableName, SqliteMultiRowInsert& insert, int& retValue, SqliteMultiRowInsertOptions const& options)
+    {
+        insert.Release();
+        std::vector<std::string> columns = options.columns;
+        if (columns.empty())
+        {
+            SqliteStatement statement;
+            if (!Prepare("SELECT name FROM pragma_table_info(?1)", statement, retValue))
+                return false;
+            statement.BindText(1, tableName);
+            bool succeeded = statement.ForEachRow(retValue, [&columns](SqliteRow const& row)
+            {
+                columns.emplace_back(row.GetText(0));
+                return true;
+            });
+            statement.Release();
+            if (!succeeded)
+                return false;
+            if (columns.empty())
+            {
+                std::cout << "MultiRowInsert: no such table: " << tableName << std::endl;
+                retValue = SQLITE_ERROR;
+                return false;
+            }
+        }
+
+        // Each row takes one parameter per column
+        int maxParameters = sqlite3_a3d_limit(GetHandle(), SQLITE_LIMIT_VARIABLE_NUMBER, -1);
+        size_t maxRows = (size_t)std::max(maxParameters, 0) / columns.size();
+        if (maxRows == 0)
+        {
+            std::cout << "MultiRowInsert: " << columns.size() << " columns exceed the " << maxParameters << " parameters of a statement" << std::endl;
+            retValue = SQLITE_RANGE;
+            return false;
+        }
+
+        std::string conflictText;
+        if (!options.conflictColumns.empty())
+        {
+            std::vector<std::string> updateColumns = options.updateColumns;
+            if (updateColumns.empty())
+            {
+                for (std::string const& column : columns)
+                {
+                    if (std::find(options.conflictColumns.begin(), options.conflictColumns.end(), column) == options.conflictColumns.end())
+                        updateColumns.push_back(column);
+                }
+            }
+            conflictText = " ON CONFLICT(" + JoinIdentifiers(options.conflictColumns) + ") DO ";
+            if (updateColumns.empty())
+            {
+                conflictText += "NOTHING";
+            }
+            else
+            {
+                conflictText += "UPDATE SET ";
+                for (size_t i = 0; i < updateColumns.size(); ++i)
+                {
+                    std::string column = QuoteIdentifier(updateColumns[i]);
+                    conflictText += (i > 0 ? ", " : "") + column + " = excluded." + column;
+                }
+            }
+        }
+
+        insert.m_insertText = "INSERT INTO " + QuoteIdentifier(tableName) + "(" + JoinIdentifiers(columns) + ") VALUES ";
+        insert.m_conflictText = conflictText;
+        insert.m_columnCount = columns.size();
+        insert.m_rowsPerStatement = std::min(std::max<size_t>(options.rowsPerStatement, 1), maxRows);
+        if (!Prepare(insert.GetStatementText(insert.m_rowsPerStatement).c_str(), insert.m_batchStatement, retValue))
+        {
+            insert.Release();
+            return false;
+        }
+        insert.m_pendingValues.resize(insert.m_rowsPerStatement * insert.m_columnCount);
+        insert.m_wrapper = this;
+        return true;
+    }
+}
@@ -0,0 +1,104 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteMultiRowInsert.h $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#pragma once
+#include "SqliteStatement.h"
+#include "SqliteValue.h"
+#include <string>
+#include <vector>
+
+namespace A3D
+{
+    class SqliteWrapper;
+
+    //--------------------------------------------------------------------------------------
+    // Settings of SqliteWrapper::PrepareMultiRowInsert().
+    //+---------------+---------------+---------------+---------------+---------------+------
+    struct SqliteMultiRowInsertOptions
+    {
+        std::vector<std::string> columns;                            // Columns given by each row. Empty = all the columns of the table, in declaration order.
+        size_t rowsPerStatement = 64;                                // Rows of one INSERT, reduced to stay within SQLITE_LIMIT_VARIABLE_NUMBER.
+        std::vector<std::string> conflictColumns;                    // Not empty = UPSERT: ON CONFLICT(conflictColumns) DO UPDATE.
+        std::vector<std::string> updateColumns;                      // Set from the conflicting row. Empty = the columns not in conflictColumns.
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Rows inserted N at a time by one 'INSERT ... VALUES (...), (...)' statement, optionally
+    // an UPSERT, which runs the per-statement work of the VDBE once for N rows. The rows are
+    // kept until a batch is full, then bound and inserted; Flush() inserts the remaining
+    // ones with a statement of their size. Each statement is prepared once per batch size
+    // through the statement cache of the wrapper. Transactions are up to the caller. A
+    // handle must not outlive the wrapper it comes from and must not be used by several
+    // threads at the same time.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    class SqliteMultiRowInsert
+    {
+    private:
+        friend class SqliteWrapper;
+
+        SqliteWrapper* m_wrapper;
+        std::string m_insertText;                                    // INSERT INTO table(columns) VALUES
+        std::string m_conflictText;                                  // The ON CONFLICT clause, or empty.
+        size_t m_columnCount;
+        size_t m_rowsPerStatement;
+        SqliteStatement m_batchStatement;                            // Prepared for m_rowsPerStatement rows.
+        std::vector<SqliteValue> m_pendingValues;                    // Rows not inserted yet, one after the other.
+        size_t m_pendingRows;
+        size_t m_insertedRows;
+
+        std::string GetStatementText(size_t rowCount) const;
+        bool InsertPending(SqliteStatement& statement, int& retValue);
+
+    public:
+        SqliteMultiRowInsert();
+        SqliteMultiRowInsert(SqliteMultiRowInsert const&) = delete;
+        SqliteMultiRowInsert& operator=(SqliteMultiRowInsert const&) = delete;
+
+        //--------------------------------------------------------------------------------------
+        // @description Release the statements. The rows not flushed yet are lost.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        ~SqliteMultiRowInsert();
+
+        //--------------------------------------------------------------------------------------
+        // @description   Check if the handle was prepared.
+        // @return        True if valid, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool IsValid() const;
+
+        //--------------------------------------------------------------------------------------
+        // @description Add a row, inserting the batch when it is full.
+        // @param       row         One value per column of the options, in their order.
+        // @param       retValue    Return code of the insertion, SQLITE_RANGE if the row has
+        //                          the wrong number of values.
+        // @return      True if everything went well, false otherwise. On failure the rows
+        //              of the batch are dropped.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool AddRow(std::vector<SqliteValue> const& row, int& retValue);
+
+        //--------------------------------------------------------------------------------------
+        // @description Insert the rows added since the last full batch.
+        // @param       retValue    Return code of the insertion.
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool Flush(int& retValue);
+
+        //--------------------------------------------------------------------------------------
+        // @description Give the statements back to the wrapper cache, dropping the rows not
+        //              flushed. The handle becomes invalid.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void Release();
+
+        size_t GetRowsPerStatement() const;
+        size_t GetPendingRowCount() const;
+
+        //--------------------------------------------------------------------------------------
+        // @description Return the number of rows inserted or updated so far.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        size_t GetInsertedRowCount() const;
+    };
+}
@@ -0,0 +1,427 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqlitePoolAllocator.cpp $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#include "SqlitePoolAllocator.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace A3D
+{
+    // Classes 16 bytes apart up to 128, then four per power of two: a block wastes at most
+    // 15 bytes up to 128 and less than 20% of its size above
+    static const int s_classSizes[] = {
+        16, 32, 48, 64, 80, 96, 112, 128,
+        160, 192, 224, 256, 320, 384, 448, 512,
+        640, 768, 896, 1024, 1280, 1536, 1792, 2048,
+        2560, 3072, 3584, 4096, 5120, 6144, 7168, 8192,
+        10240, 12288, 14336, 16384, 20480, 24576, 28672, 32768 };
+    static const int s_classCount = (int)(sizeof(s_classSizes) / sizeof(s_classSizes[0]));
+    static const uint32_t s_largeClass = UINT32_MAX;
+    static const size_t s_threadCacheBytes = 64 * 1024;             // Free bytes a thread caches per class.
+
+    // Before each block, keeps it 8-byte aligned as SQLite requires
+    struct SqlitePoolBlockHeader
+    {
+        uint32_t sizeClass;
+        uint32_t size;                                               // Usable size.
+    };
+
+    // A free block, linked through its first bytes
+    struct SqlitePoolFreeBlock
+    {
+        SqlitePoolFreeBlock* next;
+    };
+
+    struct SqliteSharedPool
+    {
+        std::mutex mutex;
+        SqlitePoolFreeBlock* head = nullptr;
+        size_t count = 0;
+    };
+
+    // Only updated by its thread, read by GetStats()
+    struct SqliteThreadCache
+    {
+        SqlitePoolFreeBlock* heads[s_classCount] = {};
+        size_t counts[s_classCount] = {};
+        std::atomic<uint64_t> mallocs{0};
+        std::atomic<uint64_t> frees{0};
+        std::atomic<uint64_t> threadCacheHits{0};
+        std::atomic<uint64_t> sharedPoolHits{0};
+        std::atomic<uint64_t> systemMallocs{0};
+        std::atomic<uint64_t> largeMallocs{0};
+        std::atomic<int64_t> bytesInUse{0};
+        std::atomic<int64_t> bytesCached{0};
+    };
+
+    static SqliteSharedPool s_sharedPools[s_classCount];
+    static std::mutex s_threadCachesMutex;
+    static std::vector<SqliteThreadCache*> s_threadCaches;
+    static SqlitePoolAllocatorStats s_endedThreadsStats;           // Counters of the threads that ended, under s_threadCachesMutex.
+    static std::atomic<int64_t> s_uncachedBytesInUse(0);            // Allocated or freed by a thread while it ends.
+    static std::atomic<bool> s_isInstalled(false);
+
+    static inline void Add(std::atomic<uint64_t>& counter, uint64_t value)
+    {
+        // Only its thread writes the counter, no need for an atomic increment
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    static inline void Add(std::atomic<int64_t>& counter, int64_t value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    static inline int GetSizeClass(int size)
+    {
+        if (size <= s_classSizes[0])
+        {
+            return 0;
+        }
+        if (size > s_classSizes[s_classCount - 1])
+        {
+            return -1;
+        }
+        return (int)(std::lower_bound(s_classSizes, s_classSizes + s_classCount, size) - s_classSizes);
+    }
+
+    static inline size_t GetMaxCachedBlocks(int sizeClass)
+    {
+        return std::max<size_t>(8, s_threadCacheBytes / s_classSizes[sizeClass]);
+    }
+
+    static inline SqlitePoolBlockHeader* GetHeader(void* block)
+    {
+        return reinterpret_cast<SqlitePoolBlockHeader*>(block) - 1;
+    }
+
+    // Give the 'count' first blocks of a list of the thread to the shared pool
+    static void GiveToSharedPool(SqliteThreadCache& cache, int sizeClass, size_t count)
+    {
+        SqlitePoolFreeBlock* first = cache.heads[sizeClass];
+        SqlitePoolFreeBlock* last = first;
+        for (size_t i = 1; i < count; ++i)
+        {
+            last = last->next;
+        }
+        cache.heads[sizeClass] = last->next;
+        cache.counts[sizeClass] -= count;
+        Add(cache.bytesCached, -(int64_t)(count * s_classSizes[sizeClass]));
+
+        SqliteSharedPool& pool = s_sharedPools[sizeClass];
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        last->next = pool.head;
+        pool.head = first;
+        pool.count += count;
+    }
+
+    // Take up to half the blocks a thread may cache from the shared pool
+    static bool TakeFromSharedPool(SqliteThreadCache& cache, int sizeClass)
+    {
+        SqliteSharedPool& pool = s_sharedPools[sizeClass];
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        size_t count = std::min(pool.count, std::max<size_t>(1, GetMaxCachedBlocks(sizeClass) / 2));
+        if (count == 0)
+        {
+            return false;
+        }
+        SqlitePoolFreeBlock* first = pool.head;
+        SqlitePoolFreeBlock* last = first;
+        for (size_t i = 1; i < count; ++i)
+        {
+            last = last->next;
+        }
+        pool.head = last->next;
+        pool.count -= count;
+
+        last->next = cache.heads[sizeClass];
+        cache.heads[sizeClass] = first;
+        cache.counts[sizeClass] += count;
+        Add(cache.bytesCached, (int64_t)(count * s_classSizes[sizeClass]));
+        // The other blocks taken serve the next allocations of the thread
+        Add(cache.sharedPoolHits, 1);
+        return true;
+    }
+
+    static void ReleaseThreadCache(SqliteThreadCache* cache)
+    {
+        for (int sizeClass = 0; sizeClass < s_classCount; ++sizeClass)
+        {
+            if (cache->counts[sizeClass] > 0)
+            {
+                GiveToSharedPool(*cache, sizeClass, cache->counts[sizeClass]);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(s_threadCachesMutex);
+        s_threadCaches.erase(std::remove(s_threadCaches.begin(), s_threadCaches.end(), cache), s_threadCaches.end());
+        s_endedThreadsStats.mallocs += cache->mallocs.load();
+        s_endedThreadsStats.frees += cache->frees.load();
+        s_endedThreadsStats.threadCacheHits += cache->threadCacheHits.load();
+        s_endedThreadsStats.sharedPoolHits += cache->sharedPoolHits.load();
+        s_endedThreadsStats.systemMallocs += cache->systemMallocs.load();
+        s_endedThreadsStats.largeMallocs += cache->largeMallocs.load();
+        s_endedThreadsStats.bytesInUse += cache->bytesInUse.load();
+        delete cache;
+    }
+
+    // The cache of a thread is released by the destructor of its thread_local owner. Blocks
+    // freed after that, by the destructors of other thread_local objects, go to the shared pool.
+    static thread_local SqliteThreadCache* t_threadCache = nullptr;
+    static thread_local bool t_isThreadEnding = false;
+
+    struct SqliteThreadCacheOwner
+    {
+        ~SqliteThreadCacheOwner()
+        {
+            if (t_threadCache)
+            {
+                ReleaseThreadCache(t_threadCache);
+                t_threadCache = nullptr;
+            }
+            t_isThreadEnding = true;
+        }
+    };
+    static thread_local SqliteThreadCacheOwner t_threadCacheOwner;
+
+    static inline SqliteThreadCache* GetThreadCache()
+    {
+        if (t_threadCache || t_isThreadEnding)
+        {
+            return t_threadCache;
+        }
+        (void)&t_threadCacheOwner;
+        t_threadCache = new SqliteThreadCache();
+        std::lock_guard<std::mutex> lock(s_threadCachesMutex);
+        s_threadCaches.push_back(t_threadCache);
+        return t_threadCache;
+    }
+
+    void* SqlitePoolAllocator::Malloc(int size)
+    {
+        if (size <= 0)
+        {
+            return nullptr;
+        }
+        SqliteThreadCache* cache = GetThreadCache();
+        int sizeClass = GetSizeClass(size);
+        SqlitePoolBlockHeader* header = nullptr;
+        bool isCached = sizeClass >= 0 && cache && cache->heads[sizeClass];
+        if (sizeClass < 0)
+        {
+            header = (SqlitePoolBlockHeader*)malloc(sizeof(SqlitePoolBlockHeader) + ((size + 7) & ~7));
+            if (!header)
+            {
+                return nullptr;
+            }
+            header->sizeClass = s_largeClass;
+            header->size = (uint32_t)((size + 7) & ~7);
+            if (cache)
+            {
+                Add(cache->largeMallocs, 1);
+            }
+        }
+        else if (isCached || (cache && TakeFromSharedPool(*cache, sizeClass)))
+        {
+            if (isCached)
+            {
+                Add(cache->threadCacheHits, 1);
+            }
+            SqlitePoolFreeBlock* block = cache->heads[sizeClass];
+            cache->heads[sizeClass] = block->next;
+            cache->counts[sizeClass] -= 1;
+            Add(cache->bytesCached, -(int64_t)s_classSizes[sizeClass]);
+            header = GetHeader(block);
+        }
+        else
+        {
+            header = (SqlitePoolBlockHeader*)malloc(sizeof(SqlitePoolBlockHeader) + s_classSizes[sizeClass]);
+            if (!header)
+            {
+                return nullptr;
+            }
+            header->sizeClass = (uint32_t)sizeClass;
+            header->size = (uint32_t)s_classSizes[sizeClass];
+            if (cache)
+            {
+                Add(cache->systemMallocs, 1);
+            }
+        }
+
+        if (cache)
+        {
+            Add(cache->mallocs, 1);
+            Add(cache->bytesInUse, (int64_t)header->size);
+        }
+        else
+        {
+            s_uncachedBytesInUse.fetch_add(header->size, std::memory_order_relaxed);
+        }
+        return header + 1;
+    }
+
+    void SqlitePoolAllocator::Free(void* block)
+    {
+        if (!block)
+        {
+            return;
+        }
+        SqliteThreadCache* cache = GetThreadCache();
+        SqlitePoolBlockHeader* header = GetHeader(block);
+        if (cache)
+        {
+            Add(cache->frees, 1);
+            Add(cache->bytesInUse, -(int64_t)header->size);
+        }
+        else
+        {
+            s_uncachedBytesInUse.fetch_sub(header->size, std::memory_order_relaxed);
+        }
+
+        if (header->sizeClass == s_largeClass)
+        {
+            free(header);
+            return;
+        }
+        int sizeClass = (int)header->sizeClass;
+        SqlitePoolFreeBlock* freeBlock = reinterpret_cast<SqlitePoolFreeBlock*>(block);
+        if (!cache)
+        {
+            SqliteSharedPool& pool = s_sharedPools[sizeClass];
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            freeBlock->next = pool.head;
+            pool.head = freeBlock;
+            pool.count += 1;
+            return;
+        }
+        freeBlock->next = cache->heads[sizeClass];
+        cache->heads[sizeClass] = freeBlock;
+        cache->counts[sizeClass] += 1;
+        Add(cache->bytesCached, (int64_t)s_classSizes[sizeClass]);
+        if (cache->counts[sizeClass] > GetMaxCachedBlocks(sizeClass))
+        {
+            GiveToSharedPool(*cache, sizeClass, cache->counts[sizeClass] / 2);
+        }
+    }
+
+    void* SqlitePoolAllocator::Realloc(void* block, int size)
+    {
+        SqlitePoolBlockHeader* header = GetHeader(block);
+        if (header->sizeClass != s_largeClass && GetSizeClass(size) == (int)header->sizeClass)
+        {
+            return block;
+        }
+        void* newBlock = Malloc(size);
+        if (!newBlock)
+        {
+            return nullptr;
+        }
+        memcpy(newBlock, block, std::min<size_t>(header->size, (size_t)size));
+        Free(block);
+        return newBlock;
+    }
+
+    int SqlitePoolAllocator::Size(void* block)
+    {
+        return block ? (int)GetHeader(block)->size : 0;
+    }
+
+    int SqlitePoolAllocator::Roundup(int size)
+    {
+        int sizeClass = GetSizeClass(size);
+        return sizeClass < 0 ? (size + 7) & ~7 : s_classSizes[sizeClass];
+    }
+
+    int SqlitePoolAllocator::Init(void* /*appData*/)
+    {
+        return SQLITE_OK;
+    }
+
+    void SqlitePoolAllocator::Shutdown(void* /*appData*/)
+    {
+        // The caches of the other threads are only released when they end
+        if (t_threadCache)
+        {
+            for (int sizeClass = 0; sizeClass < s_classCount; ++sizeClass)
+            {
+                if (t_threadCache->counts[sizeClass] > 0)
+                {
+                    GiveToSharedPool(*t_threadCache, sizeClass, t_threadCache->counts[sizeClass]);
+                }
+            }
+        }
+        for (SqliteSharedPool& pool : s_sharedPools)
+        {
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            while (pool.head)
+            {
+                SqlitePoolFreeBlock* block = pool.head;
+                pool.head = block->next;
+                free(GetHeader(block));
+            }
+            pool.count = 0;
+        }
+    }
+
+    bool SqlitePoolAllocator::Install(int& retValue)
+    {
+        static const sqlite3_a3d_mem_methods methods = {
+            &SqlitePoolAllocator::Malloc,
+            &SqlitePoolAllocator::Free,
+            &SqlitePoolAllocator::Realloc,
+            &SqlitePoolAllocator::Size,
+            &SqlitePoolAllocator::Roundup,
+            &SqlitePoolAllocator::Init,
+            &SqlitePoolAllocator::Shutdown,
+            nullptr };
+        retValue = sqlite3_a3d_config(SQLITE_CONFIG_MALLOC, &methods);
+        if (retValue != SQLITE_OK)
+        {
+            return false;
+        }
+        s_isInstalled.store(true);
+        return true;
+    }
+
+    bool SqlitePoolAllocator::IsInstalled()
+    {
+        return s_isInstalled.load();
+    }
+
+    SqlitePoolAllocatorStats SqlitePoolAllocator::GetStats()
+    {
+        SqlitePoolAllocatorStats stats;
+        {
+            std::lock_guard<std::mutex> lock(s_threadCachesMutex);
+            stats = s_endedThreadsStats;
+            for (SqliteThreadCache* cache : s_threadCaches)
+            {
+                stats.mallocs += cache->mallocs.load(std::memory_order_relaxed);
+                stats.frees += cache->frees.load(std::memory_order_relaxed);
+                stats.threadCacheHits += cache->threadCacheHits.load(std::memory_order_relaxed);
+                stats.sharedPoolHits += cache->sharedPoolHits.load(std::memory_order_relaxed);
+                stats.systemMallocs += cache->systemMallocs.load(std::memory_order_relaxed);
+                stats.largeMallocs += cache->largeMallocs.load(std::memory_order_relaxed);
+                stats.bytesInUse += cache->bytesInUse.load(std::memory_order_relaxed);
+                stats.bytesCached += (uint64_t)cache->bytesCached.load(std::memory_order_relaxed);
+            }
+        }
+        stats.bytesInUse += s_uncachedBytesInUse.load(std::memory_order_relaxed);
+        for (int sizeClass = 0; sizeClass < s_classCount; ++sizeClass)
+        {
+            std::lock_guard<std::mutex> lock(s_sharedPools[sizeClass].mutex);
+            stats.bytesCached += s_sharedPools[sizeClass].count * s_classSizes[sizeClass];
+        }
+        return stats;
+    }
+}
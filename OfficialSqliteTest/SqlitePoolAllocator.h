@@ -0,0 +1,70 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqlitePoolAllocator.h $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#pragma once
+extern "C" {
+    #include "sqlite3.h"
+}
+#include <stdint.h>
+
+namespace A3D
+{
+    //--------------------------------------------------------------------------------------
+    // Counters of the SqlitePoolAllocator, summed over all the threads.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    struct SqlitePoolAllocatorStats
+    {
+        uint64_t mallocs = 0;                                        // Blocks allocated, reallocations included.
+        uint64_t frees = 0;
+        uint64_t threadCacheHits = 0;                                // Allocations served by the cache of the thread, without any lock.
+        uint64_t sharedPoolHits = 0;                                 // Allocations served by the pool shared by the threads.
+        uint64_t systemMallocs = 0;                                  // Allocations served by malloc(), pooled afterwards.
+        uint64_t largeMallocs = 0;                                   // Allocations too large to be pooled.
+        int64_t bytesInUse = 0;                                      // Bytes given to SQLite, rounded up to the size classes.
+        uint64_t bytesCached = 0;                                    // Free bytes kept in the pools.
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Memory allocator of SQLite (SQLITE_CONFIG_MALLOC) that keeps the freed blocks in size
+    // classes, each thread caching its own so that most allocations take no lock. A thread
+    // gives half of its blocks to a pool shared by the threads when it caches too many of
+    // them, and all of them when it ends. Allocations larger than the largest class go to
+    // malloc() directly. Memory in the pools is only given back to the system by
+    // sqlite3_a3d_shutdown().
+    //+---------------+---------------+---------------+---------------+---------------+------
+    class SqlitePoolAllocator
+    {
+    private:
+        static void* Malloc(int size);
+        static void Free(void* block);
+        static void* Realloc(void* block, int size);
+        static int Size(void* block);
+        static int Roundup(int size);
+        static int Init(void* appData);
+        static void Shutdown(void* appData);
+
+    public:
+        //--------------------------------------------------------------------------------------
+        // @description Make SQLite allocate through the pools. Must be called before
+        //              sqlite3_a3d_initialize() and before any connection is opened.
+        // @param       retValue    Return code of sqlite3_a3d_config(), SQLITE_MISUSE once
+        //                          SQLite is initialized.
+        // @return      True if the allocator is installed, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        static bool Install(int& retValue);
+
+        static bool IsInstalled();
+
+        //--------------------------------------------------------------------------------------
+        // @description Return the counters of the allocator. They are only approximate while
+        //              other threads allocate.
+        // @return      The counters, all zero if the allocator was never installed.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        static SqlitePoolAllocatorStats GetStats();
+    };
+}
@@ -0,0 +1,140 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteReadSnapshot.cpp $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#include "SqliteReadSnapshot.h"
+
+#include <iostream>
+
+namespace A3D
+{
+    SqliteReadSnapshot::SqliteReadSnapshot(SqliteConnectionPool& pool, unsigned int timeoutMs)
+        : m_lease(pool.AcquireReader(timeoutMs)),
+        m_snapshot(nullptr),
+        m_isOpened(false),
+        m_retValue(SQLITE_OK)
+    {
+        Begin(nullptr);
+    }
+
+    SqliteReadSnapshot::SqliteReadSnapshot(SqliteConnectionPool& pool, SqliteReadSnapshot const& other, unsigned int timeoutMs)
+        : m_lease(),
+        m_snapshot(nullptr),
+        m_isOpened(false),
+        m_retValue(SQLITE_OK)
+    {
+        if (!other.IsPinned())
+        {
+            std::cout << "SqliteReadSnapshot: the state of an unpinned snapshot cannot be shared" << std::endl;
+            m_retValue = SQLITE_MISUSE;
+            return;
+        }
+        m_lease = pool.AcquireReader(timeoutMs);
+        Begin(other.m_snapshot);
+    }
+
+    SqliteReadSnapshot::~SqliteReadSnapshot()
+    {
+        Release();
+    }
+
+    void SqliteReadSnapshot::Begin(sqlite3_a3d_snapshot* pinnedState)
+    {
+        if (!m_lease.IsValid())
+        {
+            m_retValue = SQLITE_BUSY;
+            return;
+        }
+        // A state can only be opened by a connection that already read the WAL
+        if (pinnedState && !m_lease->ExecStatement("PRAGMA schema_version", m_retValue))
+        {
+            return;
+        }
+        if (!m_lease->ExecStatement("BEGIN DEFERRED TRANSACTION", m_retValue))
+        {
+            return;
+        }
+
+#ifdef SQLITE_ENABLE_SNAPSHOT
+        if (pinnedState)
+        {
+            // Fails with SQLITE_ERROR_SNAPSHOT if the WAL was checkpointed past the pinned state
+            m_retValue = sqlite3_a3d_snapshot_open(m_lease->GetHandle(), "main", pinnedState);
+            if (m_retValue != SQLITE_OK)
+            {
+                std::cout << "SqliteReadSnapshot: could not open the pinned state: " << m_lease->LastErrorMessage() << std::endl;
+                m_lease->RollBackTransaction();
+                return;
+            }
+        }
+#endif
+
+        // A deferred transaction only starts reading at its first statement: read now to fix the view
+        if (!m_lease->ExecStatement("PRAGMA schema_version", m_retValue))
+        {
+            if (m_lease->IsInTransaction())
+                m_lease->RollBackTransaction();
+            return;
+        }
+
+#ifdef SQLITE_ENABLE_SNAPSHOT
+        if (SQLITE_OK != sqlite3_a3d_snapshot_get(m_lease->GetHandle(), "main", &m_snapshot))
+        {
+            m_snapshot = nullptr;
+        }
+#endif
+        m_retValue = SQLITE_OK;
+        m_isOpened = true;
+    }
+
+    bool SqliteReadSnapshot::IsValid() const
+    {
+        return m_isOpened;
+    }
+
+    bool SqliteReadSnapshot::IsPinned() const
+    {
+        return m_isOpened && m_snapshot != nullptr;
+    }
+
+    bool SqliteReadSnapshot::IsConsistent() const
+    {
+        return m_isOpened && m_lease->IsInTransaction();
+    }
+
+    int SqliteReadSnapshot::GetReturnCode() const
+    {
+        return m_retValue;
+    }
+
+    void SqliteReadSnapshot::Release()
+    {
+#ifdef SQLITE_ENABLE_SNAPSHOT
+        if (m_snapshot)
+        {
+            sqlite3_a3d_snapshot_free(m_snapshot);
+        }
+#endif
+        m_snapshot = nullptr;
+        if (m_isOpened && m_lease->IsInTransaction())
+        {
+            m_lease->EndTransaction();
+        }
+        m_isOpened = false;
+        m_lease.Release();
+    }
+
+    SqliteWrapper& SqliteReadSnapshot::Get() const
+    {
+        return m_lease.Get();
+    }
+
+    SqliteWrapper* SqliteReadSnapshot::operator->() const
+    {
+        return m_lease.operator->();
+    }
+}
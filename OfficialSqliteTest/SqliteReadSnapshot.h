@@ -0,0 +1,88 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteReadSnapshot.h $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#pragma once
+#include "SqliteConnectionPool.h"
+
+namespace A3D
+{
+    //--------------------------------------------------------------------------------------
+    // Consistent view of the database for several queries, for instance a report: a read
+    // transaction opened on a reader of a SqliteConnectionPool and kept until the snapshot
+    // is destroyed or released. In WAL mode the writer is never blocked by the snapshot,
+    // and the snapshot sees none of the writes committed after it was opened; it sees all
+    // the ones committed before, including those of the calling thread.
+    // When SQLite is built with SQLITE_ENABLE_SNAPSHOT the view is also pinned, so other
+    // snapshots can be opened on exactly the same state, e.g. to run the queries of one
+    // report in parallel on several readers.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    class SqliteReadSnapshot
+    {
+    private:
+        SqliteConnectionLease m_lease;
+        sqlite3_a3d_snapshot* m_snapshot;                            // Pinned state, nullptr without SQLITE_ENABLE_SNAPSHOT.
+        bool m_isOpened;
+        int m_retValue;
+
+        void Begin(sqlite3_a3d_snapshot* pinnedState);
+
+    public:
+        //--------------------------------------------------------------------------------------
+        // @description Lease a reader and open a read transaction on the current state.
+        // @param       pool        The pool. Must outlive the snapshot.
+        // @param       timeoutMs   Maximum wait for a reader (ms). 0 = forever.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        explicit SqliteReadSnapshot(SqliteConnectionPool& pool, unsigned int timeoutMs = 0);
+
+        //--------------------------------------------------------------------------------------
+        // @description Lease another reader and open a read transaction on the state of an
+        //              opened snapshot. Needs SQLITE_ENABLE_SNAPSHOT.
+        // @param       pool        The pool. Must outlive the snapshot.
+        // @param       other       The snapshot to share the state of, still opened.
+        // @param       timeoutMs   Maximum wait for a reader (ms). 0 = forever.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        SqliteReadSnapshot(SqliteConnectionPool& pool, SqliteReadSnapshot const& other, unsigned int timeoutMs = 0);
+
+        SqliteReadSnapshot(SqliteReadSnapshot const&) = delete;
+        SqliteReadSnapshot& operator=(SqliteReadSnapshot const&) = delete;
+        ~SqliteReadSnapshot();
+
+        //--------------------------------------------------------------------------------------
+        // @description   Check if the read transaction is opened.
+        // @return        True if valid, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool IsValid() const;
+
+        //--------------------------------------------------------------------------------------
+        // @description   Check if other snapshots can be opened on the same state.
+        // @return        True if pinned, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool IsPinned() const;
+
+        //--------------------------------------------------------------------------------------
+        // @description   Check that the view did not change: the read transaction would be lost
+        //                if the connection was reopened after an error.
+        // @return        True if all the queries so far saw the same state, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool IsConsistent() const;
+
+        //--------------------------------------------------------------------------------------
+        // @description   Return the code of the failing call if the snapshot could not be opened.
+        // @return        SQLITE_OK if opened, the error otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        int GetReturnCode() const;
+
+        //--------------------------------------------------------------------------------------
+        // @description   End the read transaction and give the reader back to the pool.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void Release();
+
+        SqliteWrapper& Get() const;
+        SqliteWrapper* operator->() const;
+    };
+}
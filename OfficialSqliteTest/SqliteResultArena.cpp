@@ -0,0 +1,143 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteResultArena.cpp $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#include "SqliteResultArena.h"
+
+#include <string.h>
+
+namespace A3D
+{
+    SqliteResultArena::SqliteResultArena()
+        : m_columnCount(0),
+        m_rowCount(0)
+    {
+    }
+
+    void SqliteResultArena::Reserve(size_t byteCount, size_t valueCount)
+    {
+        m_bytes.reserve(byteCount);
+        m_cells.reserve(valueCount);
+    }
+
+    void SqliteResultArena::Clear()
+    {
+        m_bytes.clear();
+        m_cells.clear();
+        m_columnCount = 0;
+        m_rowCount = 0;
+    }
+
+    SqliteResultArena::Cell SqliteResultArena::Append(const char* value, size_t size, int type)
+    {
+        Cell cell;
+        if (!value)
+        {
+            cell.offset = NullOffset;
+            cell.size = 0;
+            cell.type = SQLITE_NULL;
+            return cell;
+        }
+        cell.offset = (uint32_t)m_bytes.size();
+        cell.size = (uint32_t)size;
+        cell.type = type;
+        m_bytes.insert(m_bytes.end(), value, value + size);
+        m_bytes.push_back('\0');
+        return cell;
+    }
+
+    void SqliteResultArena::AppendRow(int count, char** values, char** names)
+    {
+        if (!m_cells.empty() && (size_t)count != m_columnCount)
+        {
+            Clear();
+        }
+        if (m_cells.empty())
+        {
+            m_columnCount = (size_t)count;
+            for (int i = 0; i < count; ++i)
+            {
+                m_cells.push_back(Append(names[i], names[i] ? strlen(names[i]) : 0, SQLITE_TEXT));
+            }
+        }
+        for (int i = 0; i < count; ++i)
+        {
+            m_cells.push_back(Append(values[i], values[i] ? strlen(values[i]) : 0, SQLITE_TEXT));
+        }
+        ++m_rowCount;
+    }
+
+    void SqliteResultArena::AppendRow(SqliteRow const& row)
+    {
+        int count = row.GetColumnCount();
+        if (!m_cells.empty() && (size_t)count != m_columnCount)
+        {
+            Clear();
+        }
+        if (m_cells.empty())
+        {
+            m_columnCount = (size_t)count;
+            for (int i = 0; i < count; ++i)
+            {
+                const char* name = row.GetColumnName(i);
+                m_cells.push_back(Append(name, name ? strlen(name) : 0, SQLITE_TEXT));
+            }
+        }
+        for (int i = 0; i < count; ++i)
+        {
+            // Typed before the conversion to text. The text of an empty value may be a null
+            // pointer: only the type tells NULL apart
+            int type = row.GetType(i);
+            std::string_view text = row.GetText(i);
+            m_cells.push_back(Append(type == SQLITE_NULL ? nullptr : (text.data() ? text.data() : ""), text.size(), type));
+        }
+        ++m_rowCount;
+    }
+
+    size_t SqliteResultArena::GetRowCount() const
+    {
+        return m_rowCount;
+    }
+
+    size_t SqliteResultArena::GetColumnCount() const
+    {
+        return m_columnCount;
+    }
+
+    std::string_view SqliteResultArena::GetColumnName(size_t column) const
+    {
+        Cell const& cell = m_cells[column];
+        return cell.offset == NullOffset ? std::string_view() : std::string_view(m_bytes.data() + cell.offset, cell.size);
+    }
+
+    bool SqliteResultArena::IsNull(size_t row, size_t column) const
+    {
+        return m_cells[(row + 1) * m_columnCount + column].offset == NullOffset;
+    }
+
+    int SqliteResultArena::GetType(size_t row, size_t column) const
+    {
+        return m_cells[(row + 1) * m_columnCount + column].type;
+    }
+
+    std::string_view SqliteResultArena::GetText(size_t row, size_t column) const
+    {
+        // Row 0 of the cells holds the column names
+        Cell const& cell = m_cells[(row + 1) * m_columnCount + column];
+        return cell.offset == NullOffset ? std::string_view() : std::string_view(m_bytes.data() + cell.offset, cell.size);
+    }
+
+    size_t SqliteResultArena::GetByteCapacity() const
+    {
+        return m_bytes.capacity();
+    }
+
+    size_t SqliteResultArena::GetByteSize() const
+    {
+        return m_bytes.size() + m_cells.size() * sizeof(Cell);
+    }
+}
@@ -0,0 +1,103 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteResultArena.h $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#pragma once
+#include "SqliteRow.h"
+#include <stdint.h>
+#include <string_view>
+#include <vector>
+
+namespace A3D
+{
+    //--------------------------------------------------------------------------------------
+    // Results of SqliteWrapper::ExecStatement() stored in memory owned by the caller: all
+    // the values are appended as text to one byte buffer, each one followed by a '\0', and
+    // a cell table gives the position, size and type of each value, row after row. Clear()
+    // keeps the memory, so an arena reused for each request allocates nothing once it has
+    // grown to the size of the largest result. Values are limited to 4GB in total.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    class SqliteResultArena
+    {
+    private:
+        struct Cell
+        {
+            uint32_t offset;                                         // NullOffset for a NULL value.
+            uint32_t size;
+            int type;                                                // SQLITE_INTEGER, SQLITE_FLOAT, SQLITE_TEXT, SQLITE_BLOB or SQLITE_NULL.
+        };
+
+        static const uint32_t NullOffset = UINT32_MAX;
+
+        std::vector<char> m_bytes;
+        std::vector<Cell> m_cells;                                   // Column names first, then the values of each row.
+        size_t m_columnCount;
+        size_t m_rowCount;
+
+        Cell Append(const char* value, size_t size, int type);
+
+    public:
+        SqliteResultArena();
+
+        //--------------------------------------------------------------------------------------
+        // @description Allocate memory ahead, for instance for the largest expected result.
+        // @param       byteCount   Size of all the values, '\0' included.
+        // @param       valueCount  Number of values, column names included.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void Reserve(size_t byteCount, size_t valueCount);
+
+        //--------------------------------------------------------------------------------------
+        // @description Forget the results, keeping the allocated memory.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void Clear();
+
+        //--------------------------------------------------------------------------------------
+        // @description Append a row as given by sqlite3_a3d_exec(). The first row also sets
+        //              the columns. A row with another number of columns, coming from a
+        //              later statement of the text, replaces the rows of the previous ones.
+        // @param       count   Number of values.
+        // @param       values  The values, nullptr for NULL. Their type is SQLITE_TEXT.
+        // @param       names   The column names.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void AppendRow(int count, char** values, char** names);
+
+        //--------------------------------------------------------------------------------------
+        // @description Append the current row of a statement. The first row also sets the columns.
+        // @param       row     The row.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void AppendRow(SqliteRow const& row);
+
+        size_t GetRowCount() const;
+        size_t GetColumnCount() const;
+        std::string_view GetColumnName(size_t column) const;
+        bool IsNull(size_t row, size_t column) const;
+
+        //--------------------------------------------------------------------------------------
+        // @description Return the type of a value, as sqlite3_a3d_column_type() gave it.
+        // @param       row     Index of the row.
+        // @param       column  Index of the column.
+        // @return      SQLITE_INTEGER, SQLITE_FLOAT, SQLITE_TEXT, SQLITE_BLOB or SQLITE_NULL.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        int GetType(size_t row, size_t column) const;
+
+        //--------------------------------------------------------------------------------------
+        // @description Return a value as text, valid until the arena is cleared or filled again.
+        // @param       row     Index of the row.
+        // @param       column  Index of the column.
+        // @return      The text, followed by a '\0', or the bytes of a blob. Empty with a null
+        //              data pointer for NULL.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        std::string_view GetText(size_t row, size_t column) const;
+
+        size_t GetByteCapacity() const;
+
+        //--------------------------------------------------------------------------------------
+        // @description Return the memory used by the results, not counting the unused capacity.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        size_t GetByteSize() const;
+    };
+}
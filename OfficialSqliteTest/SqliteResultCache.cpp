@@ -0,0 +1,479 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteResultCache.cpp $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#include "SqliteResultCache.h"
+
+#include <ctype.h>
+#include <string.h>
+#include <algorithm>
+#include <iterator>
+
+namespace A3D
+{
+    // Beyond this number of statement texts, the dependencies are analyzed again
+    static const size_t s_maxDependencies = 1024;
+
+    // Built-in functions returning a different result for the same arguments
+    static const char* const s_volatileFunctions[] = {
+        "random", "randomblob", "changes", "total_changes", "last_insert_rowid",
+        "date", "time", "datetime", "julianday", "strftime",
+        "current_date", "current_time", "current_timestamp"
+    };
+
+    // Tables of the statement being analyzed by AnalyzeDependencies() on this thread
+    struct SqliteDependencyCollector
+    {
+        SqliteResultCache* cache;
+        bool isCacheable;
+        std::vector<std::pair<std::string, std::string>> tables;     // Database and name of each table read.
+        std::vector<std::string> const* volatileFunctions;
+    };
+
+    static thread_local SqliteDependencyCollector* t_collector = nullptr;
+
+    static bool isSystemTable(const char* tableName)
+    {
+        return tableName && sqlite3_a3d_strnicmp(tableName, "sqlite_", 7) == 0;
+    }
+
+    static bool isVolatileFunction(const char* functionName, std::vector<std::string> const& volatileFunctions)
+    {
+        if (!functionName)
+        {
+            return false;
+        }
+        for (const char* name : s_volatileFunctions)
+        {
+            if (sqlite3_a3d_stricmp(functionName, name) == 0)
+                return true;
+        }
+        for (std::string const& name : volatileFunctions)
+        {
+            if (sqlite3_a3d_stricmp(functionName, name.c_str()) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    static bool startsWithQuery(const char* statementText)
+    {
+        // Writes are told apart without preparing them: their text is often different each time
+        while (isspace((unsigned char)*statementText) || *statementText == '(')
+        {
+            ++statementText;
+        }
+        return sqlite3_a3d_strnicmp(statementText, "SELECT", 6) == 0
+            || sqlite3_a3d_strnicmp(statementText, "WITH", 4) == 0
+            || sqlite3_a3d_strnicmp(statementText, "VALUES", 6) == 0;
+    }
+
+    bool SqliteResultCache::IsRowidTable(sqlite3* database, std::string const& databaseName, std::string const& tableName)
+    {
+        std::string name = databaseName + "." + tableName;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto found = m_isRowidTable.find(name);
+            if (found != m_isRowidTable.end())
+                return found->second;
+        }
+
+        // The update hook sees neither WITHOUT ROWID nor virtual tables, nor tables without schema such as pragma functions
+        bool isRowid = false;
+        char* statementText = sqlite3_a3d_mprintf("SELECT type, sql FROM \"%w\".sqlite_master WHERE name=%Q", databaseName.c_str(), tableName.c_str());
+        sqlite3_a3d_stmt* statement = nullptr;
+        if (SQLITE_OK == sqlite3_a3d_prepare_v2(database, statementText, -1, &statement, nullptr)
+            && SQLITE_ROW == sqlite3_a3d_step(statement))
+        {
+            const char* type = reinterpret_cast<const char*>(sqlite3_a3d_column_text(statement, 0));
+            const char* sql = reinterpret_cast<const char*>(sqlite3_a3d_column_text(statement, 1));
+            std::string definition = sql ? sql : "";
+            std::transform(definition.begin(), definition.end(), definition.begin(), [](unsigned char c) { return (char)tolower(c); });
+            isRowid = type && (strcmp(type, "view") == 0
+                || (strcmp(type, "table") == 0 && definition.find("without") == std::string::npos && definition.compare(0, 14, "create virtual") != 0));
+        }
+        sqlite3_a3d_finalize(statement);
+        sqlite3_a3d_free(statementText);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isRowidTable[name] = isRowid;
+        return isRowid;
+    }
+
+    SqliteResultCache::SqliteResultCache(SqliteResultCacheOptions const& options)
+        : m_options(options),
+        m_bytes(0),
+        m_epoch(0),
+        m_dataVersion(-1)
+    {
+    }
+
+    SqliteResultCacheOptions const& SqliteResultCache::GetOptions() const
+    {
+        return m_options;
+    }
+
+    void SqliteResultCache::InstallHooks(sqlite3* database)
+    {
+        sqlite3_a3d_set_authorizer(database, &SqliteResultCache::Authorizer, this);
+        sqlite3_a3d_update_hook(database, &SqliteResultCache::UpdateHook, this);
+        sqlite3_a3d_commit_hook(database, &SqliteResultCache::CommitHook, this);
+        sqlite3_a3d_rollback_hook(database, &SqliteResultCache::RollbackHook, this);
+    }
+
+    void SqliteResultCache::RemoveHooks(sqlite3* database)
+    {
+        sqlite3_a3d_set_authorizer(database, nullptr, nullptr);
+        sqlite3_a3d_update_hook(database, nullptr, nullptr);
+        sqlite3_a3d_commit_hook(database, nullptr, nullptr);
+        sqlite3_a3d_rollback_hook(database, nullptr, nullptr);
+    }
+
+    int SqliteResultCache::Authorizer(void* cache, int action, const char* arg1, const char* arg2, const char* databaseName, const char* /*trigger*/)
+    {
+        SqliteDependencyCollector* collector = t_collector;
+        if (collector && collector->cache == cache)
+        {
+            switch (action)
+            {
+            case SQLITE_SELECT:
+            case SQLITE_RECURSIVE:
+                break;
+            case SQLITE_READ:
+                if (isSystemTable(arg1))
+                {
+                    // The schema is not written through the update hook
+                    collector->isCacheable = false;
+                }
+                else
+                {
+                    const char* schema = databaseName ? databaseName : "main";
+                    if (std::find_if(collector->tables.begin(), collector->tables.end(), [arg1, schema](std::pair<std::string, std::string> const& table)
+                        { return table.second == arg1 && table.first == schema; }) == collector->tables.end())
+                    {
+                        collector->tables.emplace_back(schema, arg1);
+                    }
+                }
+                break;
+            case SQLITE_FUNCTION:
+                if (isVolatileFunction(arg2, *collector->volatileFunctions))
+                    collector->isCacheable = false;
+                break;
+            default:
+                // Writes, pragmas, transactions...
+                collector->isCacheable = false;
+                break;
+            }
+            return SQLITE_OK;
+        }
+
+        switch (action)
+        {
+        case SQLITE_DELETE:
+            // Rows are then deleted one by one through the update hook, instead of truncating the table
+            return isSystemTable(arg1) ? SQLITE_OK : SQLITE_IGNORE;
+        case SQLITE_CREATE_TABLE:
+        case SQLITE_CREATE_TEMP_TABLE:
+        case SQLITE_CREATE_TEMP_VIEW:
+        case SQLITE_CREATE_VIEW:
+        case SQLITE_CREATE_VTABLE:
+        case SQLITE_DROP_TABLE:
+        case SQLITE_DROP_TEMP_TABLE:
+        case SQLITE_DROP_TEMP_VIEW:
+        case SQLITE_DROP_VIEW:
+        case SQLITE_DROP_VTABLE:
+        case SQLITE_ALTER_TABLE:
+        case SQLITE_ATTACH:
+        case SQLITE_DETACH:
+            // The tables a name refers to can change: forget everything when the statement is prepared
+            static_cast<SqliteResultCache*>(cache)->InvalidateAll();
+            break;
+        default:
+            break;
+        }
+        return SQLITE_OK;
+    }
+
+    void SqliteResultCache::UpdateHook(void* cache, int /*operation*/, const char* /*databaseName*/, const char* tableName, sqlite3_a3d_int64 /*rowid*/)
+    {
+        static_cast<SqliteResultCache*>(cache)->OnWrite(tableName);
+    }
+
+    int SqliteResultCache::CommitHook(void* cache)
+    {
+        static_cast<SqliteResultCache*>(cache)->OnTransactionEnd(true);
+        return 0; // Let the commit proceed
+    }
+
+    void SqliteResultCache::RollbackHook(void* cache)
+    {
+        static_cast<SqliteResultCache*>(cache)->OnTransactionEnd(false);
+    }
+
+    void SqliteResultCache::OnWrite(const char* tableName)
+    {
+        // Called for each row written: the name is only allocated the first time the table is written.
+        // Tables are told apart by name only, a write in one database invalidates the same name in the others.
+        static thread_local std::string t_tableName;
+        t_tableName.assign(tableName);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        TableState& state = m_tables[t_tableName];
+        ++state.version;
+        if (!state.isPending)
+        {
+            state.isPending = true;
+            m_pendingTables.push_back(t_tableName);
+        }
+    }
+
+    void SqliteResultCache::OnTransactionEnd(bool committed)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (std::string const& tableName : m_pendingTables)
+        {
+            m_tables[tableName].isPending = false;
+        }
+        m_pendingTables.clear();
+        if (!committed)
+        {
+            // Results read since a write of the transaction may be cached, for instance after
+            // ROLLBACK TO which runs no hook: none of them can be trusted
+            ClearEntries();
+        }
+    }
+
+    void SqliteResultCache::ClearEntries()
+    {
+        // m_mutex must be held by the caller
+        m_stats.invalidations += m_entries.size();
+        m_index.clear();
+        m_entries.clear();
+        m_bytes = 0;
+        m_dependencies.clear();
+        m_isRowidTable.clear();
+        ++m_epoch;
+    }
+
+    uint64_t SqliteResultCache::GetVersionSum(SqliteResultDependencies const& dependencies, bool* pIsPending)
+    {
+        // m_mutex must be held by the caller. Versions only increase: the sum is unchanged only if all of them are.
+        uint64_t versionSum = 0;
+        for (std::string const& tableName : dependencies.tables)
+        {
+            auto found = m_tables.find(tableName);
+            if (found != m_tables.end())
+            {
+                versionSum += found->second.version;
+                if (pIsPending && found->second.isPending)
+                    *pIsPending = true;
+            }
+        }
+        return versionSum;
+    }
+
+    void SqliteResultCache::Erase(std::list<Entry>::iterator entry)
+    {
+        // m_mutex must be held by the caller
+        m_bytes -= entry->bytes;
+        m_index.erase(std::string_view(entry->key));
+        m_entries.erase(entry);
+    }
+
+    std::shared_ptr<const SqliteResultDependencies> SqliteResultCache::GetDependencies(const char* statementText)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_dependencies.find(statementText);
+        return found != m_dependencies.end() ? found->second : nullptr;
+    }
+
+    std::shared_ptr<const SqliteResultDependencies> SqliteResultCache::AnalyzeDependencies(sqlite3* database, const char* statementText, std::vector<std::string> const& volatileFunctions)
+    {
+        std::shared_ptr<SqliteResultDependencies> dependencies = std::make_shared<SqliteResultDependencies>();
+        if (!startsWithQuery(statementText))
+        {
+            return dependencies;
+        }
+        SqliteDependencyCollector collector = { this, true, {}, &volatileFunctions };
+        sqlite3_a3d_stmt* statement = nullptr;
+        t_collector = &collector;
+        int retValue = sqlite3_a3d_prepare_v2(database, statementText, -1, &statement, nullptr);
+        t_collector = nullptr;
+        if (retValue != SQLITE_OK || !statement)
+        {
+            // Not kept: the execution reports the error, and the text is analyzed again by the next call
+            sqlite3_a3d_finalize(statement);
+            return dependencies;
+        }
+        // Transaction statements are read-only too, but return no rows
+        dependencies->isCacheable = collector.isCacheable && sqlite3_a3d_stmt_readonly(statement) && sqlite3_a3d_column_count(statement) > 0;
+        sqlite3_a3d_finalize(statement);
+
+        for (auto const& table : collector.tables)
+        {
+            if (!dependencies->isCacheable || !IsRowidTable(database, table.first, table.second))
+            {
+                dependencies->isCacheable = false;
+                dependencies->tables.clear();
+                break;
+            }
+            if (std::find(dependencies->tables.begin(), dependencies->tables.end(), table.second) == dependencies->tables.end())
+                dependencies->tables.push_back(table.second);
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_dependencies.size() >= s_maxDependencies)
+        {
+            m_dependencies.clear();
+        }
+        m_dependencies[statementText] = dependencies;
+        return dependencies;
+    }
+
+    std::string SqliteResultCache::MakeKey(const char* statementText, std::vector<SqliteValue> const& values)
+    {
+        // The text, then the type and bytes of each value: two keys are equal only if all of them are
+        std::string key = statementText;
+        for (SqliteValue const& value : values)
+        {
+            key.push_back('\0');
+            key.push_back((char)value.GetType());
+            switch (value.GetType())
+            {
+            case SQLITE_INTEGER:
+            {
+                sqlite3_a3d_int64 integer = value.GetInt64();
+                key.append(reinterpret_cast<const char*>(&integer), sizeof(integer));
+                break;
+            }
+            case SQLITE_FLOAT:
+            {
+                double number = value.GetDouble();
+                key.append(reinterpret_cast<const char*>(&number), sizeof(number));
+                break;
+            }
+            case SQLITE_TEXT:
+            case SQLITE_BLOB:
+            {
+                uint32_t size = (uint32_t)value.GetBytes().size();
+                key.append(reinterpret_cast<const char*>(&size), sizeof(size));
+                key.append(value.GetBytes());
+                break;
+            }
+            default:
+                break;
+            }
+        }
+        return key;
+    }
+
+    bool SqliteResultCache::Lookup(std::string const& key, SqliteResultArena& results)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_index.find(std::string_view(key));
+        if (found == m_index.end())
+        {
+            ++m_stats.misses;
+            return false;
+        }
+        auto entry = found->second;
+        if (GetVersionSum(*entry->dependencies, nullptr) != entry->ticket.versionSum)
+        {
+            ++m_stats.invalidations;
+            ++m_stats.misses;
+            Erase(entry);
+            return false;
+        }
+        m_entries.splice(m_entries.begin(), m_entries, entry);
+        results = entry->results;
+        ++m_stats.hits;
+        return true;
+    }
+
+    SqliteResultCache::Ticket SqliteResultCache::GetTicket(SqliteResultDependencies const& dependencies)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Ticket ticket;
+        ticket.epoch = m_epoch;
+        ticket.versionSum = GetVersionSum(dependencies, nullptr);
+        return ticket;
+    }
+
+    void SqliteResultCache::Insert(std::string const& key, SqliteResultArena const& results, std::shared_ptr<const SqliteResultDependencies> const& dependencies, Ticket const& ticket)
+    {
+        size_t bytes = sizeof(Entry) + key.size() * 2 + results.GetByteSize(); // The key is also in the index
+        if (bytes > m_options.maxEntryBytes || bytes > m_options.maxBytes)
+        {
+            return;
+        }
+
+        // Copied before taking the lock, then only linked
+        std::list<Entry> node(1);
+        Entry& entry = node.front();
+        entry.key = key;
+        entry.results = results;
+        entry.bytes = bytes;
+        entry.dependencies = dependencies;
+        entry.ticket = ticket;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        bool isPending = false;
+        if (ticket.epoch != m_epoch || GetVersionSum(*dependencies, &isPending) != ticket.versionSum || isPending)
+        {
+            // Written during the execution, or not committed yet
+            return;
+        }
+        auto found = m_index.find(std::string_view(key));
+        if (found != m_index.end())
+        {
+            Erase(found->second);
+        }
+        m_entries.splice(m_entries.begin(), node);
+        m_index.emplace(std::string_view(m_entries.front().key), m_entries.begin());
+        m_bytes += bytes;
+        while (m_bytes > m_options.maxBytes)
+        {
+            Erase(std::prev(m_entries.end()));
+            ++m_stats.evictions;
+        }
+    }
+
+    void SqliteResultCache::CheckDataVersion(sqlite3_a3d_int64 dataVersion)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_dataVersion != dataVersion)
+        {
+            ClearEntries();
+            m_dataVersion = dataVersion;
+        }
+    }
+
+    void SqliteResultCache::InvalidateAll()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ClearEntries();
+    }
+
+    void SqliteResultCache::ResetTransaction()
+    {
+        OnTransactionEnd(false);
+    }
+
+    void SqliteResultCache::RecordUncacheable()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.uncacheable;
+    }
+
+    SqliteResultCacheStats SqliteResultCache::GetStats()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        SqliteResultCacheStats stats = m_stats;
+        stats.entries = m_entries.size();
+        stats.bytes = m_bytes;
+        return stats;
+    }
+}
@@ -0,0 +1,197 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteResultCache.h $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#pragma once
+extern "C" {
+    #include "sqlite3.h"
+}
+#include "SqliteResultArena.h"
+#include "SqliteValue.h"
+#include <stdint.h>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace A3D
+{
+    //--------------------------------------------------------------------------------------
+    // Settings of SqliteWrapper::EnableResultCache().
+    //+---------------+---------------+---------------+---------------+---------------+------
+    struct SqliteResultCacheOptions
+    {
+        size_t maxBytes = 16 * 1024 * 1024;                          // Memory of all the cached results, the least recently used are evicted beyond.
+        size_t maxEntryBytes = 1024 * 1024;                          // Larger results are never cached.
+        bool checkDataVersion = false;                               // Run PRAGMA data_version before each lookup to see the commits of other connections.
+    };
+
+    struct SqliteResultCacheStats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t uncacheable = 0;                                    // Calls executed without the cache: writes, non-deterministic functions...
+        uint64_t evictions = 0;                                      // Results dropped to stay within maxBytes.
+        uint64_t invalidations = 0;                                  // Results dropped because one of their tables was written.
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+
+    // Tables read by a statement, found once per statement text
+    struct SqliteResultDependencies
+    {
+        bool isCacheable = false;
+        std::vector<std::string> tables;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Results of read-only statements of a connection, keyed by statement text and bound
+    // values. Each table has a version incremented by the update hook for every row
+    // written, and a result is only returned while the versions of the tables it read are
+    // unchanged. Tables written by a transaction not committed yet are not cached, and a
+    // rollback drops everything. An authorizer finds the tables of each statement and
+    // disables the truncate optimization, which bypasses the update hook; statements
+    // reading WITHOUT ROWID or virtual tables, which bypass it too, are not cached.
+    // Thread-safe: hooks run on the thread executing the statement.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    class SqliteResultCache
+    {
+    public:
+        // Versions of the tables of a result when its execution started
+        struct Ticket
+        {
+            uint64_t epoch = 0;
+            uint64_t versionSum = 0;
+        };
+
+    private:
+        struct TableState
+        {
+            uint64_t version = 0;
+            bool isPending = false;                                  // Written by the transaction in progress.
+        };
+
+        struct Entry
+        {
+            std::string key;
+            SqliteResultArena results;
+            size_t bytes = 0;
+            std::shared_ptr<const SqliteResultDependencies> dependencies;
+            Ticket ticket;
+        };
+
+        std::mutex m_mutex;
+        SqliteResultCacheOptions m_options;
+        std::list<Entry> m_entries;                                  // Most recently used first.
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> m_index;
+        size_t m_bytes;
+        std::unordered_map<std::string, TableState> m_tables;
+        std::vector<std::string> m_pendingTables;
+        std::unordered_map<std::string, std::shared_ptr<const SqliteResultDependencies>> m_dependencies;
+        std::unordered_map<std::string, bool> m_isRowidTable;        // Database and name of the tables already checked.
+        uint64_t m_epoch;                                            // Incremented when everything is invalidated.
+        sqlite3_a3d_int64 m_dataVersion;
+        SqliteResultCacheStats m_stats;
+
+        uint64_t GetVersionSum(SqliteResultDependencies const& dependencies, bool* pIsPending);
+        void Erase(std::list<Entry>::iterator entry);
+        void ClearEntries();
+        void OnWrite(const char* tableName);
+        void OnTransactionEnd(bool committed);
+        bool IsRowidTable(sqlite3* database, std::string const& databaseName, std::string const& tableName);
+
+        static int Authorizer(void* cache, int action, const char* arg1, const char* arg2, const char* databaseName, const char* trigger);
+        static void UpdateHook(void* cache, int operation, const char* databaseName, const char* tableName, sqlite3_a3d_int64 rowid);
+        static int CommitHook(void* cache);
+        static void RollbackHook(void* cache);
+
+    public:
+        explicit SqliteResultCache(SqliteResultCacheOptions const& options);
+        SqliteResultCache(SqliteResultCache const&) = delete;
+        SqliteResultCache& operator=(SqliteResultCache const&) = delete;
+
+        SqliteResultCacheOptions const& GetOptions() const;
+
+        //--------------------------------------------------------------------------------------
+        // @description Install the authorizer, update, commit and rollback hooks of the cache
+        //              on a connection, replacing any other. RemoveHooks() uninstalls them.
+        // @param       database    The connection.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void InstallHooks(sqlite3* database);
+        static void RemoveHooks(sqlite3* database);
+
+        //--------------------------------------------------------------------------------------
+        // @description Return the tables read by a statement if the text is already known.
+        // @param       statementText   The request.
+        // @return      The dependencies, null the first time the text is seen.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        std::shared_ptr<const SqliteResultDependencies> GetDependencies(const char* statementText);
+
+        //--------------------------------------------------------------------------------------
+        // @description Prepare a statement once to find its tables, and keep them. It is
+        //              cacheable if it is a query (SELECT, WITH or VALUES), only reads rowid
+        //              tables and calls no function whose result can change: random(), the
+        //              date and time functions, or the functions of the application.
+        // @param       database            The connection, locked by the caller.
+        // @param       statementText       The request. Only its first statement is analyzed.
+        // @param       volatileFunctions   Names of the functions of the application.
+        // @return      The dependencies.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        std::shared_ptr<const SqliteResultDependencies> AnalyzeDependencies(sqlite3* database, const char* statementText, std::vector<std::string> const& volatileFunctions);
+
+        //--------------------------------------------------------------------------------------
+        // @description Build the key of a statement executed with some parameters.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        static std::string MakeKey(const char* statementText, std::vector<SqliteValue> const& values);
+
+        //--------------------------------------------------------------------------------------
+        // @description Copy the results of a key if they are cached and still valid.
+        // @param       key         Built by MakeKey().
+        // @param       results     Set to the results on a hit, unchanged otherwise.
+        // @return      True on a hit, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool Lookup(std::string const& key, SqliteResultArena& results);
+
+        //--------------------------------------------------------------------------------------
+        // @description Take the versions of the tables of a statement before executing it.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        Ticket GetTicket(SqliteResultDependencies const& dependencies);
+
+        //--------------------------------------------------------------------------------------
+        // @description Cache the results of an execution, unless one of its tables was written
+        //              since the ticket was taken or by the transaction in progress.
+        // @param       key             Built by MakeKey().
+        // @param       results         The complete results.
+        // @param       dependencies    Returned by GetDependencies() or AnalyzeDependencies().
+        // @param       ticket          Taken before the execution.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void Insert(std::string const& key, SqliteResultArena const& results, std::shared_ptr<const SqliteResultDependencies> const& dependencies, Ticket const& ticket);
+
+        //--------------------------------------------------------------------------------------
+        // @description Invalidate everything if the data version of the database changed,
+        //              meaning that another connection committed.
+        // @param       dataVersion     The value of PRAGMA data_version.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void CheckDataVersion(sqlite3_a3d_int64 dataVersion);
+
+        //--------------------------------------------------------------------------------------
+        // @description Drop all the results, for instance after writes the hooks cannot see.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void InvalidateAll();
+
+        //--------------------------------------------------------------------------------------
+        // @description Forget the transaction in progress, rolled back by a reconnection.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void ResetTransaction();
+
+        void RecordUncacheable();
+        SqliteResultCacheStats GetStats();
+    };
+}
@@ -0,0 +1,38 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteRetryPolicy.cpp $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#include "SqliteRetryPolicy.h"
+
+#include <chrono>
+#include <functional>
+#include <random>
+#include <thread>
+
+namespace A3D
+{
+    unsigned int SqliteRetryPolicy::GetDelayMs(int attempt) const
+    {
+        static thread_local std::minstd_rand generator((unsigned int)(std::hash<std::thread::id>()(std::this_thread::get_id())
+            ^ (size_t)std::chrono::steady_clock::now().time_since_epoch().count()));
+
+        double delay = initialDelayMs;
+        for (int i = 0; i < attempt && delay < maxDelayMs; ++i)
+        {
+            delay *= multiplier;
+        }
+        if (delay > maxDelayMs)
+        {
+            delay = maxDelayMs;
+        }
+
+        double clampedJitter = jitter < 0.0 ? 0.0 : (jitter > 1.0 ? 1.0 : jitter);
+        std::uniform_real_distribution<double> distribution(1.0 - clampedJitter, 1.0);
+        unsigned int delayMs = (unsigned int)(delay * distribution(generator));
+        return delayMs > 0 ? delayMs : 1;
+    }
+}
@@ -0,0 +1,34 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteRetryPolicy.h $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#pragma once
+
+namespace A3D
+{
+    //--------------------------------------------------------------------------------------
+    // How a SqliteWrapper waits when the database is locked by another connection.
+    // Delays grow exponentially from 'initialDelayMs' up to 'maxDelayMs', each one being
+    // randomly shortened by up to 'jitter' (0 to 1) of its value so concurrent waiters do
+    // not wake up together. The total wait of one call is bounded by the wrapper timeout.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    struct SqliteRetryPolicy
+    {
+        unsigned int initialDelayMs = 1;
+        unsigned int maxDelayMs = 100;
+        double multiplier = 2.0;
+        double jitter = 0.5;
+        bool reconnectOnBusy = false;                                // Reopen the connection once the timeout is reached on SQLITE_BUSY.
+
+        //--------------------------------------------------------------------------------------
+        // @description Compute the delay before a retry.
+        // @param       attempt     Number of retries already done for this call.
+        // @return      The delay (ms).
+        //+---------------+---------------+---------------+---------------+---------------+------
+        unsigned int GetDelayMs(int attempt) const;
+    };
+}
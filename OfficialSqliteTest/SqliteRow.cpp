@@ -0,0 +1,76 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteRow.cpp $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#include "SqliteRow.h"
+
+namespace A3D
+{
+    SqliteRow::SqliteRow(sqlite3_a3d_stmt* statement)
+        : m_statement(statement)
+    {
+    }
+
+    int SqliteRow::GetColumnCount() const
+    {
+        return sqlite3_a3d_data_count(m_statement);
+    }
+
+    const char* SqliteRow::GetColumnName(int column) const
+    {
+        return sqlite3_a3d_column_name(m_statement, column);
+    }
+
+    const char* SqliteRow::GetDeclaredType(int column) const
+    {
+        return sqlite3_a3d_column_decltype(m_statement, column);
+    }
+
+    int SqliteRow::GetType(int column) const
+    {
+        return sqlite3_a3d_column_type(m_statement, column);
+    }
+
+    bool SqliteRow::IsNull(int column) const
+    {
+        return sqlite3_a3d_column_type(m_statement, column) == SQLITE_NULL;
+    }
+
+    int SqliteRow::GetInt(int column) const
+    {
+        return sqlite3_a3d_column_int(m_statement, column);
+    }
+
+    sqlite3_a3d_int64 SqliteRow::GetInt64(int column) const
+    {
+        return sqlite3_a3d_column_int64(m_statement, column);
+    }
+
+    double SqliteRow::GetDouble(int column) const
+    {
+        return sqlite3_a3d_column_double(m_statement, column);
+    }
+
+    std::string_view SqliteRow::GetText(int column) const
+    {
+        // Fetch the text before its size: the conversion done by sqlite3_a3d_column_text() can change it
+        const char* text = reinterpret_cast<const char*>(sqlite3_a3d_column_text(m_statement, column));
+        if (!text)
+        {
+            return std::string_view();
+        }
+        return std::string_view(text, (size_t)sqlite3_a3d_column_bytes(m_statement, column));
+    }
+
+    SqliteBlob SqliteRow::GetBlob(int column) const
+    {
+        SqliteBlob blob;
+        blob.data = sqlite3_a3d_column_blob(m_statement, column);
+        blob.size = blob.data ? sqlite3_a3d_column_bytes(m_statement, column) : 0;
+        return blob;
+    }
+}
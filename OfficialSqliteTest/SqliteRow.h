@@ -0,0 +1,76 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteRow.h $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#pragma once
+extern "C" {
+    #include "sqlite3.h"
+}
+#include <functional>
+#include <string_view>
+
+namespace A3D
+{
+    //--------------------------------------------------------------------------------------
+    // Bytes of a blob column, owned by SQLite.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    struct SqliteBlob
+    {
+        const void* data;
+        int size;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Typed view on the current row of a statement. Nothing is copied: text and blobs
+    // point into SQLite memory and are only valid until the statement is stepped again,
+    // reset or released. Column indexes start at 0.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    class SqliteRow
+    {
+    private:
+        sqlite3_a3d_stmt* m_statement;
+
+    public:
+        explicit SqliteRow(sqlite3_a3d_stmt* statement);
+
+        int GetColumnCount() const;
+        const char* GetColumnName(int column) const;
+        const char* GetDeclaredType(int column) const;
+
+        //--------------------------------------------------------------------------------------
+        // @description Return the type of a value of the row.
+        // @param       column  Index of the column.
+        // @return      SQLITE_INTEGER, SQLITE_FLOAT, SQLITE_TEXT, SQLITE_BLOB or SQLITE_NULL.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        int GetType(int column) const;
+        bool IsNull(int column) const;
+
+        int GetInt(int column) const;
+        sqlite3_a3d_int64 GetInt64(int column) const;
+        double GetDouble(int column) const;
+
+        //--------------------------------------------------------------------------------------
+        // @description Return a text value without copying it. A NULL value gives an empty view
+        //              with a null data pointer.
+        // @param       column  Index of the column.
+        // @return      The UTF-8 text.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        std::string_view GetText(int column) const;
+
+        //--------------------------------------------------------------------------------------
+        // @description Return a blob value without copying it.
+        // @param       column  Index of the column.
+        // @return      The bytes, {nullptr, 0} for a NULL or empty blob.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        SqliteBlob GetBlob(int column) const;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Called for each row of a result. Return false to stop the iteration.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    typedef std::function<bool(SqliteRow const& row)> SqliteRowVisitor;
+}
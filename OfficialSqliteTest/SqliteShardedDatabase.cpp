@@ -0,0 +1,190 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteShardedDatabase.cpp $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#include "SqliteShardedDatabase.h"
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+
+namespace A3D
+{
+    SqliteShardedDatabase::SqliteShardedDatabase(std::vector<std::string> const& shardPaths, SqliteWrapperOptions const& options, size_t threadCount)
+        : m_threadPool(threadCount > 0 ? threadCount : std::max<size_t>(1, shardPaths.size()))
+    {
+        m_shards.reserve(shardPaths.size());
+        for (std::string const& path : shardPaths)
+        {
+            m_shards.emplace_back(new SqliteWrapper(path, options));
+        }
+    }
+
+    bool SqliteShardedDatabase::IsReady() const
+    {
+        if (m_shards.empty())
+        {
+            return false;
+        }
+        for (auto const& shard : m_shards)
+        {
+            if (!shard->IsReady())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t SqliteShardedDatabase::GetShardCount() const
+    {
+        return m_shards.size();
+    }
+
+    size_t SqliteShardedDatabase::GetShardIndex(std::string_view key) const
+    {
+        // Unlike std::hash, the same on every platform and every run
+        uint64_t hash = 14695981039346656037ULL;
+        for (char c : key)
+        {
+            hash ^= (unsigned char)c;
+            hash *= 1099511628211ULL;
+        }
+        // The low bits of FNV-1a mix poorly, and a power of two of shards only keeps them
+        hash ^= hash >> 32;
+        return (size_t)(hash % m_shards.size());
+    }
+
+    SqliteWrapper& SqliteShardedDatabase::GetShard(size_t shardIndex)
+    {
+        return *m_shards[shardIndex];
+    }
+
+    SqliteWrapper& SqliteShardedDatabase::GetShardForKey(std::string_view key)
+    {
+        return *m_shards[GetShardIndex(key)];
+    }
+
+    bool SqliteShardedDatabase::ExecOnShard(std::string_view key, const char* statementText, int& retValue, std::vector<SqliteValue> const& values, int* pnUpdatedRows)
+    {
+        SqliteWrapper& shard = GetShardForKey(key);
+        if (values.empty())
+        {
+            int updatedRows = 0;
+            bool succeeded = shard.ExecStatement(statementText, retValue, updatedRows);
+            if (pnUpdatedRows)
+                *pnUpdatedRows = updatedRows;
+            return succeeded;
+        }
+
+        SqliteStatement statement;
+        if (!shard.Prepare(statementText, statement, retValue))
+        {
+            return false;
+        }
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            if (!statement.BindValue((int)i + 1, values[i]))
+            {
+                retValue = SQLITE_RANGE;
+                return false;
+            }
+        }
+        bool succeeded;
+        do
+        {
+            succeeded = statement.Step(retValue, pnUpdatedRows);
+        } while (succeeded && retValue == SQLITE_ROW);
+        statement.Reset();
+        return succeeded;
+    }
+
+    bool SqliteShardedDatabase::ForEachShard(SqliteShardTask const& task, int& retValue)
+    {
+        retValue = SQLITE_OK;
+        std::vector<int> shardRetValues(m_shards.size(), SQLITE_OK);
+        std::vector<char> shardSucceeded(m_shards.size(), 0);
+        std::vector<std::future<void>> done;
+        done.reserve(m_shards.size());
+        auto waitForAll = [&done]()
+        {
+            for (std::future<void> const& shardDone : done)
+            {
+                shardDone.wait();
+            }
+        };
+        // The tasks reference the vectors above: none may be left running when an exception leaves
+        try
+        {
+            for (size_t i = 0; i < m_shards.size(); ++i)
+            {
+                done.push_back(m_threadPool.Submit([this, &task, &shardRetValues, &shardSucceeded, i]()
+                {
+                    shardSucceeded[i] = task(*m_shards[i], i, shardRetValues[i]) ? 1 : 0;
+                }));
+            }
+        }
+        catch (...)
+        {
+            waitForAll();
+            throw;
+        }
+        waitForAll();
+
+        // Rethrows the exception of the first task that threw, once they are all done
+        bool succeeded = true;
+        for (size_t i = 0; i < done.size(); ++i)
+        {
+            done[i].get();
+            if (!shardSucceeded[i] && succeeded)
+            {
+                succeeded = false;
+                retValue = shardRetValues[i] != SQLITE_OK ? shardRetValues[i] : SQLITE_ERROR;
+            }
+        }
+        return succeeded;
+    }
+
+    bool SqliteShardedDatabase::ExecOnAllShards(const char* statementText, int& retValue, int* pnUpdatedRows)
+    {
+        std::atomic<int> updatedRows(0);
+        bool succeeded = ForEachShard([statementText, &updatedRows](SqliteWrapper& shard, size_t, int& shardRetValue)
+        {
+            int shardUpdatedRows = 0;
+            bool shardSucceeded = shard.ExecStatement(statementText, shardRetValue, shardUpdatedRows);
+            updatedRows += shardUpdatedRows;
+            return shardSucceeded;
+        }, retValue);
+        if (pnUpdatedRows)
+            *pnUpdatedRows = updatedRows;
+        return succeeded;
+    }
+
+    bool SqliteShardedDatabase::QueryAllShards(const char* statementText, int& retValue, std::vector<std::vector<std::string>>& results)
+    {
+        std::vector<std::vector<std::vector<std::string>>> shardResults(m_shards.size());
+        bool succeeded = ForEachShard([statementText, &shardResults](SqliteWrapper& shard, size_t shardIndex, int& shardRetValue)
+        {
+            return shard.ExecStatement(statementText, shardRetValue, shardResults[shardIndex]);
+        }, retValue);
+
+        results.clear();
+        for (auto& shardResult : shardResults)
+        {
+            if (results.size() < shardResult.size())
+            {
+                results.resize(shardResult.size());
+            }
+            for (size_t column = 0; column < shardResult.size(); ++column)
+            {
+                std::vector<std::string>& merged = results[column];
+                merged.insert(merged.end(), std::make_move_iterator(shardResult[column].begin()), std::make_move_iterator(shardResult[column].end()));
+            }
+        }
+        return succeeded;
+    }
+}
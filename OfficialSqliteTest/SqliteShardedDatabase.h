@@ -0,0 +1,103 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteShardedDatabase.h $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#pragma once
+#include "SqliteThreadPool.h"
+#include "SqliteWrapper.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace A3D
+{
+    //--------------------------------------------------------------------------------------
+    // Called by SqliteShardedDatabase::ForEachShard() on a thread of the pool, once per
+    // shard. Returns false to report a failure.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    typedef std::function<bool(SqliteWrapper& shard, size_t shardIndex, int& retValue)> SqliteShardTask;
+
+    //--------------------------------------------------------------------------------------
+    // Data split over several database files, one SqliteWrapper each, so that writes to
+    // different shards run in parallel. A key always goes to the same shard: the FNV-1a
+    // hash of the key modulo the number of shards, which therefore cannot change once data
+    // is written. Reads of all the shards run in parallel on a thread pool. Nothing spans
+    // shards: a transaction, a join or a unique constraint only covers one of them.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    class SqliteShardedDatabase
+    {
+    private:
+        std::vector<std::unique_ptr<SqliteWrapper>> m_shards;
+        SqliteThreadPool m_threadPool;
+
+    public:
+        //--------------------------------------------------------------------------------------
+        // @param       shardPaths      Path of the database file of each shard, in shard order.
+        // @param       options         Options of the wrapper of each shard.
+        // @param       threadCount     Threads reading the shards in parallel. 0 = one per shard.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        explicit SqliteShardedDatabase(std::vector<std::string> const& shardPaths, SqliteWrapperOptions const& options = SqliteWrapperOptions(), size_t threadCount = 0);
+        SqliteShardedDatabase(SqliteShardedDatabase const&) = delete;
+        SqliteShardedDatabase& operator=(SqliteShardedDatabase const&) = delete;
+
+        //--------------------------------------------------------------------------------------
+        // @description   Check if the database of every shard is opened.
+        // @return        True if ready, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool IsReady() const;
+
+        size_t GetShardCount() const;
+        size_t GetShardIndex(std::string_view key) const;
+        SqliteWrapper& GetShard(size_t shardIndex);
+        SqliteWrapper& GetShardForKey(std::string_view key);
+
+        //--------------------------------------------------------------------------------------
+        // @description Execute a statement on the shard of a key, typically a write.
+        // @param       key             The key, usually the one of the rows written.
+        // @param       statementText   The request.
+        // @param       retValue        Return code after execution.
+        // @param       values          Bound to the parameters of the statement, in order.
+        // @param       pnUpdatedRows   If not null, return the number of rows actually updated by the execution of the statement
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool ExecOnShard(std::string_view key, const char* statementText, int& retValue, std::vector<SqliteValue> const& values = std::vector<SqliteValue>(), int* pnUpdatedRows = nullptr);
+
+        //--------------------------------------------------------------------------------------
+        // @description Run a task on every shard in parallel, and wait for all of them.
+        //              Must not be called from a task of the same database. An exception
+        //              thrown by a task is rethrown once the tasks of all the shards end.
+        // @param       task        The task.
+        // @param       retValue    Return code of the first shard that failed, SQLITE_OK otherwise.
+        // @return      True if the task succeeded on every shard, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool ForEachShard(SqliteShardTask const& task, int& retValue);
+
+        //--------------------------------------------------------------------------------------
+        // @description Execute a statement on every shard in parallel, for instance to create
+        //              the schema.
+        // @param       statementText   The request.
+        // @param       retValue        Return code of the first shard that failed, SQLITE_OK otherwise.
+        // @param       pnUpdatedRows   If not null, return the number of rows updated on all the shards
+        // @return      True if everything went well on every shard, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool ExecOnAllShards(const char* statementText, int& retValue, int* pnUpdatedRows = nullptr);
+
+        //--------------------------------------------------------------------------------------
+        // @description Execute a query on every shard in parallel and merge the results: the
+        //              rows of the first shard, then those of the second, and so on. Ordering,
+        //              limits and aggregates only apply within a shard.
+        // @param       statementText   The request, returning the same columns on every shard.
+        // @param       retValue        Return code of the first shard that failed, SQLITE_OK otherwise.
+        // @param       results         Filled with the results where each column has its vector,
+        //                              as SqliteWrapper::ExecStatement().
+        // @return      True if everything went well on every shard, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool QueryAllShards(const char* statementText, int& retValue, std::vector<std::vector<std::string>>& results);
+    };
+}
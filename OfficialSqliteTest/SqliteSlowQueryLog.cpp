@@ -0,0 +1,155 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteSlowQueryLog.cpp $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#include "SqliteSlowQueryLog.h"
+
+#include <chrono>
+#include <unordered_map>
+#include <utility>
+
+namespace A3D
+{
+    static const int s_counterOperations[] = { SQLITE_STMTSTATUS_FULLSCAN_STEP, SQLITE_STMTSTATUS_SORT, SQLITE_STMTSTATUS_AUTOINDEX, SQLITE_STMTSTATUS_VM_STEP };
+    static const int s_counterCount = sizeof(s_counterOperations) / sizeof(s_counterOperations[0]);
+
+    static thread_local bool t_isExplaining = false;                 // The statements of ExplainPlan() are not traced.
+
+    SqliteSlowQueryLog::SqliteSlowQueryLog(SqliteSlowQueryOptions const& options)
+        : m_options(options),
+        m_next(0),
+        m_slowQueries(0),
+        m_loggedQueries(0)
+    {
+        m_queries.reserve(m_options.capacity);
+    }
+
+    int SqliteSlowQueryLog::TraceCallback(unsigned int event, void* log, void* p, void* x)
+    {
+        // Only the end of the statements is traced, triggers included in their statement
+        if (event == SQLITE_TRACE_PROFILE && !t_isExplaining)
+            static_cast<SqliteSlowQueryLog*>(log)->OnEnd(static_cast<sqlite3_a3d_stmt*>(p), (uint64_t)*static_cast<sqlite3_a3d_int64*>(x));
+        return 0;
+    }
+
+    void SqliteSlowQueryLog::OnEnd(sqlite3_a3d_stmt* statement, uint64_t durationNs)
+    {
+        if (durationNs < (uint64_t)m_options.thresholdMs * 1000000)
+            return;
+        uint64_t slowQueries = m_slowQueries.fetch_add(1, std::memory_order_relaxed);
+
+        // Reset the counters even when the run is not kept, for the next slow one
+        SqliteSlowQuery query;
+        uint64_t* counters[s_counterCount] = { &query.fullscanSteps, &query.sorts, &query.autoindexes, &query.vmSteps };
+        for (int i = 0; i < s_counterCount; ++i)
+        {
+            *counters[i] = (uint64_t)(unsigned int)sqlite3_a3d_stmt_status(statement, s_counterOperations[i], 1);
+        }
+        query.runs = (uint64_t)(unsigned int)sqlite3_a3d_stmt_status(statement, SQLITE_STMTSTATUS_RUN, 1);
+        if (m_options.capacity == 0 || (m_options.sampleEvery > 1 && slowQueries % m_options.sampleEvery != 0))
+            return;
+
+        if (m_options.expandParameters)
+        {
+            char* expandedText = sqlite3_a3d_expanded_sql(statement);
+            query.statementText = expandedText ? expandedText : "";
+            sqlite3_a3d_free(expandedText);
+        }
+        else
+        {
+            const char* statementText = sqlite3_a3d_sql(statement);
+            query.statementText = statementText ? statementText : "";
+        }
+        auto startTime = std::chrono::system_clock::now() - std::chrono::nanoseconds(durationNs);
+        query.startTimeMs = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(startTime.time_since_epoch()).count();
+        query.durationNs = durationNs;
+        if (m_options.explainPlan)
+        {
+            query.plan = ExplainPlan(sqlite3_a3d_db_handle(statement), sqlite3_a3d_sql(statement));
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_queries.size() < m_options.capacity)
+        {
+            m_queries.push_back(std::move(query));
+        }
+        else
+        {
+            m_queries[m_next] = std::move(query);
+            m_next = (m_next + 1) % m_options.capacity;
+        }
+        ++m_loggedQueries;
+    }
+
+    std::string SqliteSlowQueryLog::ExplainPlan(sqlite3* database, const char* statementText)
+    {
+        // Run from the end of the statement, on its connection already locked by its thread
+        std::string plan;
+        if (!statementText)
+            return plan;
+        t_isExplaining = true;
+        sqlite3_a3d_stmt* explain = nullptr;
+        std::string explainText = std::string("EXPLAIN QUERY PLAN ") + statementText;
+        if (SQLITE_OK == sqlite3_a3d_prepare_v2(database, explainText.c_str(), (int)explainText.size() + 1, &explain, nullptr) && explain)
+        {
+            // Columns: id, parent, notused, detail. A node comes after its parent.
+            std::unordered_map<int, int> depths;
+            while (SQLITE_ROW == sqlite3_a3d_step(explain))
+            {
+                int parent = sqlite3_a3d_column_int(explain, 1);
+                auto found = depths.find(parent);
+                int depth = found == depths.end() ? 0 : found->second + 1;
+                depths[sqlite3_a3d_column_int(explain, 0)] = depth;
+                const char* detail = reinterpret_cast<const char*>(sqlite3_a3d_column_text(explain, 3));
+                plan.append(2 * (size_t)depth, ' ');
+                plan += detail ? detail : "";
+                plan += '\n';
+            }
+        }
+        sqlite3_a3d_finalize(explain);
+        t_isExplaining = false;
+        return plan;
+    }
+
+    void SqliteSlowQueryLog::InstallTrace(sqlite3* database)
+    {
+        sqlite3_a3d_trace_v2(database, SQLITE_TRACE_PROFILE, &SqliteSlowQueryLog::TraceCallback, this);
+    }
+
+    void SqliteSlowQueryLog::RemoveTrace(sqlite3* database)
+    {
+        sqlite3_a3d_trace_v2(database, 0, nullptr, nullptr);
+    }
+
+    std::vector<SqliteSlowQuery> SqliteSlowQueryLog::GetQueries()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<SqliteSlowQuery> queries;
+        queries.reserve(m_queries.size());
+        queries.insert(queries.end(), m_queries.begin() + m_next, m_queries.end());
+        queries.insert(queries.end(), m_queries.begin(), m_queries.begin() + m_next);
+        return queries;
+    }
+
+    SqliteSlowQueryStats SqliteSlowQueryLog::GetStats()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        SqliteSlowQueryStats stats;
+        stats.slowQueries = m_slowQueries.load(std::memory_order_relaxed);
+        stats.loggedQueries = m_loggedQueries;
+        return stats;
+    }
+
+    void SqliteSlowQueryLog::Clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queries.clear();
+        m_next = 0;
+        m_slowQueries.store(0, std::memory_order_relaxed);
+        m_loggedQueries = 0;
+    }
+}
@@ -0,0 +1,97 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteSlowQueryLog.h $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#pragma once
+extern "C" {
+    #include "sqlite3.h"
+}
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace A3D
+{
+    //--------------------------------------------------------------------------------------
+    // Settings of SqliteWrapper::EnableSlowQueryLog().
+    //+---------------+---------------+---------------+---------------+---------------+------
+    struct SqliteSlowQueryOptions
+    {
+        unsigned int thresholdMs = 100;                              // Runs lasting longer are slow. 0 = log every statement.
+        size_t capacity = 256;                                       // Slow queries kept, the oldest are overwritten beyond.
+        unsigned int sampleEvery = 1;                                // Keep one slow query out of that many, the others are only counted.
+        bool explainPlan = true;                                     // Capture the EXPLAIN QUERY PLAN of the kept ones.
+        bool expandParameters = false;                               // Log the text with the values of its parameters instead of '?'.
+    };
+
+    //--------------------------------------------------------------------------------------
+    // One run of a statement that lasted longer than the threshold.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    struct SqliteSlowQuery
+    {
+        std::string statementText;
+        uint64_t startTimeMs = 0;                                    // Start of the run, milliseconds since the Unix epoch.
+        uint64_t durationNs = 0;                                     // From the first step to the end, the time of the caller between rows included. Millisecond resolution.
+        uint64_t runs = 0;                                           // Runs covered by the counters below: this one and the fast ones since the previous slow run.
+        uint64_t fullscanSteps = 0;                                  // SQLITE_STMTSTATUS_FULLSCAN_STEP of the runs.
+        uint64_t sorts = 0;                                          // SQLITE_STMTSTATUS_SORT.
+        uint64_t autoindexes = 0;                                    // SQLITE_STMTSTATUS_AUTOINDEX.
+        uint64_t vmSteps = 0;                                        // SQLITE_STMTSTATUS_VM_STEP.
+        std::string plan;                                            // EXPLAIN QUERY PLAN, one line per node, indented by depth.
+    };
+
+    struct SqliteSlowQueryStats
+    {
+        uint64_t slowQueries = 0;                                    // Runs over the threshold.
+        uint64_t loggedQueries = 0;                                  // Kept by sampling, including the ones overwritten since.
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Ring buffer of the slow runs of the statements of a connection. A trace callback sees
+    // the end of each statement with the duration measured by SQLite, which is all the fast
+    // runs pay for; only the slow runs read their text, counters and plan. The counters are
+    // reset by the slow runs alone, so they cover the fast runs since the previous slow one.
+    // Thread-safe: the callback runs on the thread executing the statement.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    class SqliteSlowQueryLog
+    {
+    private:
+        std::mutex m_mutex;
+        SqliteSlowQueryOptions m_options;
+        std::vector<SqliteSlowQuery> m_queries;
+        size_t m_next;                                               // Slot of the next query once the buffer is full.
+        std::atomic<uint64_t> m_slowQueries;
+        uint64_t m_loggedQueries;
+
+        void OnEnd(sqlite3_a3d_stmt* statement, uint64_t durationNs);
+        std::string ExplainPlan(sqlite3* database, const char* statementText);
+
+        static int TraceCallback(unsigned int event, void* log, void* p, void* x);
+
+    public:
+        explicit SqliteSlowQueryLog(SqliteSlowQueryOptions const& options);
+        SqliteSlowQueryLog(SqliteSlowQueryLog const&) = delete;
+        SqliteSlowQueryLog& operator=(SqliteSlowQueryLog const&) = delete;
+
+        //--------------------------------------------------------------------------------------
+        // @description Install the trace callback of the log on a connection, replacing any
+        //              other. RemoveTrace() uninstalls it.
+        // @param       database    The connection.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void InstallTrace(sqlite3* database);
+        static void RemoveTrace(sqlite3* database);
+
+        //--------------------------------------------------------------------------------------
+        // @description Return the slow queries kept, the oldest first.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        std::vector<SqliteSlowQuery> GetQueries();
+        SqliteSlowQueryStats GetStats();
+        void Clear();
+    };
+}
@@ -0,0 +1,239 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteStatement.cpp $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#include "SqliteStatement.h"
+#include "SqliteWrapper.h"
+
+#include <algorithm>
+
+namespace A3D
+{
+    SqliteStatement::SqliteStatement()
+        : m_wrapper(nullptr),
+        m_entry(nullptr),
+        m_hasRows(false)
+    {
+    }
+
+    SqliteStatement::SqliteStatement(SqliteStatement&& other) noexcept
+        : m_wrapper(other.m_wrapper),
+        m_entry(other.m_entry),
+        m_hasRows(other.m_hasRows)
+    {
+        other.m_wrapper = nullptr;
+        other.m_entry = nullptr;
+        other.m_hasRows = false;
+    }
+
+    SqliteStatement& SqliteStatement::operator=(SqliteStatement&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Release();
+            m_wrapper = other.m_wrapper;
+            m_entry = other.m_entry;
+            m_hasRows = other.m_hasRows;
+            other.m_wrapper = nullptr;
+            other.m_entry = nullptr;
+            other.m_hasRows = false;
+        }
+        return *this;
+    }
+
+    SqliteStatement::~SqliteStatement()
+    {
+        Release();
+    }
+
+    bool SqliteStatement::IsValid() const
+    {
+        return m_wrapper && m_entry && m_entry->statement;
+    }
+
+    SqliteValue* SqliteStatement::BindingAt(int index)
+    {
+        if (!IsValid() || index < 1)
+        {
+            return nullptr;
+        }
+        if (m_entry->bindings.size() < (size_t)index)
+        {
+            size_t boundCount = m_entry->bindings.size();
+            m_entry->bindings.resize(std::max(index, sqlite3_a3d_bind_parameter_count(m_entry->statement)));
+            // The values already bound moved with the vector, SQLite still points to their old bytes
+            for (size_t i = 0; i < boundCount; ++i)
+            {
+                if (!m_entry->bindings[i].IsNull())
+                {
+                    m_entry->bindings[i].Bind(m_entry->statement, (int)i + 1, false);
+                }
+            }
+        }
+        return &m_entry->bindings[index - 1];
+    }
+
+    bool SqliteStatement::BindValue(int index, SqliteValue const& value)
+    {
+        SqliteValue* binding = BindingAt(index);
+        if (!binding)
+        {
+            return false;
+        }
+        *binding = value;
+        // The entry keeps the bytes alive, no need for SQLite to copy them a second time.
+        return SQLITE_OK == binding->Bind(m_entry->statement, index, false);
+    }
+
+    bool SqliteStatement::BindInt(int index, int value)
+    {
+        return BindInt64(index, value);
+    }
+
+    bool SqliteStatement::BindInt64(int index, sqlite3_a3d_int64 value)
+    {
+        SqliteValue* binding = BindingAt(index);
+        if (!binding)
+        {
+            return false;
+        }
+        binding->SetInt64(value);
+        return SQLITE_OK == sqlite3_a3d_bind_int64(m_entry->statement, index, value);
+    }
+
+    bool SqliteStatement::BindDouble(int index, double value)
+    {
+        SqliteValue* binding = BindingAt(index);
+        if (!binding)
+        {
+            return false;
+        }
+        binding->SetDouble(value);
+        return SQLITE_OK == sqlite3_a3d_bind_double(m_entry->statement, index, value);
+    }
+
+    bool SqliteStatement::BindText(int index, const char* value, int length)
+    {
+        SqliteValue* binding = BindingAt(index);
+        if (!binding)
+        {
+            return false;
+        }
+        binding->SetText(value, length);
+        return SQLITE_OK == binding->Bind(m_entry->statement, index, false);
+    }
+
+    bool SqliteStatement::BindBlob(int index, const void* data, int size)
+    {
+        SqliteValue* binding = BindingAt(index);
+        if (!binding)
+        {
+            return false;
+        }
+        binding->SetBlob(data, size);
+        return SQLITE_OK == binding->Bind(m_entry->statement, index, false);
+    }
+
+    bool SqliteStatement::BindNull(int index)
+    {
+        SqliteValue* binding = BindingAt(index);
+        if (!binding)
+        {
+            return false;
+        }
+        binding->SetNull();
+        return SQLITE_OK == sqlite3_a3d_bind_null(m_entry->statement, index);
+    }
+
+    bool SqliteStatement::Step(int& retValue, int* pnUpdatedRows, int* pnRetries)
+    {
+        // The statement itself may be missing after a failed reconnection, the wrapper prepares it again
+        if (!m_wrapper || !m_entry)
+        {
+            return false;
+        }
+        return m_wrapper->StepStatement(*this, retValue, pnUpdatedRows, pnRetries);
+    }
+
+    bool SqliteStatement::Exec(int& retValue)
+    {
+        bool succeeded;
+        do
+        {
+            succeeded = Step(retValue);
+        } while (succeeded && retValue == SQLITE_ROW);
+        Reset();
+        return succeeded;
+    }
+
+    bool SqliteStatement::Exec()
+    {
+        int retValue;
+        return Exec(retValue);
+    }
+
+    bool SqliteStatement::ForEachRow(int& retValue, SqliteRowVisitor const& visitor)
+    {
+        bool succeeded;
+        while ((succeeded = Step(retValue)) && retValue == SQLITE_ROW)
+        {
+            if (!visitor(GetRow()))
+            {
+                break;
+            }
+        }
+        Reset();
+        return succeeded;
+    }
+
+    SqliteRow SqliteStatement::GetRow() const
+    {
+        return SqliteRow(GetHandle());
+    }
+
+    bool SqliteStatement::Reset()
+    {
+        if (!IsValid())
+        {
+            return false;
+        }
+        m_hasRows = false;
+        m_wrapper->FinishExecution(*m_entry, true);
+        // sqlite3_a3d_reset() repeats the error of the last step, this is not a failure of the reset itself
+        sqlite3_a3d_reset(m_entry->statement);
+        return true;
+    }
+
+    bool SqliteStatement::ClearBindings()
+    {
+        if (!IsValid())
+        {
+            return false;
+        }
+        for (SqliteValue& binding : m_entry->bindings)
+        {
+            binding.SetNull();
+        }
+        return SQLITE_OK == sqlite3_a3d_clear_bindings(m_entry->statement);
+    }
+
+    void SqliteStatement::Release()
+    {
+        if (m_wrapper && m_entry)
+        {
+            m_wrapper->ReleaseStatement(m_entry);
+        }
+        m_wrapper = nullptr;
+        m_entry = nullptr;
+        m_hasRows = false;
+    }
+
+    sqlite3_a3d_stmt* SqliteStatement::GetHandle() const
+    {
+        return m_entry ? m_entry->statement : nullptr;
+    }
+}
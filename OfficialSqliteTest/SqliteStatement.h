@@ -0,0 +1,147 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteStatement.h $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#pragma once
+#include "SqliteRow.h"
+#include "SqliteValue.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace A3D
+{
+    class SqliteWrapper;
+    struct SqliteStatementCounters;
+
+    //--------------------------------------------------------------------------------------
+    // A prepared statement kept by the statement cache of a SqliteWrapper.
+    // The bound parameters are remembered so the statement can be prepared again and
+    // rebound transparently if the wrapper has to reconnect.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    struct SqliteStatementEntry
+    {
+        std::string statementText;
+        sqlite3_a3d_stmt* statement = nullptr;
+        unsigned int generation = 0;                                 // Connection generation the statement was prepared on.
+        bool inUse = false;                                          // Checked out by a SqliteStatement.
+        bool isCached = false;                                       // Owned by the cache, otherwise by the SqliteStatement.
+        std::vector<SqliteValue> bindings;
+
+        // Metrics of the execution in progress, recorded when it is done or reset
+        SqliteStatementCounters* counters = nullptr;
+        bool isExecuting = false;
+        uint64_t executionNs = 0;
+        uint64_t executionLockWaitNs = 0;
+        uint64_t executionRows = 0;
+        int executionRetries = 0;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Handle on a prepared statement obtained with SqliteWrapper::Prepare().
+    // The statement is reset and given back to the wrapper cache when the handle is
+    // destroyed or released. A handle must not outlive the wrapper it comes from and must
+    // not be used by several threads at the same time.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    class SqliteStatement
+    {
+    private:
+        friend class SqliteCursor;
+        friend class SqliteWrapper;
+
+        SqliteWrapper* m_wrapper;
+        SqliteStatementEntry* m_entry;
+        bool m_hasRows;                                              // A row was returned since the last reset: do not replay the statement.
+
+        SqliteValue* BindingAt(int index);
+
+    public:
+        SqliteStatement();
+        SqliteStatement(SqliteStatement&& other) noexcept;
+        SqliteStatement& operator=(SqliteStatement&& other) noexcept;
+        SqliteStatement(SqliteStatement const&) = delete;
+        SqliteStatement& operator=(SqliteStatement const&) = delete;
+        ~SqliteStatement();
+
+        //--------------------------------------------------------------------------------------
+        // @description   Check if the handle holds a prepared statement.
+        // @return        True if valid, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool IsValid() const;
+
+        //--------------------------------------------------------------------------------------
+        // @description Bind a value to a parameter. Parameter indexes start at 1.
+        // @param       index   Index of the parameter.
+        // @param       value   The value.
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool BindInt(int index, int value);
+        bool BindInt64(int index, sqlite3_a3d_int64 value);
+        bool BindDouble(int index, double value);
+        bool BindText(int index, const char* value, int length = -1);
+        bool BindBlob(int index, const void* data, int size);
+        bool BindNull(int index);
+        bool BindValue(int index, SqliteValue const& value);
+
+        //--------------------------------------------------------------------------------------
+        // @description Evaluate the statement once, with the same BUSY/IOERR retry and reconnect
+        //              behavior as SqliteWrapper::ExecStatement().
+        // @param       retValue        Return code after execution: SQLITE_ROW if a row is
+        //                              available, SQLITE_DONE when the statement has finished.
+        // @param       pnUpdatedRows   If not null, return the number of rows actually updated by the execution of the statement
+        // @param       pnRetries       If not null, return the number of times the call waited because the database was locked
+        // @return      True if everything went well (SQLITE_ROW or SQLITE_DONE), false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool Step(int& retValue, int* pnUpdatedRows = nullptr, int* pnRetries = nullptr);
+
+        //--------------------------------------------------------------------------------------
+        // @description Evaluate the statement until it is done and reset it, keeping the bindings.
+        // @param       retValue        Return code after execution.
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool Exec(int& retValue);
+        bool Exec();
+
+        //--------------------------------------------------------------------------------------
+        // @description Evaluate the statement and call the visitor for each row, then reset the
+        //              statement. Values are read straight from SQLite without any copy.
+        // @param       retValue    Return code after execution.
+        // @param       visitor     Called with each row, returns false to stop early.
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool ForEachRow(int& retValue, SqliteRowVisitor const& visitor);
+
+        //--------------------------------------------------------------------------------------
+        // @description Return a typed view on the current row, after Step() returned SQLITE_ROW.
+        // @return      The row.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        SqliteRow GetRow() const;
+
+        //--------------------------------------------------------------------------------------
+        // @description Reset the statement so that it can be evaluated again. Bindings are kept.
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool Reset();
+
+        //--------------------------------------------------------------------------------------
+        // @description Set all the parameters back to NULL.
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool ClearBindings();
+
+        //--------------------------------------------------------------------------------------
+        // @description Give the statement back to the wrapper cache. The handle becomes invalid.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void Release();
+
+        //--------------------------------------------------------------------------------------
+        // @description Return the underlying statement. It may change after a reconnection.
+        // @return      The statement, nullptr if the handle is not valid.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        sqlite3_a3d_stmt* GetHandle() const;
+    };
+}
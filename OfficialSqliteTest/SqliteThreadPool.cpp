@@ -0,0 +1,79 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteThreadPool.cpp $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#include "SqliteThreadPool.h"
+
+namespace A3D
+{
+    SqliteThreadPool::SqliteThreadPool(size_t threadCount)
+        : m_isStopping(false)
+    {
+        if (threadCount == 0)
+        {
+            threadCount = std::thread::hardware_concurrency();
+        }
+        if (threadCount == 0)
+        {
+            threadCount = 1;
+        }
+        m_threads.reserve(threadCount);
+        for (size_t i = 0; i < threadCount; ++i)
+        {
+            m_threads.emplace_back(&SqliteThreadPool::WorkerLoop, this);
+        }
+    }
+
+    SqliteThreadPool::~SqliteThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_isStopping = true;
+        }
+        m_wake.notify_all();
+        for (std::thread& thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    std::future<void> SqliteThreadPool::Submit(std::function<void()> task)
+    {
+        std::packaged_task<void()> packagedTask(std::move(task));
+        std::future<void> future = packagedTask.get_future();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push_back(std::move(packagedTask));
+        }
+        m_wake.notify_one();
+        return future;
+    }
+
+    size_t SqliteThreadPool::GetThreadCount() const
+    {
+        return m_threads.size();
+    }
+
+    void SqliteThreadPool::WorkerLoop()
+    {
+        while (true)
+        {
+            std::packaged_task<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [this]() { return m_isStopping || !m_tasks.empty(); });
+                if (m_tasks.empty())
+                {
+                    return;
+                }
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            task();
+        }
+    }
+}
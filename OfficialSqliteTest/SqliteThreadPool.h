@@ -0,0 +1,53 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteThreadPool.h $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace A3D
+{
+    //--------------------------------------------------------------------------------------
+    // Fixed set of threads running the tasks submitted by any thread, in submission order.
+    // Pending tasks are still run by the destructor before the threads stop.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    class SqliteThreadPool
+    {
+    private:
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::deque<std::packaged_task<void()>> m_tasks;
+        bool m_isStopping;
+        std::vector<std::thread> m_threads;
+
+        void WorkerLoop();
+
+    public:
+        //--------------------------------------------------------------------------------------
+        // @param       threadCount     Number of threads. 0 = one per hardware thread.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        explicit SqliteThreadPool(size_t threadCount);
+        SqliteThreadPool(SqliteThreadPool const&) = delete;
+        SqliteThreadPool& operator=(SqliteThreadPool const&) = delete;
+        ~SqliteThreadPool();
+
+        //--------------------------------------------------------------------------------------
+        // @description Run a task on one of the threads.
+        // @param       task    The task. It must not wait for tasks submitted after it.
+        // @return      Ready once the task has run, rethrows what the task threw.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        std::future<void> Submit(std::function<void()> task);
+
+        size_t GetThreadCount() const;
+    };
+}
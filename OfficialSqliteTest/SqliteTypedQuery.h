@@ -0,0 +1,285 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteTypedQuery.h $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#pragma once
+#include "SqliteWrapper.h"
+#include <stdint.h>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace A3D
+{
+    //--------------------------------------------------------------------------------------
+    // How a C++ type is bound to a parameter and read from a column, chosen at compile
+    // time by SqliteTypedQuery. Specialize it to bind or read other types.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    template<typename T, typename Enable = void>
+    struct SqliteTypeTraits;
+
+    // Integers of any size, bool included
+    template<typename T>
+    struct SqliteTypeTraits<T, typename std::enable_if<std::is_integral<T>::value>::type>
+    {
+        static bool Bind(SqliteStatement& statement, int index, T value) { return statement.BindInt64(index, (sqlite3_a3d_int64)value); }
+        static T Read(sqlite3_a3d_stmt* statement, int column) { return (T)sqlite3_a3d_column_int64(statement, column); }
+    };
+
+    template<typename T>
+    struct SqliteTypeTraits<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+    {
+        static bool Bind(SqliteStatement& statement, int index, T value) { return statement.BindDouble(index, (double)value); }
+        static T Read(sqlite3_a3d_stmt* statement, int column) { return (T)sqlite3_a3d_column_double(statement, column); }
+    };
+
+    template<>
+    struct SqliteTypeTraits<std::string_view>
+    {
+        static bool Bind(SqliteStatement& statement, int index, std::string_view value) { return statement.BindText(index, value.data(), (int)value.size()); }
+        // Points into SQLite memory, valid until the next row
+        static std::string_view Read(sqlite3_a3d_stmt* statement, int column)
+        {
+            const char* text = (const char*)sqlite3_a3d_column_text(statement, column);
+            return std::string_view(text, text ? sqlite3_a3d_column_bytes(statement, column) : 0);
+        }
+    };
+
+    template<>
+    struct SqliteTypeTraits<std::string>
+    {
+        static bool Bind(SqliteStatement& statement, int index, std::string const& value) { return statement.BindText(index, value.data(), (int)value.size()); }
+        static std::string Read(sqlite3_a3d_stmt* statement, int column) { return std::string(SqliteTypeTraits<std::string_view>::Read(statement, column)); }
+    };
+
+    template<>
+    struct SqliteTypeTraits<const char*>
+    {
+        static bool Bind(SqliteStatement& statement, int index, const char* value) { return value ? statement.BindText(index, value, -1) : statement.BindNull(index); }
+    };
+
+    template<>
+    struct SqliteTypeTraits<SqliteBlob>
+    {
+        static bool Bind(SqliteStatement& statement, int index, SqliteBlob const& value) { return statement.BindBlob(index, value.data, value.size); }
+        // Points into SQLite memory, valid until the next row
+        static SqliteBlob Read(sqlite3_a3d_stmt* statement, int column)
+        {
+            SqliteBlob blob;
+            blob.data = sqlite3_a3d_column_blob(statement, column);
+            blob.size = blob.data ? sqlite3_a3d_column_bytes(statement, column) : 0;
+            return blob;
+        }
+    };
+
+    template<>
+    struct SqliteTypeTraits<std::vector<uint8_t>>
+    {
+        static bool Bind(SqliteStatement& statement, int index, std::vector<uint8_t> const& value) { return statement.BindBlob(index, value.data(), (int)value.size()); }
+        static std::vector<uint8_t> Read(sqlite3_a3d_stmt* statement, int column)
+        {
+            SqliteBlob blob = SqliteTypeTraits<SqliteBlob>::Read(statement, column);
+            const uint8_t* bytes = (const uint8_t*)blob.data;
+            return std::vector<uint8_t>(bytes, bytes + blob.size);
+        }
+    };
+
+    template<>
+    struct SqliteTypeTraits<std::nullptr_t>
+    {
+        static bool Bind(SqliteStatement& statement, int index, std::nullptr_t) { return statement.BindNull(index); }
+    };
+
+    // NULL when empty
+    template<typename T>
+    struct SqliteTypeTraits<std::optional<T>>
+    {
+        static bool Bind(SqliteStatement& statement, int index, std::optional<T> const& value) { return value ? SqliteTypeTraits<T>::Bind(statement, index, *value) : statement.BindNull(index); }
+        static std::optional<T> Read(sqlite3_a3d_stmt* statement, int column)
+        {
+            if (sqlite3_a3d_column_type(statement, column) == SQLITE_NULL)
+            {
+                return std::nullopt;
+            }
+            return SqliteTypeTraits<T>::Read(statement, column);
+        }
+    };
+
+    template<typename Params, typename Columns>
+    class SqliteTypedQuery;
+
+    //--------------------------------------------------------------------------------------
+    // Statement of a SqliteWrapper with parameter and column types known at compile time:
+    //
+    //     SqliteTypedQuery<std::tuple<int64_t>, std::tuple<int64_t, std::string_view>> query;
+    //     query.Prepare(wrapper, "SELECT a, c FROM t1 WHERE b < ?", retValue);
+    //     query.ForEachRow(retValue, [](int64_t a, std::string_view c) { ...; return true; }, 1000);
+    //
+    // Each parameter is bound and each column read with the sqlite3_a3d_bind_* and
+    // sqlite3_a3d_column_* call of its type, without any conversion to text nor type
+    // switch at run time; only std::string and blob vectors columns allocate. Prepared
+    // once through the statement cache of the wrapper, like SqliteStatement.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    template<typename... Params, typename... Columns>
+    class SqliteTypedQuery<std::tuple<Params...>, std::tuple<Columns...>>
+    {
+    private:
+        SqliteStatement m_statement;
+
+        template<size_t... Indexes>
+        bool BindAll(std::index_sequence<Indexes...>, Params const&... params)
+        {
+            bool succeeded = true;
+            // Expanded in parameter order
+            (void)std::initializer_list<int>{ (succeeded = succeeded && SqliteTypeTraits<typename std::decay<Params>::type>::Bind(m_statement, (int)Indexes + 1, params), 0)... };
+            return succeeded;
+        }
+
+        template<typename Visitor, size_t... Indexes>
+        bool Visit(Visitor& visitor, sqlite3_a3d_stmt* statement, std::index_sequence<Indexes...>)
+        {
+            return visitor(SqliteTypeTraits<Columns>::Read(statement, (int)Indexes)...);
+        }
+
+    public:
+        typedef std::tuple<Columns...> Row;
+
+        //--------------------------------------------------------------------------------------
+        // @description Prepare the statement and check it has as many parameters and columns
+        //              as the query types.
+        // @param       wrapper         The wrapper. Must outlive the query.
+        // @param       statementText   The request.
+        // @param       retValue        Return code of the preparation, SQLITE_RANGE if the
+        //                              number of parameters or columns does not match.
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool Prepare(SqliteWrapper& wrapper, const char* statementText, int& retValue)
+        {
+            if (!wrapper.Prepare(statementText, m_statement, retValue))
+            {
+                return false;
+            }
+            sqlite3_a3d_stmt* statement = m_statement.GetHandle();
+            if (sqlite3_a3d_bind_parameter_count(statement) != (int)sizeof...(Params)
+                || sqlite3_a3d_column_count(statement) != (int)sizeof...(Columns))
+            {
+                m_statement.Release();
+                retValue = SQLITE_RANGE;
+                return false;
+            }
+            return true;
+        }
+
+        bool IsValid() const
+        {
+            return m_statement.IsValid();
+        }
+
+        //--------------------------------------------------------------------------------------
+        // @description Bind the parameters, execute the statement and visit its rows.
+        // @param       retValue    Return code after execution.
+        // @param       visitor     Called with the columns of each row as arguments, one per
+        //                          column type; returns false to stop early.
+        // @param       params      The parameters.
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        template<typename Visitor>
+        bool ForEachRow(int& retValue, Visitor&& visitor, Params const&... params)
+        {
+            if (!BindAll(std::index_sequence_for<Params...>(), params...))
+            {
+                retValue = m_statement.IsValid() ? SQLITE_RANGE : SQLITE_MISUSE;
+                m_statement.Reset();
+                return false;
+            }
+            bool succeeded;
+            while ((succeeded = m_statement.Step(retValue)) && retValue == SQLITE_ROW)
+            {
+                // The handle changes if the wrapper reconnected during the step
+                if (!Visit(visitor, m_statement.GetHandle(), std::index_sequence_for<Columns...>()))
+                {
+                    break;
+                }
+            }
+            m_statement.Reset();
+            return succeeded;
+        }
+
+        //--------------------------------------------------------------------------------------
+        // @description Bind the parameters and execute the statement, ignoring its rows:
+        //              for writes.
+        // @param       retValue        Return code after execution.
+        // @param       pnUpdatedRows   If not null, return the number of rows actually updated by the execution of the statement
+        // @param       params          The parameters.
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool Exec(int& retValue, int* pnUpdatedRows, Params const&... params)
+        {
+            if (!BindAll(std::index_sequence_for<Params...>(), params...))
+            {
+                retValue = m_statement.IsValid() ? SQLITE_RANGE : SQLITE_MISUSE;
+                m_statement.Reset();
+                return false;
+            }
+            bool succeeded;
+            do
+            {
+                succeeded = m_statement.Step(retValue, pnUpdatedRows);
+            } while (succeeded && retValue == SQLITE_ROW);
+            m_statement.Reset();
+            return succeeded;
+        }
+
+        //--------------------------------------------------------------------------------------
+        // @description Execute the statement and decode each row into a value of 'Struct',
+        //              built from the columns in order: an aggregate with one member per
+        //              column, or a type with a constructor taking the columns.
+        // @param       rows        The rows are appended to it.
+        // @param       retValue    Return code after execution.
+        // @param       params      The parameters.
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        template<typename Struct = Row>
+        bool Query(std::vector<Struct>& rows, int& retValue, Params const&... params)
+        {
+            return ForEachRow(retValue, [&rows](Columns... columns)
+            {
+                rows.push_back(Struct{ std::move(columns)... });
+                return true;
+            }, params...);
+        }
+
+        //--------------------------------------------------------------------------------------
+        // @description Execute the statement and decode its first row.
+        // @param       row         Set to the first row, unchanged if there is none.
+        // @param       retValue    Return code after execution.
+        // @param       params      The parameters.
+        // @return      True if there was a row, false if there was none or on error.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        template<typename Struct = Row>
+        bool QueryOne(Struct& row, int& retValue, Params const&... params)
+        {
+            bool hasRow = false;
+            bool succeeded = ForEachRow(retValue, [&row, &hasRow](Columns... columns)
+            {
+                row = Struct{ std::move(columns)... };
+                hasRow = true;
+                return false;
+            }, params...);
+            return succeeded && hasRow;
+        }
+
+        void Release()
+        {
+            m_statement.Release();
+        }
+    };
+}
@@ -0,0 +1,175 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteValue.cpp $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#include "SqliteValue.h"
+
+namespace A3D
+{
+    SqliteValue::SqliteValue()
+        : m_type(SQLITE_NULL),
+        m_integer(0),
+        m_float(0.0)
+    {
+    }
+
+    SqliteValue::SqliteValue(sqlite3_a3d_int64 value)
+        : SqliteValue()
+    {
+        SetInt64(value);
+    }
+
+    SqliteValue::SqliteValue(int value)
+        : SqliteValue()
+    {
+        SetInt64(value);
+    }
+
+    SqliteValue::SqliteValue(double value)
+        : SqliteValue()
+    {
+        SetDouble(value);
+    }
+
+    SqliteValue::SqliteValue(const char* value, int length)
+        : SqliteValue()
+    {
+        SetText(value, length);
+    }
+
+    SqliteValue::SqliteValue(std::string const& value)
+        : SqliteValue()
+    {
+        SetText(value.data(), (int)value.size());
+    }
+
+    SqliteValue SqliteValue::Blob(const void* data, int size)
+    {
+        SqliteValue value;
+        value.SetBlob(data, size);
+        return value;
+    }
+
+    void SqliteValue::SetNull()
+    {
+        m_type = SQLITE_NULL;
+        m_bytes.clear();
+    }
+
+    void SqliteValue::SetInt64(sqlite3_a3d_int64 value)
+    {
+        m_type = SQLITE_INTEGER;
+        m_integer = value;
+    }
+
+    void SqliteValue::SetDouble(double value)
+    {
+        m_type = SQLITE_FLOAT;
+        m_float = value;
+    }
+
+    void SqliteValue::SetText(const char* value, int length)
+    {
+        if (!value)
+        {
+            SetNull();
+            return;
+        }
+        m_type = SQLITE_TEXT;
+        // assign() reuses the current capacity, so rebinding a value of similar size does not allocate
+        m_bytes.assign(value, length < 0 ? std::char_traits<char>::length(value) : (size_t)length);
+    }
+
+    void SqliteValue::SetBlob(const void* data, int size)
+    {
+        m_type = SQLITE_BLOB;
+        m_bytes.assign(reinterpret_cast<const char*>(data), size > 0 ? (size_t)size : 0);
+    }
+
+    int SqliteValue::GetType() const
+    {
+        return m_type;
+    }
+
+    bool SqliteValue::IsNull() const
+    {
+        return m_type == SQLITE_NULL;
+    }
+
+    sqlite3_a3d_int64 SqliteValue::GetInt64() const
+    {
+        return m_type == SQLITE_FLOAT ? (sqlite3_a3d_int64)m_float : m_integer;
+    }
+
+    double SqliteValue::GetDouble() const
+    {
+        return m_type == SQLITE_INTEGER ? (double)m_integer : m_float;
+    }
+
+    std::string const& SqliteValue::GetBytes() const
+    {
+        return m_bytes;
+    }
+
+    // Rank of the storage classes in the sort order of SQLite
+    static int GetSortClass(int type)
+    {
+        switch (type)
+        {
+        case SQLITE_NULL:
+            return 0;
+        case SQLITE_INTEGER:
+        case SQLITE_FLOAT:
+            return 1;
+        case SQLITE_TEXT:
+            return 2;
+        default:
+            return 3;
+        }
+    }
+
+    int SqliteValue::Compare(SqliteValue const& other) const
+    {
+        int sortClass = GetSortClass(m_type);
+        int otherSortClass = GetSortClass(other.m_type);
+        if (sortClass != otherSortClass)
+        {
+            return sortClass - otherSortClass;
+        }
+        switch (sortClass)
+        {
+        case 0:
+            return 0;
+        case 1:
+            if (m_type == SQLITE_INTEGER && other.m_type == SQLITE_INTEGER)
+            {
+                return m_integer < other.m_integer ? -1 : m_integer > other.m_integer ? 1 : 0;
+            }
+            return GetDouble() < other.GetDouble() ? -1 : GetDouble() > other.GetDouble() ? 1 : 0;
+        default:
+            return m_bytes.compare(other.m_bytes);
+        }
+    }
+
+    int SqliteValue::Bind(sqlite3_a3d_stmt* statement, int index, bool copyBytes) const
+    {
+        sqlite3_a3d_destructor_type destructor = copyBytes ? SQLITE_TRANSIENT : SQLITE_STATIC;
+        switch (m_type)
+        {
+        case SQLITE_INTEGER:
+            return sqlite3_a3d_bind_int64(statement, index, m_integer);
+        case SQLITE_FLOAT:
+            return sqlite3_a3d_bind_double(statement, index, m_float);
+        case SQLITE_TEXT:
+            return sqlite3_a3d_bind_text(statement, index, m_bytes.data(), (int)m_bytes.size(), destructor);
+        case SQLITE_BLOB:
+            return sqlite3_a3d_bind_blob(statement, index, m_bytes.data(), (int)m_bytes.size(), destructor);
+        default:
+            return sqlite3_a3d_bind_null(statement, index);
+        }
+    }
+}
@@ -0,0 +1,75 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteValue.h $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#pragma once
+extern "C" {
+    #include "sqlite3.h"
+}
+#include <string>
+
+namespace A3D
+{
+    //--------------------------------------------------------------------------------------
+    // A single SQLite value (NULL, integer, float, text or blob) owned by the wrapper.
+    // Used to remember statement parameters so they can be bound again later.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    class SqliteValue
+    {
+    private:
+        int m_type;                                                  // SQLITE_NULL, SQLITE_INTEGER, SQLITE_FLOAT, SQLITE_TEXT or SQLITE_BLOB
+        sqlite3_a3d_int64 m_integer;
+        double m_float;
+        std::string m_bytes;                                         // Text or blob content.
+
+    public:
+        SqliteValue();
+        SqliteValue(sqlite3_a3d_int64 value);
+        SqliteValue(int value);
+        SqliteValue(double value);
+        SqliteValue(const char* value, int length = -1);
+        SqliteValue(std::string const& value);
+
+        //--------------------------------------------------------------------------------------
+        // @description Build a blob value. The bytes are copied.
+        // @param       data    Pointer to the first byte.
+        // @param       size    Number of bytes.
+        // @return      The new value.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        static SqliteValue Blob(const void* data, int size);
+
+        void SetNull();
+        void SetInt64(sqlite3_a3d_int64 value);
+        void SetDouble(double value);
+        void SetText(const char* value, int length = -1);
+        void SetBlob(const void* data, int size);
+
+        int GetType() const;
+        bool IsNull() const;
+        sqlite3_a3d_int64 GetInt64() const;
+        double GetDouble() const;
+        std::string const& GetBytes() const;
+
+        //--------------------------------------------------------------------------------------
+        // @description Compare with another value in the order of SQLite with the BINARY
+        //              collation: NULL first, then numbers, text and blobs.
+        // @param       other   The value to compare with.
+        // @return      A negative number, 0 or a positive number if this value is smaller, equal or greater.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        int Compare(SqliteValue const& other) const;
+
+        //--------------------------------------------------------------------------------------
+        // @description Bind this value to a parameter of a prepared statement.
+        // @param       statement   The statement.
+        // @param       index       Index of the parameter, the first one being 1.
+        // @param       copyBytes   If false, text and blobs are bound with SQLITE_STATIC: this value
+        //                          must then outlive the binding and must not be modified meanwhile.
+        // @return      The SQLite return code of the sqlite3_a3d_bind_* call.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        int Bind(sqlite3_a3d_stmt* statement, int index, bool copyBytes = true) const;
+    };
+}
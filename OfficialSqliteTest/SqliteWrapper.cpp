@@ -8,12 +8,47 @@
 
 #include "SqliteWrapper.h"
 
+#include <ctype.h>
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include <thread>
 
 namespace A3D
 {
+    static thread_local SqliteRetryState* t_retryState = nullptr;
+
+    // Set on the threads of the asynchronous queries, which wait for a timer instead of sleeping
+    static thread_local bool t_noWaitOnBusy = false;
+
+    // Wrappers whose connection lock is held by an open cursor of this thread, once per cursor
+    static thread_local std::vector<SqliteWrapper const*> t_cursorLocks;
+
+    // Retry bookkeeping of the call in progress on this thread, shared with the busy handler
+    struct SqliteRetryState
+    {
+        std::chrono::steady_clock::time_point start;
+        bool retry;
+        int retries;
+        bool alreadyTriedReconnecting;
+        SqliteRetryState* previous;
+
+        explicit SqliteRetryState(bool retryIfLocked)
+            : start(std::chrono::steady_clock::now()),
+            retry(retryIfLocked),
+            retries(0),
+            alreadyTriedReconnecting(false),
+            previous(t_retryState)
+        {
+            t_retryState = this;
+        }
+
+        ~SqliteRetryState()
+        {
+            t_retryState = previous;
+        }
+    };
+
     bool SqliteWrapper::InitDatabase()
     {
         if (m_database)
@@ -22,30 +57,284 @@ namespace A3D
         }
 
         // Open or create DB
-        if (SQLITE_OK != sqlite3_a3d_open_v2(m_databasePath.c_str(), &m_database, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX, nullptr))
+        if (SQLITE_OK != sqlite3_a3d_open_v2(m_databasePath.c_str(), &m_database, m_openFlags, nullptr))
         {
             return false;
         }
-        sqlite3_a3d_busy_timeout(m_database, 2000);
+        InstallBusyHandler();
         m_isOpened = true;
 
         return m_isOpened;
     }
 
+    bool SqliteWrapper::OpenDeferredDatabase()
+    {
+        // Recursive: applying the options locks the connection, which comes back here on the same thread
+        std::lock_guard<std::recursive_mutex> lock(m_openMutex);
+        if (m_isOpening || !m_isOpenDeferred.load(std::memory_order_relaxed))
+        {
+            return m_isOpened;
+        }
+        m_isOpening = true;
+        if (InitDatabase())
+        {
+            ApplyOptions(*m_deferredOptions);
+        }
+        m_deferredOptions.reset();
+        m_isOpening = false;
+        m_isOpenDeferred.store(false, std::memory_order_release);
+        return m_isOpened;
+    }
+
+    // Read the tables of SetWarmupTables() into the page cache of the connection
+    static void warmupTables(sqlite3* database, std::vector<std::string> const& tables)
+    {
+        for (std::string const& table : tables)
+        {
+            // count(*) would only walk the smallest index: the length of every column as a blob
+            // reads the leaves of the table b-tree and their overflow pages
+            char* columnsText = sqlite3_a3d_mprintf("SELECT group_concat(printf('length(CAST(\"%%w\" AS BLOB))', name), '+') FROM pragma_table_info(%Q)", table.c_str());
+            sqlite3_a3d_stmt* columns = nullptr;
+            std::string lengthsText;
+            if (SQLITE_OK == sqlite3_a3d_prepare_v2(database, columnsText, -1, &columns, nullptr) && SQLITE_ROW == sqlite3_a3d_step(columns)
+                && sqlite3_a3d_column_text(columns, 0))
+            {
+                lengthsText = reinterpret_cast<const char*>(sqlite3_a3d_column_text(columns, 0));
+            }
+            sqlite3_a3d_finalize(columns);
+            sqlite3_a3d_free(columnsText);
+            // No columns: the table does not exist
+            if (lengthsText.empty())
+            {
+                continue;
+            }
+            char* statementText = sqlite3_a3d_mprintf("SELECT sum(%s) FROM \"%w\"", lengthsText.c_str(), table.c_str());
+            sqlite3_a3d_exec(database, statementText, nullptr, nullptr, nullptr);
+            sqlite3_a3d_free(statementText);
+        }
+    }
+
+    bool SqliteWrapper::RunWarmup(std::vector<std::string> const& hotStatements)
+    {
+        if (!IsReady())
+        {
+            return false;
+        }
+        // Reading the schema table parses the schema and brings its pages into the page cache
+        int retValue;
+        bool succeeded = ExecStatement("SELECT count(*) FROM sqlite_master", retValue);
+        for (std::string const& statementText : hotStatements)
+        {
+            // Given back to the cache, prepared
+            SqliteStatement statement;
+            if (!Prepare(statementText.c_str(), statement, retValue))
+            {
+                std::cout << "Warmup: could not prepare " << statementText << std::endl;
+                succeeded = false;
+            }
+            statement.Release();
+        }
+
+        bool isLocked = LockConnection(false, nullptr, nullptr);
+        warmupTables(m_database, m_warmupTables);
+        if (isLocked)
+        {
+            UnlockConnection(false);
+        }
+        return succeeded;
+    }
+
     bool SqliteWrapper::Reconnect()
     {
-        m_dbConnectionMutex.lock();
-        sqlite3_a3d_close_v2(m_database);
-        if (SQLITE_OK != sqlite3_a3d_open_v2(m_databasePath.c_str(), &m_database, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX, nullptr))
+        // The connection cannot be replaced under an open cursor, and waiting for it would never end
+        if (HoldsCursorLock())
         {
-            m_dbConnectionMutex.unlock();
             return false;
         }
-        m_dbConnectionMutex.unlock();
+        // Opened first, so that the wrapper keeps its connection if this fails
+        sqlite3* newDatabase = nullptr;
+        if (SQLITE_OK != sqlite3_a3d_open_v2(m_databasePath.c_str(), &newDatabase, m_openFlags, nullptr))
+        {
+            sqlite3_a3d_close_v2(newDatabase);
+            return false;
+        }
+
+        bool isLocked = LockConnection(true, nullptr, nullptr);
+        {
+            // Statements in use are prepared again on the new connection by their next step
+            std::lock_guard<std::mutex> cacheLock(m_statementCacheMutex);
+            for (SqliteStatementEntry& entry : m_statementCache)
+            {
+                if (!entry.inUse && entry.statement)
+                {
+                    sqlite3_a3d_finalize(entry.statement);
+                    entry.statement = nullptr;
+                }
+            }
+        }
+        // Closed before the session is replayed, so that its locks are released. It stays open
+        // as a zombie until the statements still in use are prepared again.
+        sqlite3_a3d_close_v2(m_database);
+        m_database = newDatabase;
+        ++m_connectionGeneration;
+        if (SqliteMetrics* metrics = GetEnabledMetrics())
+            metrics->RecordReconnect();
+        InstallBusyHandler();
+        if (m_checkpointer)
+        {
+            sqlite3_a3d_wal_hook(m_database, &SqliteCheckpointer::WalHook, m_checkpointer.get());
+        }
+        if (m_resultCache)
+        {
+            // The transaction in progress, if any, was rolled back by closing the old connection
+            m_resultCache->ResetTransaction();
+            m_resultCache->InstallHooks(m_database);
+        }
+        if (m_slowQueryLog)
+        {
+            m_slowQueryLog->InstallTrace(m_database);
+        }
+        ReplaySession();
+        if (isLocked)
+        {
+            UnlockConnection(true);
+        }
 
         return true;
     }
 
+    void SqliteWrapper::ReplaySession()
+    {
+        // m_dbConnectionMutex must be held exclusively by the caller, unless single-threaded
+        for (auto const& setup : m_connectionSetups)
+        {
+            if (SQLITE_OK != setup.second(m_database))
+            {
+                std::cout << "Reconnect: could not restore " << setup.first << ": " << sqlite3_a3d_errmsg(m_database) << std::endl;
+            }
+        }
+
+        {
+            // Prepared now rather than by their next step, with their saved bindings
+            std::lock_guard<std::mutex> cacheLock(m_statementCacheMutex);
+            for (SqliteStatementEntry& entry : m_statementCache)
+            {
+                int retValue;
+                if (!entry.inUse && !entry.statement)
+                {
+                    PrepareEntry(entry, retValue);
+                }
+            }
+        }
+
+        warmupTables(m_database, m_warmupTables);
+    }
+
+    std::vector<std::string> SqliteWrapper::GetFunctionNames() const
+    {
+        // From the keys of CreateFunction(): "function name/argCount"
+        std::vector<std::string> functionNames;
+        for (auto const& setup : m_connectionSetups)
+        {
+            if (setup.first.compare(0, 9, "function ") == 0)
+            {
+                functionNames.push_back(setup.first.substr(9, setup.first.rfind('/') - 9));
+            }
+        }
+        return functionNames;
+    }
+
+    bool SqliteWrapper::ApplyOptions(SqliteWrapperOptions const& options)
+    {
+        int retValue;
+        bool succeeded = true;
+        // The lookaside can only change while none of its memory is used, first thing after opening
+        if (options.lookasideSlotSize > 0 && options.lookasideSlotCount > 0)
+        {
+            int slotSize = options.lookasideSlotSize;
+            int slotCount = options.lookasideSlotCount;
+            succeeded &= AddConnectionSetup("lookaside", [slotSize, slotCount](sqlite3* database)
+            {
+                return sqlite3_a3d_db_config(database, SQLITE_DBCONFIG_LOOKASIDE, nullptr, slotSize, slotCount);
+            }, retValue);
+        }
+        // Before the journal mode, the page size cannot change in WAL mode
+        if (options.pageSize > 0)
+        {
+            succeeded &= SetPragma("page_size", std::to_string(options.pageSize).c_str(), retValue);
+        }
+        if (!options.journalMode.empty())
+        {
+            succeeded &= SetPragma("journal_mode", options.journalMode.c_str(), retValue);
+        }
+        if (!options.synchronous.empty())
+        {
+            succeeded &= SetPragma("synchronous", options.synchronous.c_str(), retValue);
+        }
+        if (options.cacheSize != 0)
+        {
+            succeeded &= SetPragma("cache_size", std::to_string(options.cacheSize).c_str(), retValue);
+        }
+        if (options.mmapSize >= 0)
+        {
+            succeeded &= SetPragma("mmap_size", std::to_string(options.mmapSize).c_str(), retValue);
+        }
+        if (!options.tempStore.empty())
+        {
+            succeeded &= SetPragma("temp_store", options.tempStore.c_str(), retValue);
+        }
+        if (!succeeded)
+        {
+            std::cout << "SqliteWrapper: some options could not be applied: " << sqlite3_a3d_errmsg(m_database) << std::endl;
+        }
+        return succeeded;
+    }
+
+    void SqliteWrapper::InstallBusyHandler()
+    {
+        // SQLite waits through the retry policy instead of a fixed busy timeout
+        sqlite3_a3d_busy_handler(m_database, &SqliteWrapper::BusyHandler, this);
+    }
+
+    int SqliteWrapper::BusyHandler(void* wrapper, int count)
+    {
+        SqliteWrapper* self = static_cast<SqliteWrapper*>(wrapper);
+        static thread_local std::chrono::steady_clock::time_point firstCall;
+        if (count == 0)
+        {
+            firstCall = std::chrono::steady_clock::now();
+        }
+
+        // The connection may be used directly, outside of a wrapper call. A call without retry fails at once.
+        SqliteRetryState* state = t_retryState;
+        if ((state && !state->retry) || t_noWaitOnBusy)
+        {
+            return 0;
+        }
+        unsigned int remainingMs = self->GetRemainingTimeMs(state ? state->start : firstCall);
+        if (remainingMs == 0)
+        {
+            return 0;
+        }
+        unsigned int delayMs = self->m_retryPolicy.GetDelayMs(state ? state->retries : count);
+        std::this_thread::sleep_for(std::chrono::milliseconds(std::min(delayMs, remainingMs)));
+        if (state)
+        {
+            ++state->retries;
+        }
+        return 1;
+    }
+
+    unsigned int SqliteWrapper::GetRemainingTimeMs(std::chrono::steady_clock::time_point start) const
+    {
+        if (m_timeoutMs == 0)
+        {
+            return UINT_MAX;
+        }
+        auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        return elapsedMs >= m_timeoutMs ? 0 : m_timeoutMs - (unsigned int)elapsedMs;
+    }
+
     bool SqliteWrapper::DestroyDatabase()
     {
         if (!m_database || !m_isOpened)
@@ -56,6 +345,7 @@ namespace A3D
         if (IsInTransaction() && !RollBackTransaction())
             std::cout << "DestroyDatabase: could not rollback transaction" << std::endl;
 
+        ClearStatementCache();
         sqlite3_a3d_close_v2(m_database);
 
         m_isOpened = false;
@@ -69,7 +359,14 @@ namespace A3D
         : m_isOpened(false),
         m_timeoutMs(3000), // Timeout after 3s
         m_databasePath(databasePath),
-        m_database(nullptr)
+        m_openFlags(SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX),
+        m_database(nullptr),
+        m_isSingleThreaded(false),
+        m_connectionGeneration(0),
+        m_isOpenDeferred(false),
+        m_isOpening(false),
+        m_statementCacheCapacity(64),
+        m_isMetricsEnabled(false)
     {
 #ifdef LINUX
         SetTimeout(30000);
@@ -81,18 +378,79 @@ namespace A3D
         : m_isOpened(false),
         m_timeoutMs(timeoutMs),
         m_databasePath(databasePath),
-        m_database(nullptr)
+        m_openFlags(SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX),
+        m_database(nullptr),
+        m_isSingleThreaded(false),
+        m_connectionGeneration(0),
+        m_isOpenDeferred(false),
+        m_isOpening(false),
+        m_statementCacheCapacity(64),
+        m_isMetricsEnabled(false)
+    {
+        InitDatabase();
+    }
+
+    SqliteWrapper::SqliteWrapper(std::string const& databasePath, int timeoutMs, int openFlags)
+        : m_isOpened(false),
+        m_timeoutMs(timeoutMs),
+        m_databasePath(databasePath),
+        m_openFlags(openFlags),
+        m_database(nullptr),
+        m_isSingleThreaded((openFlags & SQLITE_OPEN_NOMUTEX) != 0),
+        m_connectionGeneration(0),
+        m_isOpenDeferred(false),
+        m_isOpening(false),
+        m_statementCacheCapacity(64),
+        m_isMetricsEnabled(false)
     {
         InitDatabase();
     }
 
+    SqliteWrapper::SqliteWrapper(std::string const& databasePath, SqliteWrapperOptions const& options)
+        : m_isOpened(false),
+        m_timeoutMs(options.timeoutMs),
+        m_databasePath(databasePath),
+        m_openFlags(options.openFlags),
+        m_database(nullptr),
+        m_isSingleThreaded((options.openFlags & SQLITE_OPEN_NOMUTEX) != 0),
+        m_connectionGeneration(0),
+        m_isOpenDeferred(false),
+        m_isOpening(false),
+        m_statementCacheCapacity(options.statementCacheSize),
+        m_isMetricsEnabled(false)
+    {
+        if (options.lazyOpen)
+        {
+            m_deferredOptions.reset(new SqliteWrapperOptions(options));
+            m_isOpenDeferred = true;
+        }
+        else if (InitDatabase())
+        {
+            ApplyOptions(options);
+        }
+    }
+
     SqliteWrapper::~SqliteWrapper()
     {
+        {
+            std::lock_guard<std::mutex> lock(m_warmupMutex);
+            if (m_warmupThread.joinable())
+                m_warmupThread.join();
+        }
+        // Complete the pending asynchronous queries and writes while the connection is still opened
+        m_asyncExecutor.reset();
+        m_writeQueue.reset();
+        StopCheckpointer();
         DestroyDatabase();
     }
 
     bool SqliteWrapper::IsReady() const
     {
+        if (m_isOpenDeferred.load(std::memory_order_acquire))
+        {
+            // Opening does not change what the wrapper is from the point of view of the caller
+            return const_cast<SqliteWrapper*>(this)->OpenDeferredDatabase();
+        }
         return m_isOpened;
     }
 
@@ -101,6 +459,11 @@ namespace A3D
         m_timeoutMs = timeoutMs;
     }
 
+    void SqliteWrapper::SetRetryPolicy(SqliteRetryPolicy const& policy)
+    {
+        m_retryPolicy = policy;
+    }
+
     static int getResultsCallBack(void* container, int count, char** data, char** columns)
     {
         std::vector<std::vector<std::string>>* results = reinterpret_cast<std::vector<std::vector<std::string>>*>(container);
@@ -119,158 +482,1125 @@ namespace A3D
         return 0;
     }
 
-    bool SqliteWrapper::ExecStatement(const char* statementText, int& retValue, std::vector<std::vector<std::string>>& results, bool retry, int* pnUpdatedRows)
+    bool SqliteWrapper::ShouldRetry(int retValue, SqliteRetryState& state)
     {
-
-        if (!IsReady())
-            return false;
-
-        bool alreadyTriedReconnecting = false;
-        bool done = false;
-        bool firstRowIteration = true;
-        int numberOfColumn = 0;
-        int i = 0;
-        while (!done)
+        // Closing the connection would roll back the transaction in progress, and the next
+        // statements of the caller would then run in autocommit mode
+        switch (retValue)
         {
-            // Several executations can happen in parallel if we do not need the atomicity of sqlite3_a3d_exec followed by sqlite3_a3d_changes
-            if (pnUpdatedRows != nullptr)
-            {
-                *pnUpdatedRows = 0;
-                m_dbConnectionMutex.lock();
-            }
-            else
+        case SQLITE_BUSY:
+        {
+            // The busy handler already waited if SQLite could, this covers the cases where it cannot
+            // (deadlock avoidance) and calls done without retry
+            if (t_noWaitOnBusy)
             {
-                m_dbConnectionMutex.lock_shared();
+                return false;
             }
-
-            retValue = sqlite3_a3d_exec(m_database, statementText, getResultsCallBack, &results, nullptr);
-
-            if (pnUpdatedRows != nullptr)
+            unsigned int remainingMs = GetRemainingTimeMs(state.start);
+            if (state.retry && remainingMs > 0)
             {
-                if (retValue == 0)
-                {
-                    *pnUpdatedRows = sqlite3_a3d_changes(m_database);
-                    if (*pnUpdatedRows < 0)
-                    {
-                    }
-                }
-                m_dbConnectionMutex.unlock();
+                std::this_thread::sleep_for(std::chrono::milliseconds(std::min(m_retryPolicy.GetDelayMs(state.retries), remainingMs)));
+                ++state.retries;
+                return true;
             }
-            else
+            if (!m_retryPolicy.reconnectOnBusy || state.alreadyTriedReconnecting || IsInTransaction())
             {
-                m_dbConnectionMutex.unlock_shared();
+                return false;
             }
+            state.alreadyTriedReconnecting = true;
+            return Reconnect();
+        }
 
-            switch (retValue)
-            {
-            case SQLITE_BUSY:
-                if (m_timeoutMs == 0 || retry && i++ < 10)
-                {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(15));
-                }
-                else if (alreadyTriedReconnecting)
-                {
-                    done = true;
-                }
-                else
-                {
-                    done = !Reconnect();
-                    alreadyTriedReconnecting = true;
-                }
-                break;
-
-            case 0:  // Success
-                done = true;
-                break;
-
-            case SQLITE_IOERR:
-                if (alreadyTriedReconnecting)
-                {
-                    done = true;
-                    break;
-                }
-                done = !Reconnect();
-                alreadyTriedReconnecting = true;
-                break;
+        case 0:  // Success
+        case SQLITE_ROW:
+        case SQLITE_DONE:
+            return false;
 
-            default:
+        // Only a broken connection is worth reopening
+        case SQLITE_IOERR:
+        case SQLITE_CANTOPEN:
+            if (state.alreadyTriedReconnecting || IsInTransaction())
+            {
                 std::cout << "WrapperExecError: " << LastErrorMessage() << std::endl;
-                if (alreadyTriedReconnecting)
-                {
-                    done = true;
-                    break;
-                }
-                done = !Reconnect();
-                alreadyTriedReconnecting = true;
-                break;
+                return false;
             }
-        }
+            state.alreadyTriedReconnecting = true;
+            return Reconnect();
 
-        return retValue == 0;
+        // SQL errors and constraint violations would fail again on a new connection
+        default:
+            std::cout << "WrapperExecError: " << LastErrorMessage() << std::endl;
+            return false;
+        }
     }
 
-    bool SqliteWrapper::ExecStatement(const char* statementText, int& retValue)
+    SqliteMetrics* SqliteWrapper::GetEnabledMetrics()
     {
-        std::vector<std::vector<std::string>> results;
-        return ExecStatement(statementText, retValue, results, true, nullptr);
+        return m_isMetricsEnabled.load(std::memory_order_relaxed) ? &m_metrics : nullptr;
     }
 
-    bool SqliteWrapper::ExecStatement(const char* statementText, int& retValue, int& nUpdatedRows)
+    bool SqliteWrapper::HoldsCursorLock() const
     {
-        std::vector<std::vector<std::string>> results;
-        return ExecStatement(statementText, retValue, results, true, &nUpdatedRows);
+        return std::find(t_cursorLocks.begin(), t_cursorLocks.end(), this) != t_cursorLocks.end();
     }
 
-    bool SqliteWrapper::ExecStatement(const char* statementText)
+    bool SqliteWrapper::LockConnection(bool exclusive, SqliteMetrics* metrics, uint64_t* pLockWaitNs)
     {
-        int retValue;
-        std::vector<std::vector<std::string>> results;
-        return ExecStatement(statementText, retValue, results, true, nullptr);
+        // Every call using the connection comes here first
+        if (m_isOpenDeferred.load(std::memory_order_acquire))
+        {
+            OpenDeferredDatabase();
+        }
+        // Used by one thread at a time: nothing to exclude, not even a reconnection
+        if (m_isSingleThreaded)
+        {
+            return false;
+        }
+        // A cursor of this thread already holds the lock: it cannot be taken again, nor upgraded,
+        // so an exclusive call is then only protected from a reconnection
+        if (HoldsCursorLock())
+        {
+            return false;
+        }
+        std::chrono::steady_clock::time_point start;
+        if (metrics)
+        {
+            start = std::chrono::steady_clock::now();
+        }
+        if (exclusive)
+        {
+            m_dbConnectionMutex.lock();
+        }
+        else
+        {
+            m_dbConnectionMutex.lock_shared();
+        }
+        if (metrics)
+        {
+            uint64_t waitNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            metrics->RecordLockWait(waitNs);
+            if (pLockWaitNs)
+                *pLockWaitNs += waitNs;
+        }
+        return true;
     }
 
-    bool SqliteWrapper::BeginTransaction()
+    void SqliteWrapper::UnlockConnection(bool exclusive)
     {
-        return ExecStatement("BEGIN TRANSACTION");
+        if (exclusive)
+        {
+            m_dbConnectionMutex.unlock();
+        }
+        else
+        {
+            m_dbConnectionMutex.unlock_shared();
+        }
     }
 
-    bool SqliteWrapper::BeginExclusiveTransaction()
+    void SqliteWrapper::LockForCursor()
     {
-        return ExecStatement("BEGIN EXCLUSIVE TRANSACTION");
+        if (!HoldsCursorLock())
+        {
+            LockConnection(false, GetEnabledMetrics(), nullptr);
+        }
+        t_cursorLocks.push_back(this);
     }
 
-    bool SqliteWrapper::BeginImmediateTransaction()
+    void SqliteWrapper::UnlockForCursor()
     {
-        int retValue = 0;
-        std::vector<std::vector<std::string>> results;
-        return ExecStatement("BEGIN IMMEDIATE TRANSACTION", retValue, results, true);
+        t_cursorLocks.erase(std::find(t_cursorLocks.begin(), t_cursorLocks.end(), this));
+        if (!HoldsCursorLock() && !m_isSingleThreaded)
+        {
+            m_dbConnectionMutex.unlock_shared();
+        }
     }
 
-    bool SqliteWrapper::EndTransaction()
+    void SqliteWrapper::FinishExecution(SqliteStatementEntry& entry, bool succeeded)
     {
-        int retValue = 0;
-        std::vector<std::vector<std::string>> results;
-        return ExecStatement("COMMIT", retValue, results, true);
+        if (!entry.isExecuting)
+        {
+            return;
+        }
+        SqliteStatementCounters& counters = *entry.counters;
+        counters.latency.Record(entry.executionNs);
+        counters.lockWaitNs.fetch_add(entry.executionLockWaitNs, std::memory_order_relaxed);
+        counters.rows.fetch_add(entry.executionRows, std::memory_order_relaxed);
+        counters.busyRetries.fetch_add((uint64_t)entry.executionRetries, std::memory_order_relaxed);
+        if (!succeeded)
+            counters.errors.fetch_add(1, std::memory_order_relaxed);
+        m_metrics.RecordBusyRetries(entry.executionRetries);
+
+        entry.isExecuting = false;
+        entry.executionNs = 0;
+        entry.executionLockWaitNs = 0;
+        entry.executionRows = 0;
+        entry.executionRetries = 0;
     }
 
-    bool SqliteWrapper::RollBackTransaction()
+    void SqliteWrapper::EnableMetrics(bool enable)
     {
-        int retValue = 0;
-        std::vector<std::vector<std::string>> results;
-        return ExecStatement("ROLLBACK TRANSACTION", retValue, results, true);
+        m_isMetricsEnabled.store(enable, std::memory_order_relaxed);
     }
 
-    bool SqliteWrapper::IsInTransaction()
+    SqliteMetricsSnapshot SqliteWrapper::GetMetrics()
     {
-        /*
-        *   The sqlite3_get_autocommit() interface returns non-zero or zero if the given database connection
-        *   is or is not in autocommit mode, respectively. Autocommit mode is on by default.
-        *   Autocommit mode is disabled by a BEGIN statement. Autocommit mode is re-enabled by a COMMIT or ROLLBACK.
-        */
-        return 0 == sqlite3_a3d_get_autocommit(m_database);
+        return m_metrics.GetSnapshot();
+    }
+
+    void SqliteWrapper::ResetMetrics()
+    {
+        m_metrics.Clear();
+    }
+
+    bool SqliteWrapper::AddConnectionSetup(const char* key, SqliteConnectionSetup const& setup, int& retValue)
+    {
+        bool isLocked = LockConnection(true, nullptr, nullptr);
+        retValue = setup(m_database);
+        if (retValue == SQLITE_OK)
+        {
+            auto found = std::find_if(m_connectionSetups.begin(), m_connectionSetups.end(),
+                [key](std::pair<std::string, SqliteConnectionSetup> const& saved) { return saved.first == key; });
+            if (found != m_connectionSetups.end())
+            {
+                found->second = setup;
+            }
+            else
+            {
+                m_connectionSetups.emplace_back(key, setup);
+            }
+        }
+        if (isLocked)
+        {
+            UnlockConnection(true);
+        }
+        return retValue == SQLITE_OK;
+    }
+
+    bool SqliteWrapper::SetPragma(const char* pragmaName, const char* value, int& retValue)
+    {
+        std::string statementText = std::string("PRAGMA ") + pragmaName + "=" + value;
+        std::string key = std::string("PRAGMA ") + pragmaName;
+        std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return (char)tolower(c); });
+        return AddConnectionSetup(key.c_str(), [statementText](sqlite3* database)
+        {
+            return sqlite3_a3d_exec(database, statementText.c_str(), nullptr, nullptr, nullptr);
+        }, retValue);
+    }
+
+    bool SqliteWrapper::CreateFunction(const char* functionName, int argCount, void* userData,
+        void (*xFunc)(sqlite3_a3d_context*, int, sqlite3_a3d_value**),
+        void (*xStep)(sqlite3_a3d_context*, int, sqlite3_a3d_value**),
+        void (*xFinal)(sqlite3_a3d_context*), int& retValue)
+    {
+        std::string name = functionName;
+        std::string key = "function " + name + "/" + std::to_string(argCount);
+        return AddConnectionSetup(key.c_str(), [name, argCount, userData, xFunc, xStep, xFinal](sqlite3* database)
+        {
+            return sqlite3_a3d_create_function(database, name.c_str(), argCount, SQLITE_UTF8, userData, xFunc, xStep, xFinal);
+        }, retValue);
+    }
+
+    void SqliteWrapper::SetWarmupTables(std::vector<std::string> const& tableNames)
+    {
+        bool isLocked = LockConnection(true, nullptr, nullptr);
+        m_warmupTables = tableNames;
+        if (isLocked)
+        {
+            UnlockConnection(true);
+        }
+    }
+
+    void SqliteWrapper::SetHotStatements(std::vector<std::string> const& statementTexts)
+    {
+        std::lock_guard<std::mutex> lock(m_warmupMutex);
+        m_hotStatements = statementTexts;
+    }
+
+    std::future<bool> SqliteWrapper::Warmup()
+    {
+        std::lock_guard<std::mutex> lock(m_warmupMutex);
+        if (m_warmupThread.joinable())
+            m_warmupThread.join();
+        std::promise<bool> promise;
+        std::future<bool> future = promise.get_future();
+        if (m_isSingleThreaded)
+        {
+            promise.set_value(RunWarmup(m_hotStatements));
+            return future;
+        }
+        m_warmupThread = std::thread([this, hotStatements = m_hotStatements, promise = std::move(promise)]() mutable
+        {
+            promise.set_value(RunWarmup(hotStatements));
+        });
+        return future;
+    }
+
+    bool SqliteWrapper::StartCheckpointer(SqliteCheckpointPolicy const& policy)
+    {
+        if (!IsReady() || m_checkpointer || m_databasePath.empty() || m_databasePath == ":memory:")
+        {
+            return false;
+        }
+        int retValue;
+        std::vector<std::vector<std::string>> journalMode;
+        if (!ExecStatement("PRAGMA journal_mode", retValue, journalMode) || journalMode.empty() || journalMode[0].empty() || journalMode[0][0] != "wal")
+        {
+            return false;
+        }
+
+        std::unique_ptr<SqliteCheckpointer> checkpointer(new SqliteCheckpointer(*this, m_databasePath, policy));
+        if (!checkpointer->IsRunning())
+        {
+            return false;
+        }
+        bool isLocked = LockConnection(true, nullptr, nullptr);
+        m_checkpointer = std::move(checkpointer);
+        // Replaces the automatic checkpoint, installed by sqlite3_a3d_wal_autocheckpoint()
+        sqlite3_a3d_wal_hook(m_database, &SqliteCheckpointer::WalHook, m_checkpointer.get());
+        if (isLocked)
+        {
+            UnlockConnection(true);
+        }
+        return true;
+    }
+
+    void SqliteWrapper::StopCheckpointer()
+    {
+        if (!m_checkpointer)
+        {
+            return;
+        }
+        bool isLocked = LockConnection(true, nullptr, nullptr);
+        if (m_database)
+        {
+            sqlite3_a3d_wal_autocheckpoint(m_database, 1000);                  // Default of SQLite
+        }
+        if (isLocked)
+        {
+            UnlockConnection(true);
+        }
+        m_checkpointer.reset();
+    }
+
+    bool SqliteWrapper::EnableResultCache(SqliteResultCacheOptions const& options)
+    {
+        if (!IsReady())
+        {
+            return false;
+        }
+        bool isLocked = LockConnection(true, nullptr, nullptr);
+        m_resultCache.reset(new SqliteResultCache(options));
+        m_resultCache->InstallHooks(m_database);
+        if (isLocked)
+        {
+            UnlockConnection(true);
+        }
+        return true;
+    }
+
+    void SqliteWrapper::DisableResultCache()
+    {
+        if (!m_resultCache)
+        {
+            return;
+        }
+        bool isLocked = LockConnection(true, nullptr, nullptr);
+        if (m_database)
+        {
+            SqliteResultCache::RemoveHooks(m_database);
+        }
+        m_resultCache.reset();
+        if (isLocked)
+        {
+            UnlockConnection(true);
+        }
+    }
+
+    void SqliteWrapper::InvalidateResultCache()
+    {
+        if (m_resultCache)
+            m_resultCache->InvalidateAll();
+    }
+
+    SqliteResultCacheStats SqliteWrapper::GetResultCacheStats()
+    {
+        return m_resultCache ? m_resultCache->GetStats() : SqliteResultCacheStats();
+    }
+
+    bool SqliteWrapper::EnableSlowQueryLog(SqliteSlowQueryOptions const& options)
+    {
+        if (!IsReady())
+        {
+            return false;
+        }
+        bool isLocked = LockConnection(true, nullptr, nullptr);
+        m_slowQueryLog.reset(new SqliteSlowQueryLog(options));
+        m_slowQueryLog->InstallTrace(m_database);
+        if (isLocked)
+        {
+            UnlockConnection(true);
+        }
+        return true;
+    }
+
+    void SqliteWrapper::DisableSlowQueryLog()
+    {
+        if (!m_slowQueryLog)
+        {
+            return;
+        }
+        bool isLocked = LockConnection(true, nullptr, nullptr);
+        if (m_database)
+        {
+            SqliteSlowQueryLog::RemoveTrace(m_database);
+        }
+        m_slowQueryLog.reset();
+        if (isLocked)
+        {
+            UnlockConnection(true);
+        }
+    }
+
+    std::vector<SqliteSlowQuery> SqliteWrapper::GetSlowQueries()
+    {
+        return m_slowQueryLog ? m_slowQueryLog->GetQueries() : std::vector<SqliteSlowQuery>();
+    }
+
+    SqliteSlowQueryStats SqliteWrapper::GetSlowQueryStats()
+    {
+        return m_slowQueryLog ? m_slowQueryLog->GetStats() : SqliteSlowQueryStats();
+    }
+
+    void SqliteWrapper::ClearSlowQueries()
+    {
+        if (m_slowQueryLog)
+            m_slowQueryLog->Clear();
+    }
+
+    // Result handler of sqlite3_a3d_exec() wrapped to count the rows for the metrics
+    struct SqliteExecSink
+    {
+        int (*callback)(void* container, int count, char** data, char** columns);
+        void* container;
+        uint64_t rowCount;
+    };
+
+    static int countRowsCallBack(void* sink, int count, char** data, char** columns)
+    {
+        SqliteExecSink* execSink = reinterpret_cast<SqliteExecSink*>(sink);
+        ++execSink->rowCount;
+        return execSink->callback(execSink->container, count, data, columns);
+    }
+
+    // Runs the text for ExecWithCallback(), counting the rows for the metrics if asked
+    static int runForResults(sqlite3* database, const char* statementText, void* container, uint64_t* pRowCount)
+    {
+        if (!pRowCount)
+        {
+            return sqlite3_a3d_exec(database, statementText, getResultsCallBack, container, nullptr);
+        }
+        SqliteExecSink sink = { getResultsCallBack, container, 0 };
+        int retValue = sqlite3_a3d_exec(database, statementText, countRowsCallBack, &sink, nullptr);
+        *pRowCount += sink.rowCount;
+        return retValue;
+    }
+
+    // As sqlite3_a3d_exec(), which only gives text, but the arena also keeps the type of each value
+    static int runForArena(sqlite3* database, const char* statementText, void* container, uint64_t* pRowCount)
+    {
+        SqliteResultArena* arena = reinterpret_cast<SqliteResultArena*>(container);
+        arena->Clear();
+        int retValue = SQLITE_OK;
+        const char* tail = statementText;
+        while (retValue == SQLITE_OK && tail && *tail)
+        {
+            sqlite3_a3d_stmt* statement = nullptr;
+            retValue = sqlite3_a3d_prepare_v2(database, tail, -1, &statement, &tail);
+            // No statement for a comment or white space
+            if (retValue != SQLITE_OK || !statement)
+            {
+                continue;
+            }
+            SqliteRow row(statement);
+            while (SQLITE_ROW == sqlite3_a3d_step(statement))
+            {
+                // The rows of a statement with other columns replace the previous ones
+                arena->AppendRow(row);
+                if (pRowCount)
+                {
+                    ++*pRowCount;
+                }
+            }
+            // Returns the error of the last step, if any
+            retValue = sqlite3_a3d_finalize(statement);
+        }
+        return retValue;
+    }
+
+    bool SqliteWrapper::ExecStatement(const char* statementText, int& retValue, std::vector<std::vector<std::string>>& results, bool retry, int* pnUpdatedRows, int* pnRetries)
+    {
+        return ExecWithCallback(statementText, retValue, runForResults, &results, retry, pnUpdatedRows, pnRetries);
+    }
+
+    bool SqliteWrapper::ExecStatement(const char* statementText, int& retValue, SqliteResultArena& arena, bool retry, int* pnUpdatedRows, int* pnRetries)
+    {
+        return ExecWithCallback(statementText, retValue, runForArena, &arena, retry, pnUpdatedRows, pnRetries);
+    }
+
+    bool SqliteWrapper::ExecWithCallback(const char* statementText, int& retValue, int (*run)(sqlite3*, const char*, void*, uint64_t*), void* container, bool retry, int* pnUpdatedRows, int* pnRetries)
+    {
+
+        if (!IsReady())
+            return false;
+
+        SqliteMetrics* metrics = GetEnabledMetrics();
+        uint64_t rowCount = 0;
+        uint64_t lockWaitNs = 0;
+        uint64_t executionNs = 0;
+
+        SqliteRetryState state(retry);
+        bool done = false;
+        while (!done)
+        {
+            // Several executations can happen in parallel if we do not need the atomicity of sqlite3_a3d_exec followed by sqlite3_a3d_changes
+            if (pnUpdatedRows != nullptr)
+            {
+                *pnUpdatedRows = 0;
+            }
+            bool isLocked = LockConnection(pnUpdatedRows != nullptr, metrics, &lockWaitNs);
+
+            if (metrics)
+            {
+                auto start = std::chrono::steady_clock::now();
+                retValue = run(m_database, statementText, container, &rowCount);
+                executionNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            }
+            else
+            {
+                retValue = run(m_database, statementText, container, nullptr);
+            }
+
+            if (pnUpdatedRows != nullptr)
+            {
+                if (retValue == 0)
+                {
+                    *pnUpdatedRows = sqlite3_a3d_changes(m_database);
+                }
+            }
+            if (isLocked)
+            {
+                UnlockConnection(pnUpdatedRows != nullptr);
+            }
+
+            done = !ShouldRetry(retValue, state);
+        }
+
+        if (metrics)
+        {
+            SqliteStatementCounters* counters = metrics->GetCounters(statementText);
+            counters->latency.Record(executionNs);
+            counters->lockWaitNs.fetch_add(lockWaitNs, std::memory_order_relaxed);
+            counters->rows.fetch_add(rowCount, std::memory_order_relaxed);
+            counters->busyRetries.fetch_add((uint64_t)state.retries, std::memory_order_relaxed);
+            if (retValue != 0)
+                counters->errors.fetch_add(1, std::memory_order_relaxed);
+            metrics->RecordBusyRetries(state.retries);
+        }
+        if (pnRetries != nullptr)
+            *pnRetries = state.retries;
+        return retValue == 0;
+    }
+
+    bool SqliteWrapper::ExecStatement(const char* statementText, int& retValue)
+    {
+        std::vector<std::vector<std::string>> results;
+        return ExecStatement(statementText, retValue, results, true, nullptr);
+    }
+
+    bool SqliteWrapper::ExecStatement(const char* statementText, int& retValue, int& nUpdatedRows)
+    {
+        std::vector<std::vector<std::string>> results;
+        return ExecStatement(statementText, retValue, results, true, &nUpdatedRows);
+    }
+
+    bool SqliteWrapper::ExecStatement(const char* statementText)
+    {
+        int retValue;
+        std::vector<std::vector<std::string>> results;
+        return ExecStatement(statementText, retValue, results, true, nullptr);
+    }
+
+    SqliteStatementEntry* SqliteWrapper::AcquireStatementEntry(const char* statementText)
+    {
+        std::lock_guard<std::mutex> cacheLock(m_statementCacheMutex);
+        auto found = m_statementCacheIndex.find(std::string_view(statementText));
+        if (found != m_statementCacheIndex.end() && !found->second->inUse)
+        {
+            m_statementCache.splice(m_statementCache.begin(), m_statementCache, found->second);
+            found->second->inUse = true;
+            return &*found->second;
+        }
+
+        if (found != m_statementCacheIndex.end() || m_statementCacheCapacity == 0)
+        {
+            // Already checked out by another handle: this one gets its own statement, finalized on release
+            SqliteStatementEntry* entry = new SqliteStatementEntry();
+            entry->statementText = statementText;
+            entry->inUse = true;
+            return entry;
+        }
+
+        m_statementCache.emplace_front();
+        SqliteStatementEntry& entry = m_statementCache.front();
+        entry.statementText = statementText;
+        entry.inUse = true;
+        entry.isCached = true;
+        m_statementCacheIndex.emplace(std::string_view(entry.statementText), m_statementCache.begin());
+        EvictStatements();
+        return &entry;
+    }
+
+    bool SqliteWrapper::PrepareEntry(SqliteStatementEntry& entry, int& retValue)
+    {
+        // m_dbConnectionMutex must be held by the caller
+        if (entry.statement)
+        {
+            sqlite3_a3d_finalize(entry.statement);
+            entry.statement = nullptr;
+        }
+        entry.generation = m_connectionGeneration;
+
+        // Passing the size including the nul-terminator saves SQLite a copy of the text
+        retValue = sqlite3_a3d_prepare_v3(m_database, entry.statementText.c_str(), (int)entry.statementText.size() + 1, SQLITE_PREPARE_PERSISTENT, &entry.statement, nullptr);
+        if (retValue != SQLITE_OK)
+        {
+            return false;
+        }
+        if (!entry.statement) // Empty statement or comment only
+        {
+            retValue = SQLITE_MISUSE;
+            return false;
+        }
+
+        for (size_t i = 0; i < entry.bindings.size(); ++i)
+        {
+            if (!entry.bindings[i].IsNull())
+            {
+                entry.bindings[i].Bind(entry.statement, (int)i + 1, false);
+            }
+        }
+        return true;
+    }
+
+    bool SqliteWrapper::StepStatement(SqliteStatement& statement, int& retValue, int* pnUpdatedRows, int* pnRetries)
+    {
+        retValue = SQLITE_MISUSE;
+        if (!IsReady())
+            return false;
+
+        SqliteStatementEntry& entry = *statement.m_entry;
+        SqliteMetrics* metrics = GetEnabledMetrics();
+        std::chrono::steady_clock::time_point start;
+        if (metrics)
+        {
+            if (!entry.counters)
+                entry.counters = metrics->GetCounters(entry.statementText.c_str());
+            entry.isExecuting = true;
+        }
+
+        SqliteRetryState state(true);
+        bool done = false;
+        while (!done)
+        {
+            if (pnUpdatedRows != nullptr)
+            {
+                *pnUpdatedRows = 0;
+            }
+            bool isLocked = LockConnection(pnUpdatedRows != nullptr, metrics, &entry.executionLockWaitNs);
+            if (metrics)
+            {
+                start = std::chrono::steady_clock::now();
+            }
+
+            if (entry.statement && entry.generation == m_connectionGeneration)
+            {
+                retValue = sqlite3_a3d_step(entry.statement);
+            }
+            else if (statement.m_hasRows)
+            {
+                // Reconnected in the middle of a result set: it cannot be resumed on the new connection
+                retValue = SQLITE_ABORT;
+            }
+            else if (PrepareEntry(entry, retValue))
+            {
+                retValue = sqlite3_a3d_step(entry.statement);
+            }
+            if (metrics)
+            {
+                entry.executionNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            }
+
+            if (pnUpdatedRows != nullptr)
+            {
+                if (retValue == SQLITE_DONE)
+                {
+                    *pnUpdatedRows = sqlite3_a3d_changes(m_database);
+                }
+            }
+            if (isLocked)
+            {
+                UnlockConnection(pnUpdatedRows != nullptr);
+            }
+
+            if (retValue == SQLITE_ROW || retValue == SQLITE_DONE)
+            {
+                statement.m_hasRows = retValue == SQLITE_ROW;
+                break;
+            }
+
+            // A statement that already returned rows cannot be replayed without returning them twice
+            done = statement.m_hasRows || !ShouldRetry(retValue, state);
+        }
+
+        if (entry.isExecuting)
+        {
+            entry.executionRetries += state.retries;
+            if (retValue == SQLITE_ROW)
+                ++entry.executionRows;
+            else
+                FinishExecution(entry, retValue == SQLITE_DONE);
+        }
+        if (pnRetries != nullptr)
+            *pnRetries = state.retries;
+        return retValue == SQLITE_ROW || retValue == SQLITE_DONE;
+    }
+
+    void SqliteWrapper::ReleaseStatement(SqliteStatementEntry* entry)
+    {
+        FinishExecution(*entry, true);
+        if (entry->statement)
+        {
+            sqlite3_a3d_reset(entry->statement);
+            sqlite3_a3d_clear_bindings(entry->statement);
+        }
+        for (SqliteValue& binding : entry->bindings)
+        {
+            binding.SetNull();
+        }
+
+        if (!entry->isCached)
+        {
+            if (entry->statement)
+                sqlite3_a3d_finalize(entry->statement);
+            delete entry;
+            return;
+        }
+
+        std::lock_guard<std::mutex> cacheLock(m_statementCacheMutex);
+        if (entry->statement && entry->generation != m_connectionGeneration)
+        {
+            // Prepared on a connection closed by Reconnect()
+            sqlite3_a3d_finalize(entry->statement);
+            entry->statement = nullptr;
+        }
+        entry->inUse = false;
+        EvictStatements();
+    }
+
+    void SqliteWrapper::EvictStatements()
+    {
+        // m_statementCacheMutex must be held by the caller
+        auto it = m_statementCache.end();
+        while (m_statementCache.size() > m_statementCacheCapacity && it != m_statementCache.begin())
+        {
+            --it;
+            if (it->inUse)
+            {
+                continue;
+            }
+            if (it->statement)
+            {
+                sqlite3_a3d_finalize(it->statement);
+            }
+            m_statementCacheIndex.erase(std::string_view(it->statementText));
+            it = m_statementCache.erase(it);
+        }
+    }
+
+    void SqliteWrapper::ClearStatementCache()
+    {
+        std::lock_guard<std::mutex> cacheLock(m_statementCacheMutex);
+        for (SqliteStatementEntry& entry : m_statementCache)
+        {
+            if (entry.statement)
+            {
+                sqlite3_a3d_finalize(entry.statement);
+                entry.statement = nullptr;
+            }
+        }
+        m_statementCacheIndex.clear();
+        m_statementCache.clear();
+    }
+
+    bool SqliteWrapper::Prepare(const char* statementText, SqliteStatement& statement, int& retValue)
+    {
+        statement.Release();
+        retValue = SQLITE_MISUSE;
+        if (!IsReady() || !statementText)
+            return false;
+
+        SqliteStatementEntry* entry = AcquireStatementEntry(statementText);
+        SqliteRetryState state(true);
+        bool prepared = false;
+        bool done = false;
+        while (!done)
+        {
+            bool isLocked = LockConnection(false, GetEnabledMetrics(), nullptr);
+            if (entry->statement && entry->generation == m_connectionGeneration)
+            {
+                retValue = SQLITE_OK;
+                prepared = true;
+            }
+            else
+            {
+                prepared = PrepareEntry(*entry, retValue);
+            }
+            if (isLocked)
+            {
+                UnlockConnection(false);
+            }
+
+            done = prepared || !ShouldRetry(retValue, state);
+        }
+
+        if (!prepared)
+        {
+            ReleaseStatement(entry);
+            return false;
+        }
+
+        statement.m_wrapper = this;
+        statement.m_entry = entry;
+        statement.m_hasRows = false;
+        return true;
+    }
+
+    bool SqliteWrapper::Prepare(const char* statementText, SqliteStatement& statement)
+    {
+        int retValue;
+        return Prepare(statementText, statement, retValue);
+    }
+
+    void SqliteWrapper::SetStatementCacheSize(size_t capacity)
+    {
+        std::lock_guard<std::mutex> cacheLock(m_statementCacheMutex);
+        m_statementCacheCapacity = capacity;
+        EvictStatements();
+    }
+
+    bool SqliteWrapper::ExecStatement(const char* statementText, int& retValue, SqliteRowVisitor const& visitor)
+    {
+        SqliteStatement statement;
+        if (!Prepare(statementText, statement, retValue))
+            return false;
+        return statement.ForEachRow(retValue, visitor);
+    }
+
+    bool SqliteWrapper::ExecCachedStatement(const char* statementText, int& retValue, std::vector<std::vector<std::string>>& results, std::vector<SqliteValue> const& values)
+    {
+        results.clear();
+        SqliteResultArena arena;
+        if (!ExecCachedStatement(statementText, retValue, arena, values))
+            return false;
+        results.resize(arena.GetColumnCount());
+        for (size_t i = 0; i < arena.GetColumnCount(); ++i)
+        {
+            results[i].reserve(arena.GetRowCount());
+            for (size_t row = 0; row < arena.GetRowCount(); ++row)
+            {
+                // NULL values are empty strings, as with ExecStatement()
+                results[i].emplace_back(arena.GetText(row, i));
+            }
+        }
+        return true;
+    }
+
+    bool SqliteWrapper::ExecCachedStatement(const char* statementText, int& retValue, SqliteResultArena& results, std::vector<SqliteValue> const& values)
+    {
+        results.Clear();
+        retValue = SQLITE_MISUSE;
+        if (!IsReady() || !statementText)
+            return false;
+
+        SqliteResultCache* cache = m_resultCache.get();
+        std::shared_ptr<const SqliteResultDependencies> dependencies;
+        std::string key;
+        SqliteResultCache::Ticket ticket;
+        if (cache)
+        {
+            if (cache->GetOptions().checkDataVersion)
+            {
+                SqliteStatement dataVersion;
+                if (Prepare("PRAGMA data_version", dataVersion, retValue) && dataVersion.Step(retValue) && retValue == SQLITE_ROW)
+                {
+                    cache->CheckDataVersion(sqlite3_a3d_column_int64(dataVersion.GetHandle(), 0));
+                }
+            }
+            dependencies = cache->GetDependencies(statementText);
+            if (!dependencies)
+            {
+                bool isLocked = LockConnection(false, GetEnabledMetrics(), nullptr);
+                dependencies = cache->AnalyzeDependencies(m_database, statementText, GetFunctionNames());
+                if (isLocked)
+                {
+                    UnlockConnection(false);
+                }
+            }
+            if (dependencies->isCacheable)
+            {
+                key = SqliteResultCache::MakeKey(statementText, values);
+                if (cache->Lookup(key, results))
+                {
+                    retValue = SQLITE_OK;
+                    return true;
+                }
+                // Before the execution, so that a write during it prevents caching its results
+                ticket = cache->GetTicket(*dependencies);
+            }
+            else
+            {
+                cache->RecordUncacheable();
+            }
+        }
+
+        SqliteStatement statement;
+        if (!Prepare(statementText, statement, retValue))
+            return false;
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            if (!statement.BindValue((int)i + 1, values[i]))
+            {
+                retValue = SQLITE_RANGE;
+                return false;
+            }
+        }
+        bool succeeded;
+        while ((succeeded = statement.Step(retValue)) && retValue == SQLITE_ROW)
+        {
+            results.AppendRow(statement.GetRow());
+        }
+        statement.Reset();
+        if (!succeeded)
+            return false;
+
+        retValue = SQLITE_OK;
+        if (!key.empty())
+        {
+            cache->Insert(key, results, dependencies, ticket);
+        }
+        return true;
+    }
+
+    SqliteWriteQueue& SqliteWrapper::GetWriteQueue()
+    {
+        std::call_once(m_writeQueueOnce, [this]() { m_writeQueue.reset(new SqliteWriteQueue(*this)); });
+        return *m_writeQueue;
+    }
+
+    std::future<SqliteWriteResult> SqliteWrapper::ExecStatementAsync(const char* statementText, std::vector<SqliteValue> values)
+    {
+        // A connection without mutex must not be used by the writer thread
+        if (m_isSingleThreaded)
+        {
+            std::promise<SqliteWriteResult> promise;
+            SqliteWriteResult result;
+            result.retValue = SQLITE_MISUSE;
+            promise.set_value(result);
+            return promise.get_future();
+        }
+        return GetWriteQueue().Submit(statementText, std::move(values));
+    }
+
+    void SqliteWrapper::ExecStatementAsync(const char* statementText, std::vector<SqliteValue> values, SqliteWriteCallback callback)
+    {
+        if (m_isSingleThreaded)
+        {
+            SqliteWriteResult result;
+            result.retValue = SQLITE_MISUSE;
+            callback(result);
+            return;
+        }
+        GetWriteQueue().Submit(statementText, std::move(values), std::move(callback));
+    }
+
+    SqliteAsyncExecutor& SqliteWrapper::GetAsyncExecutor()
+    {
+        std::call_once(m_asyncExecutorOnce, [this]() { m_asyncExecutor.reset(new SqliteAsyncExecutor(*this, m_asyncQueryOptions)); });
+        return *m_asyncExecutor;
+    }
+
+    void SqliteWrapper::SetNoWaitOnBusy(bool noWait)
+    {
+        t_noWaitOnBusy = noWait;
+    }
+
+    void SqliteWrapper::SetAsyncQueryOptions(SqliteAsyncQueryOptions const& options)
+    {
+        if (m_isSingleThreaded)
+        {
+            return;
+        }
+        std::call_once(m_asyncExecutorOnce, [this, &options]() { m_asyncExecutor.reset(new SqliteAsyncExecutor(*this, options)); });
+    }
+
+    void SqliteWrapper::QueryAsync(const char* statementText, std::vector<SqliteValue> values, SqliteQueryCallback callback)
+    {
+        // A connection without mutex must not be used by the threads of the executor
+        if (m_isSingleThreaded)
+        {
+            SqliteQueryResult result;
+            result.retValue = SQLITE_MISUSE;
+            callback(std::move(result));
+            return;
+        }
+        GetAsyncExecutor().Submit(statementText, std::move(values), std::move(callback));
+    }
+
+#ifdef A3D_SQLITE_COROUTINES
+    SqliteQueryAwaitable SqliteWrapper::Query(const char* statementText, std::vector<SqliteValue> values)
+    {
+        if (m_isSingleThreaded)
+        {
+            SqliteQueryResult result;
+            result.retValue = SQLITE_MISUSE;
+            return SqliteQueryAwaitable(std::move(result));
+        }
+        return SqliteQueryAwaitable(GetAsyncExecutor(), statementText, std::move(values));
+    }
+#endif
+
+    void SqliteWrapper::WaitForAsyncWrites()
+    {
+        if (m_writeQueue)
+            m_writeQueue->Flush();
+    }
+
+    void SqliteWrapper::SetAsyncWriteGroupSize(size_t maxGroupSize)
+    {
+        if (m_isSingleThreaded)
+        {
+            return;
+        }
+        GetWriteQueue().SetMaxGroupSize(maxGroupSize);
+    }
+
+    bool SqliteWrapper::ExecColumnar(SqliteStatement& statement, SqliteColumnarBatch& batch, int& retValue)
+    {
+        // A statement not started yet may return other columns than the previous batch
+        if (sqlite3_a3d_stmt_busy(statement.GetHandle()))
+            batch.Clear();
+        else
+            batch.Reset();
+        retValue = SQLITE_DONE;
+        while (!batch.IsFull())
+        {
+            if (!statement.Step(retValue))
+            {
+                statement.Reset();
+                return false;
+            }
+            if (retValue != SQLITE_ROW)
+            {
+                statement.Reset();
+                return true;
+            }
+            batch.AppendRow(statement.GetRow());
+        }
+        return true;
+    }
+
+    bool SqliteWrapper::ExecColumnar(const char* statementText, int& retValue, SqliteColumnarBatch& batch, std::function<bool(SqliteColumnarBatch const& batch)> const& batchVisitor)
+    {
+        SqliteStatement statement;
+        if (!Prepare(statementText, statement, retValue))
+            return false;
+
+        do
+        {
+            if (!ExecColumnar(statement, batch, retValue))
+                return false;
+            if (batch.GetRowCount() > 0 && !batchVisitor(batch))
+                break;
+        } while (retValue == SQLITE_ROW);
+        return true;
+    }
+
+    bool SqliteWrapper::BeginTransaction()
+    {
+        return ExecStatement("BEGIN TRANSACTION");
+    }
+
+    bool SqliteWrapper::BeginExclusiveTransaction()
+    {
+        return ExecStatement("BEGIN EXCLUSIVE TRANSACTION");
+    }
+
+    bool SqliteWrapper::BeginImmediateTransaction()
+    {
+        int retValue = 0;
+        std::vector<std::vector<std::string>> results;
+        return ExecStatement("BEGIN IMMEDIATE TRANSACTION", retValue, results, true);
+    }
+
+    bool SqliteWrapper::EndTransaction()
+    {
+        int retValue = 0;
+        std::vector<std::vector<std::string>> results;
+        return ExecStatement("COMMIT", retValue, results, true);
+    }
+
+    bool SqliteWrapper::RollBackTransaction()
+    {
+        int retValue = 0;
+        std::vector<std::vector<std::string>> results;
+        return ExecStatement("ROLLBACK TRANSACTION", retValue, results, true);
+    }
+
+    bool SqliteWrapper::IsInTransaction()
+    {
+        /*
+        *   The sqlite3_get_autocommit() interface returns non-zero or zero if the given database connection
+        *   is or is not in autocommit mode, respectively. Autocommit mode is on by default.
+        *   Autocommit mode is disabled by a BEGIN statement. Autocommit mode is re-enabled by a COMMIT or ROLLBACK.
+        */
+        sqlite3* database = GetHandle();
+        return database && 0 == sqlite3_a3d_get_autocommit(database);
+    }
+
+    sqlite3* SqliteWrapper::GetHandle() const
+    {
+        if (m_isOpenDeferred.load(std::memory_order_acquire))
+        {
+            const_cast<SqliteWrapper*>(this)->OpenDeferredDatabase();
+        }
+        return m_database;
     }
 
     std::string SqliteWrapper::LastErrorMessage()
     {
         return sqlite3_a3d_errmsg(m_database);
     }
+
+    std::string SqliteWrapper::QuoteIdentifier(std::string const& name)
+    {
+        std::string quoted = "\"";
+        for (char c : name)
+        {
+            if (c == '"')
+                quoted += '"';
+            quoted += c;
+        }
+        quoted += '"';
+        return quoted;
+    }
 }
@@ -10,12 +10,47 @@
 extern "C" {
     #include "sqlite3.h"
 }
+#include "SqliteAsyncExecutor.h"
+#include "SqliteBackup.h"
+#include "SqliteBulkLoad.h"
+#include "SqliteCheckpointer.h"
+#include "SqliteColumnarBatch.h"
+#include "SqliteDelimitedText.h"
+#include "SqliteMetrics.h"
+#include "SqliteMultiRowInsert.h"
+#include "SqliteResultArena.h"
+#include "SqliteResultCache.h"
+#include "SqliteRetryPolicy.h"
+#include "SqliteSlowQueryLog.h"
+#include "SqliteStatement.h"
+#include "SqliteWrapperOptions.h"
+#include "SqliteWriteQueue.h"
 #include <limits.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <unordered_map>
 #include <shared_mutex>
+#include <vector>
 
 namespace A3D
 {
+    class SqliteCursor;
+    struct SqliteRetryState;
+
+    //--------------------------------------------------------------------------------------
+    // Setting of a connection, applied on the connection of the wrapper then again on each
+    // new connection opened by a reconnection. Returns the SQLite code of the setting.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    typedef std::function<int(sqlite3* database)> SqliteConnectionSetup;
+
     class SqliteWrapper
     {
     private:
@@ -25,22 +60,127 @@ namespace A3D
         */
 
         bool m_isOpened;
-        unsigned int m_timeoutMs;                                    // Number of retries if DB is locked by another thread/process. 0 = forever.
+        unsigned int m_timeoutMs;                                    // Maximum time spent retrying a call if DB is locked by another thread/process. 0 = forever.
+        SqliteRetryPolicy m_retryPolicy;
         std::string m_databasePath;
+        int m_openFlags;                                             // Flags given to sqlite3_a3d_open_v2().
         sqlite3* m_database;
+        bool m_isSingleThreaded;                                     // Opened with SQLITE_OPEN_NOMUTEX: m_dbConnectionMutex is not used.
         std::shared_mutex m_dbConnectionMutex;
+        std::atomic<unsigned int> m_connectionGeneration;            // Incremented each time the connection is reopened.
+
+        // Connection of SqliteWrapperOptions::lazyOpen, opened by the first call that needs it
+        std::atomic<bool> m_isOpenDeferred;
+        bool m_isOpening;                                            // The options are being applied, by the thread holding m_openMutex.
+        std::recursive_mutex m_openMutex;
+        std::unique_ptr<SqliteWrapperOptions> m_deferredOptions;
+
+        // Prepared statements cache, most recently used first. Statements in use are never evicted.
+        std::mutex m_statementCacheMutex;
+        size_t m_statementCacheCapacity;
+        std::list<SqliteStatementEntry> m_statementCache;
+        std::unordered_map<std::string_view, std::list<SqliteStatementEntry>::iterator> m_statementCacheIndex;
+
+        // Optional instrumentation, only updated while enabled
+        SqliteMetrics m_metrics;
+        std::atomic<bool> m_isMetricsEnabled;
+
+        // Writer thread of ExecStatementAsync(), started by the first asynchronous write
+        std::once_flag m_writeQueueOnce;
+        std::unique_ptr<SqliteWriteQueue> m_writeQueue;
+
+        // Threads of QueryAsync() and Query(), started by the first asynchronous query
+        std::once_flag m_asyncExecutorOnce;
+        SqliteAsyncQueryOptions m_asyncQueryOptions;
+        std::unique_ptr<SqliteAsyncExecutor> m_asyncExecutor;
+
+        // Background WAL checkpointer, replacing the automatic checkpoint while started
+        std::unique_ptr<SqliteCheckpointer> m_checkpointer;
+
+        // Session state replayed by Reconnect() in the order it was first set, under m_dbConnectionMutex
+        std::vector<std::pair<std::string, SqliteConnectionSetup>> m_connectionSetups;
+        std::vector<std::string> m_warmupTables;
+
+        // Statements prepared in advance by Warmup(), and its thread
+        std::mutex m_warmupMutex;
+        std::vector<std::string> m_hotStatements;
+        std::thread m_warmupThread;
+
+        // Optional results of read-only statements, see EnableResultCache()
+        std::unique_ptr<SqliteResultCache> m_resultCache;
+
+        // Optional log of the slow statements, see EnableSlowQueryLog()
+        std::unique_ptr<SqliteSlowQueryLog> m_slowQueryLog;
+
+        friend class SqliteAsyncExecutor;
+        friend class SqliteCheckpointer;
+        friend class SqliteCursor;
+        friend class SqliteStatement;
 
         bool InitDatabase();
+        bool OpenDeferredDatabase();
+        bool RunWarmup(std::vector<std::string> const& hotStatements);
         bool DestroyDatabase();
         bool Reconnect();
+        void ReplaySession();
+        std::vector<std::string> GetFunctionNames() const;
+        bool ApplyOptions(SqliteWrapperOptions const& options);
+        void InstallBusyHandler();
+        static int BusyHandler(void* wrapper, int count);
+        unsigned int GetRemainingTimeMs(std::chrono::steady_clock::time_point start) const;
+        bool ShouldRetry(int retValue, SqliteRetryState& state);
+        bool ExecWithCallback(const char* statementText, int& retValue, int (*run)(sqlite3*, const char*, void*, uint64_t*), void* container, bool retry, int* pnUpdatedRows, int* pnRetries);
+        SqliteMetrics* GetEnabledMetrics();
+        bool HoldsCursorLock() const;
+        bool LockConnection(bool exclusive, SqliteMetrics* metrics, uint64_t* pLockWaitNs);
+        void UnlockConnection(bool exclusive);
+        void LockForCursor();
+        void UnlockForCursor();
+        void FinishExecution(SqliteStatementEntry& entry, bool succeeded);
+
+        SqliteStatementEntry* AcquireStatementEntry(const char* statementText);
+        bool PrepareEntry(SqliteStatementEntry& entry, int& retValue);
+        bool StepStatement(SqliteStatement& statement, int& retValue, int* pnUpdatedRows, int* pnRetries);
+        void ReleaseStatement(SqliteStatementEntry* entry);
+        void EvictStatements();
+        void ClearStatementCache();
+        SqliteWriteQueue& GetWriteQueue();
+        SqliteAsyncExecutor& GetAsyncExecutor();
+        static void SetNoWaitOnBusy(bool noWait);
 
     public:
+        typedef SqliteWrapperOptions Options;
+
         explicit SqliteWrapper(std::string const& databasePath);
         explicit SqliteWrapper(std::string const& databasePath, int timeoutMs);
+
+        //--------------------------------------------------------------------------------------
+        // @description Open a database with specific sqlite3_a3d_open_v2() flags, for instance
+        //              SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX for a connection used by a
+        //              single thread at a time. With SQLITE_OPEN_NOMUTEX the wrapper takes no
+        //              lock either: it must only be used by one thread at a time, such as the
+        //              holder of a SqliteConnectionLease, and not with ExecStatementAsync().
+        // @param       databasePath    Path of the database file.
+        // @param       timeoutMs       Retry timeout (ms). 0 = forever.
+        // @param       openFlags       The SQLITE_OPEN_* flags.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        explicit SqliteWrapper(std::string const& databasePath, int timeoutMs, int openFlags);
+
+        //--------------------------------------------------------------------------------------
+        // @description Open a database with a set of options, for instance a profile:
+        //              SqliteWrapper wrapper(path, SqliteWrapper::Options::ReadHeavyMmap()).
+        //              The connection settings are restored by each reconnection. With
+        //              options.lazyOpen, the database is only opened by the first call that
+        //              uses it, so that the wrapper can be built before sqlite3_a3d_config().
+        // @param       databasePath    Path of the database file.
+        // @param       options         How to open and configure the connection.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        explicit SqliteWrapper(std::string const& databasePath, SqliteWrapperOptions const& options);
         ~SqliteWrapper();
 
         //--------------------------------------------------------------------------------------
-        // @description   Check if database is ready (in a good state) to be used.
+        // @description   Check if database is ready (in a good state) to be used. Opens the
+        //                database if its opening was deferred.
         // @return        True if ready, false otherwise.
         // @bsimethod                                         Alexandre Gbaguidi A�sse   08/19
         //+---------------+---------------+---------------+---------------+---------------+------
@@ -54,6 +194,164 @@ namespace A3D
         //+---------------+---------------+---------------+---------------+---------------+------
         void SetTimeout(unsigned int timeoutMs);
 
+        //--------------------------------------------------------------------------------------
+        // @description Change how the wrapper waits between two attempts when the database is
+        //              locked. The total wait of a call is still bounded by the timeout.
+        // @param       policy  The retry policy.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void SetRetryPolicy(SqliteRetryPolicy const& policy);
+
+        //--------------------------------------------------------------------------------------
+        // @description Start or stop collecting metrics: calls, latency, rows and BUSY retries
+        //              of each normalized statement, reconnections and wait for the connection
+        //              lock. Counters are kept when collection stops.
+        // @param       enable  True to collect metrics.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void EnableMetrics(bool enable);
+
+        //--------------------------------------------------------------------------------------
+        // @description Return a copy of the metrics collected so far.
+        // @return      The snapshot, empty if metrics were never enabled.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        SqliteMetricsSnapshot GetMetrics();
+
+        //--------------------------------------------------------------------------------------
+        // @description Set all the metrics back to zero.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void ResetMetrics();
+
+        //--------------------------------------------------------------------------------------
+        // @description Checkpoint the WAL from a background thread with its own connection,
+        //              instead of the automatic checkpoint run by the committing call. Beyond
+        //              the hard limit of the policy, commits wait for the WAL to be truncated.
+        //              Checkpoints and waits are counted in the metrics.
+        // @param       policy  When to checkpoint.
+        // @return      False if the database is in memory, not in WAL mode, or if the
+        //              checkpointer is already started, true otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool StartCheckpointer(SqliteCheckpointPolicy const& policy = SqliteCheckpointPolicy());
+
+        //--------------------------------------------------------------------------------------
+        // @description Stop the background checkpointer and restore the automatic checkpoint.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void StopCheckpointer();
+
+        //--------------------------------------------------------------------------------------
+        // @description Keep the results of the read-only statements run by ExecCachedStatement(),
+        //              so that running one again with the same parameters does not reach SQLite
+        //              until a table it read is written. Writes are seen through hooks of the
+        //              connection, and with the checkDataVersion option through the data version
+        //              of the database for the other connections; InvalidateResultCache() covers
+        //              the other cases. Must not be called while other threads use the wrapper.
+        //              The authorizer, update, commit and rollback hooks of the connection are
+        //              then taken by the cache.
+        // @param       options     Memory limits of the cache.
+        // @return      False if the database is not opened, true otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool EnableResultCache(SqliteResultCacheOptions const& options = SqliteResultCacheOptions());
+
+        //--------------------------------------------------------------------------------------
+        // @description Drop the result cache and remove its hooks. Must not be called while
+        //              other threads use the wrapper.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void DisableResultCache();
+
+        //--------------------------------------------------------------------------------------
+        // @description Drop all the cached results, for instance after a write of another process.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void InvalidateResultCache();
+
+        //--------------------------------------------------------------------------------------
+        // @description Return the counters of the result cache.
+        // @return      The counters, all 0 if the cache is not enabled.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        SqliteResultCacheStats GetResultCacheStats();
+
+        //--------------------------------------------------------------------------------------
+        // @description Log the runs of statements lasting longer than a threshold, with the
+        //              counters SQLite keeps for each statement and their query plan, in a
+        //              ring buffer. Every statement of the connection is seen, prepared by the
+        //              wrapper or not. The runs that are not slow only cost a callback at their
+        //              end; the plan of a slow one is explained on its thread while it holds
+        //              the connection. Must not be called while other threads use the wrapper.
+        //              The trace callback of the connection is then taken by the log, so
+        //              sqlite3_a3d_trace() and sqlite3_a3d_trace_v2() cannot be used with it.
+        // @param       options     Threshold, capacity and sampling of the log.
+        // @return      False if the database is not opened, true otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool EnableSlowQueryLog(SqliteSlowQueryOptions const& options = SqliteSlowQueryOptions());
+
+        //--------------------------------------------------------------------------------------
+        // @description Drop the slow query log and remove its trace callback. Must not be
+        //              called while other threads use the wrapper.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void DisableSlowQueryLog();
+
+        //--------------------------------------------------------------------------------------
+        // @description Return the slow queries kept by the log, the oldest first.
+        // @return      The queries, none if the log is not enabled.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        std::vector<SqliteSlowQuery> GetSlowQueries();
+        SqliteSlowQueryStats GetSlowQueryStats();
+        void ClearSlowQueries();
+
+        //--------------------------------------------------------------------------------------
+        // @description Apply a setting to the connection and keep it, so that a reconnection
+        //              restores it before any other call uses the new connection.
+        // @param       key         Identifies the setting: a setting replaces the previous one
+        //                          with the same key, and keeps its place in the replay order.
+        // @param       setup       The setting.
+        // @param       retValue    Return code of the setting.
+        // @return      True if the setting was applied, false otherwise. It is kept only then.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool AddConnectionSetup(const char* key, SqliteConnectionSetup const& setup, int& retValue);
+
+        //--------------------------------------------------------------------------------------
+        // @description Run 'PRAGMA pragmaName=value' and keep it for the next reconnections,
+        //              as AddConnectionSetup(). For example: SetPragma("cache_size", "-65536").
+        // @param       pragmaName  The pragma, optionally prefixed by the schema.
+        // @param       value       Its value.
+        // @param       retValue    Return code after execution.
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool SetPragma(const char* pragmaName, const char* value, int& retValue);
+
+        //--------------------------------------------------------------------------------------
+        // @description Register an SQL function, kept for the next reconnections. The arguments
+        //              are those of sqlite3_a3d_create_function(), with the UTF-8 encoding.
+        // @param       retValue    Return code of the registration.
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool CreateFunction(const char* functionName, int argCount, void* userData,
+            void (*xFunc)(sqlite3_a3d_context*, int, sqlite3_a3d_value**),
+            void (*xStep)(sqlite3_a3d_context*, int, sqlite3_a3d_value**),
+            void (*xFinal)(sqlite3_a3d_context*), int& retValue);
+
+        //--------------------------------------------------------------------------------------
+        // @description Set the tables read again after a reconnection, so that the page cache
+        //              of the new connection already holds them.
+        // @param       tableNames  The tables, the hottest first. Empty = no warm-up.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void SetWarmupTables(std::vector<std::string> const& tableNames);
+
+        //--------------------------------------------------------------------------------------
+        // @description Set the statements prepared in advance by Warmup(). They stay in the
+        //              statement cache as long as it has room for them.
+        // @param       statementTexts  The statements, with '?' parameters.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void SetHotStatements(std::vector<std::string> const& statementTexts);
+
+        //--------------------------------------------------------------------------------------
+        // @description Get the wrapper ready for its first requests from a background thread:
+        //              open the database if its opening was deferred, load the schema, prepare
+        //              the hot statements and read the warm-up tables into the page cache.
+        //              Calls made meanwhile wait for the connection as usual. A wrapper opened
+        //              with SQLITE_OPEN_NOMUTEX warms up on the calling thread instead.
+        // @return      Becomes true once done, false if the database could not be opened or
+        //              a statement could not be prepared.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        std::future<bool> Warmup();
+
         //--------------------------------------------------------------------------------------
         // @description Execute an SQL statement without saving it and get the results.
         // @param       statementTest   The request.
@@ -61,10 +359,25 @@ namespace A3D
         // @param       results         Filled with the results where each column has its vector,
         //                              the first column starting at 'results[0]'.
         // @param       pnUpdatedRows   If not null, return the number of rows actually updated by the execution of the statement
+        // @param       pnRetries       If not null, return the number of times the call waited because the database was locked
         // @return      True if everything went well, false otherwise.
         // @bsimethod                                         Alexandre Gbaguidi A�sse   04/20
         //+---------------+---------------+---------------+---------------+---------------+------
-        bool ExecStatement(const char* statementText, int& retValue, std::vector<std::vector<std::string>>& results, bool retry = true, int* pnUpdatedRows = nullptr);
+        bool ExecStatement(const char* statementText, int& retValue, std::vector<std::vector<std::string>>& results, bool retry = true, int* pnUpdatedRows = nullptr, int* pnRetries = nullptr);
+
+        //--------------------------------------------------------------------------------------
+        // @description Execute an SQL statement without saving it and get its results in an arena
+        //              owned by the caller. Reusing the same arena avoids allocating memory for
+        //              each value: nothing is allocated once the arena is large enough.
+        // @param       statementText   The request. When its statements return other columns,
+        //                              the arena keeps the rows of the last of them.
+        // @param       retValue        Return code after execution.
+        // @param       arena           Cleared, then filled with the results as text.
+        // @param       pnUpdatedRows   If not null, return the number of rows actually updated by the execution of the statement
+        // @param       pnRetries       If not null, return the number of times the call waited because the database was locked
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool ExecStatement(const char* statementText, int& retValue, SqliteResultArena& arena, bool retry = true, int* pnUpdatedRows = nullptr, int* pnRetries = nullptr);
 
         //--------------------------------------------------------------------------------------
         // @description Execute an SQL statement without saving it and return return code and number of modified rows
@@ -93,6 +406,248 @@ namespace A3D
         //+---------------+---------------+---------------+---------------+---------------+------
         bool ExecStatement(const char* statementText);
 
+        //--------------------------------------------------------------------------------------
+        // @description Execute an SQL statement through the statement cache and visit its rows.
+        //              Values are read from SQLite as integers, doubles, text views or blobs,
+        //              nothing is converted to string nor copied.
+        // @param       statementText   The request. Only the first statement of the text is executed.
+        // @param       retValue        Return code after execution.
+        // @param       visitor         Called with each row, returns false to stop early.
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool ExecStatement(const char* statementText, int& retValue, SqliteRowVisitor const& visitor);
+
+        //--------------------------------------------------------------------------------------
+        // @description Execute an SQL statement through the statement cache and get its results,
+        //              from the result cache if the same statement already ran with the same
+        //              parameters and none of its tables was written since. Without result cache,
+        //              or for writes and statements whose result can change by itself, it is
+        //              simply executed.
+        // @param       statementText   The request, with '?' parameters. Only its first statement is executed.
+        // @param       retValue        Return code after execution.
+        // @param       results         Filled with the results where each column has its vector,
+        //                              as ExecStatement().
+        // @param       values          The parameters, the first one being bound to '?1'.
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool ExecCachedStatement(const char* statementText, int& retValue, std::vector<std::vector<std::string>>& results, std::vector<SqliteValue> const& values = std::vector<SqliteValue>());
+
+        //--------------------------------------------------------------------------------------
+        // @description Execute an SQL statement through the statement cache and the result
+        //              cache, as above, and get its results in an arena, where NULL values
+        //              stay apart from empty strings.
+        // @param       statementText   The request, with '?' parameters. Only its first statement is executed.
+        // @param       retValue        Return code after execution.
+        // @param       results         Cleared, then filled with the results.
+        // @param       values          The parameters, the first one being bound to '?1'.
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool ExecCachedStatement(const char* statementText, int& retValue, SqliteResultArena& results, std::vector<SqliteValue> const& values = std::vector<SqliteValue>());
+
+        //--------------------------------------------------------------------------------------
+        // @description Queue a write for the writer thread instead of waiting for the database.
+        //              Writes are executed in submission order; pending ones are grouped in a
+        //              single transaction, so the caller never waits for the commit. Writes
+        //              still pending when the wrapper is destroyed are executed first.
+        // @param       statementText   The request, with '?' parameters. Only its first statement is executed.
+        // @param       values          The parameters, the first one being bound to '?1'.
+        // @return      The result, available once the transaction of the write is committed.
+        //              SQLITE_MISUSE at once if the connection is opened with SQLITE_OPEN_NOMUTEX.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        std::future<SqliteWriteResult> ExecStatementAsync(const char* statementText, std::vector<SqliteValue> values = std::vector<SqliteValue>());
+
+        //--------------------------------------------------------------------------------------
+        // @description Queue a write for the writer thread and get its result through a callback.
+        // @param       statementText   The request, with '?' parameters. Only its first statement is executed.
+        // @param       values          The parameters, the first one being bound to '?1'.
+        // @param       callback        Called on the writer thread once the transaction is committed,
+        //                              or at once with SQLITE_MISUSE on a connection opened with
+        //                              SQLITE_OPEN_NOMUTEX.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void ExecStatementAsync(const char* statementText, std::vector<SqliteValue> values, SqliteWriteCallback callback);
+
+        //--------------------------------------------------------------------------------------
+        // @description Set the threads and the resume scheduler of the asynchronous queries.
+        //              Must be called before the first one, later calls have no effect.
+        // @param       options     Number of threads, where coroutines resume.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void SetAsyncQueryOptions(SqliteAsyncQueryOptions const& options);
+
+        //--------------------------------------------------------------------------------------
+        // @description Run a query on the threads of the asynchronous queries instead of the
+        //              calling one. When the database is locked, the query waits for the delay
+        //              of the retry policy without holding a thread, until the timeout. A
+        //              connection opened with SQLITE_OPEN_NOMUTEX cannot be used by these
+        //              threads: the callback then gets SQLITE_MISUSE at once.
+        // @param       statementText   The request, with '?' parameters. Only its first statement is executed.
+        // @param       values          The parameters, the first one being bound to '?1'.
+        // @param       callback        Called on one of these threads with the result.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void QueryAsync(const char* statementText, std::vector<SqliteValue> values, SqliteQueryCallback callback);
+
+#ifdef A3D_SQLITE_COROUTINES
+        //--------------------------------------------------------------------------------------
+        // @description Run a query like QueryAsync(), from a coroutine:
+        //
+        //                  SqliteQueryResult result = co_await wrapper.Query("SELECT ...", { id });
+        //
+        //              The coroutine resumes through the resume scheduler of the options, or
+        //              on the thread that ran the query. On a connection opened with
+        //              SQLITE_OPEN_NOMUTEX, it gets SQLITE_MISUSE without suspending.
+        // @param       statementText   The request, with '?' parameters. Only its first statement is executed.
+        // @param       values          The parameters, the first one being bound to '?1'.
+        // @return      The awaitable, to await at once.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        SqliteQueryAwaitable Query(const char* statementText, std::vector<SqliteValue> values = std::vector<SqliteValue>());
+#endif
+
+        //--------------------------------------------------------------------------------------
+        // @description Wait until all the asynchronous writes submitted so far are committed.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void WaitForAsyncWrites();
+
+        //--------------------------------------------------------------------------------------
+        // @description Change the maximum number of asynchronous writes grouped in one transaction.
+        // @param       maxGroupSize    Number of writes. Default is 256.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void SetAsyncWriteGroupSize(size_t maxGroupSize);
+
+        //--------------------------------------------------------------------------------------
+        // @description Load many rows into a table much faster than with one INSERT per
+        //              transaction: the non-unique indexes are dropped, the rows are inserted
+        //              through a single prepared statement in large transactions, optionally
+        //              in primary key order, then the indexes are built again. The journal and
+        //              synchronous pragmas are changed for the duration of the load. Must not
+        //              be called inside a transaction. On failure the rows of the current
+        //              transaction are rolled back; the ones already committed stay.
+        // @param       tableName       Name of the table of the main schema.
+        // @param       rowSource       Called for each row until it returns false.
+        // @param       retValue        Return code of the failing call, 0 on success.
+        // @param       options         Transaction size, sorting and pragmas of the load.
+        // @param       pnLoadedRows    If not null, return the number of rows committed.
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool BulkLoad(const char* tableName, SqliteRowSource const& rowSource, int& retValue, SqliteBulkLoadOptions const& options = SqliteBulkLoadOptions(), size_t* pnLoadedRows = nullptr);
+
+        //--------------------------------------------------------------------------------------
+        // @description Copy the database to a file while it stays in use, a few pages at a
+        //              time from a separate read-only connection, letting writers commit
+        //              between two steps. In WAL mode the copy is the database as it was when
+        //              the backup started; otherwise a commit from another connection restarts
+        //              it, up to options.maxRestarts times before the rest is copied in one step.
+        //              A database in memory is copied from the connection of the wrapper.
+        // @param       destinationPath The backup file, created or replaced.
+        // @param       retValue        Return code of the failing call, SQLITE_INTERRUPT if
+        //                              cancelled, 0 on success.
+        // @param       options         Pages per step, pause between steps, restarts.
+        // @param       callback        If set, called after each step with the progress.
+        // @param       pProgress       If not null, return the progress of the last step.
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool Backup(const char* destinationPath, int& retValue, SqliteBackupOptions const& options = SqliteBackupOptions(), SqliteBackupCallback const& callback = SqliteBackupCallback(), SqliteBackupProgress* pProgress = nullptr);
+
+        //--------------------------------------------------------------------------------------
+        // @description Import a CSV or TSV file into a table. The file is mapped in memory and
+        //              cut into chunks at record boundaries, parsed in parallel by a few
+        //              threads, and the records are loaded in file order by this thread through
+        //              BulkLoad(): each record must have one field per column of the table.
+        //              Values are bound as text, converted by the affinity of the columns.
+        // @param       filePath        The file.
+        // @param       tableName       The table, created from the first record if it does not
+        //                              exist and options.createTable is set.
+        // @param       retValue        Return code of the failing call, 0 on success.
+        // @param       options         Format, parsing threads and load settings.
+        // @param       pnImportedRows  If not null, return the number of rows committed.
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool ImportDelimitedText(const char* filePath, const char* tableName, int& retValue, SqliteDelimitedTextOptions const& options = SqliteDelimitedTextOptions(), size_t* pnImportedRows = nullptr);
+
+        //--------------------------------------------------------------------------------------
+        // @description Export the result of a statement to a CSV or TSV file, streamed from a
+        //              cursor into buffers written by another thread. NULL is written as an
+        //              empty field, the empty string as a quoted empty field, numbers as
+        //              SQLite converts them to text.
+        // @param       statementText   The query.
+        // @param       filePath        The file, created or replaced.
+        // @param       retValue        Return code of the failing call, 0 on success.
+        // @param       options         Format and buffer size. options.hasHeader writes the
+        //                              column names first.
+        // @param       pnExportedRows  If not null, return the number of rows written.
+        // @param       values          Parameters of the statement.
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool ExportDelimitedText(const char* statementText, const char* filePath, int& retValue, SqliteDelimitedTextOptions const& options = SqliteDelimitedTextOptions(), size_t* pnExportedRows = nullptr, std::vector<SqliteValue> const& values = std::vector<SqliteValue>());
+
+        //--------------------------------------------------------------------------------------
+        // @description Fill a columnar batch with the next rows of a prepared statement.
+        // @param       statement   The statement, with its parameters bound.
+        // @param       batch       Cleared, then filled with up to its capacity rows. Its
+        //                          columns are set again when the statement starts.
+        // @param       retValue    SQLITE_ROW if the batch is full and more rows may follow,
+        //                          SQLITE_DONE when the statement has finished (it is then reset).
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool ExecColumnar(SqliteStatement& statement, SqliteColumnarBatch& batch, int& retValue);
+
+        //--------------------------------------------------------------------------------------
+        // @description Execute an SQL statement and get its results in columnar batches.
+        // @param       statementText   The request. Only the first statement of the text is executed.
+        // @param       retValue        Return code after execution.
+        // @param       batch           Batch reused for each group of rows.
+        // @param       batchVisitor    Called with each non-empty batch, returns false to stop early.
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool ExecColumnar(const char* statementText, int& retValue, SqliteColumnarBatch& batch, std::function<bool(SqliteColumnarBatch const& batch)> const& batchVisitor);
+
+        //--------------------------------------------------------------------------------------
+        // @description Prepare an SQL statement, or reuse it from the statement cache if the same
+        //              text was already prepared. Parameters are then bound and the statement is
+        //              evaluated through the returned handle, which gives it back to the cache
+        //              when destroyed.
+        // @param       statementText   The request, with '?' parameters.
+        // @param       statement       Filled with the prepared statement.
+        // @param       retValue        Return code after preparation.
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool Prepare(const char* statementText, SqliteStatement& statement, int& retValue);
+
+        //--------------------------------------------------------------------------------------
+        // @description Prepare an SQL statement, or reuse it from the statement cache.
+        // @param       statementText   The request, with '?' parameters.
+        // @param       statement       Filled with the prepared statement.
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool Prepare(const char* statementText, SqliteStatement& statement);
+
+        //--------------------------------------------------------------------------------------
+        // @description Prepare the multi-row INSERT, or UPSERT, of the rows of a table. Rows
+        //              are then added through the handle, which inserts them a batch at a time.
+        // @param       tableName   Name of the table of the main schema.
+        // @param       insert      Released, then filled with the prepared statement.
+        // @param       retValue    Return code of the failing call.
+        // @param       options     Columns, rows per statement, conflict clause.
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool PrepareMultiRowInsert(const char* tableName, SqliteMultiRowInsert& insert, int& retValue, SqliteMultiRowInsertOptions const& options = SqliteMultiRowInsertOptions());
+
+        //--------------------------------------------------------------------------------------
+        // @description Prepare an SQL statement and open a streaming cursor on its result.
+        //              Rows are stepped one at a time as the cursor advances.
+        // @param       statementText   The request, with '?' parameters.
+        // @param       cursor          Closed, then opened on the statement.
+        // @param       retValue        Return code after preparation.
+        // @param       values          The parameters, the first one being bound to '?1'.
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool OpenCursor(const char* statementText, SqliteCursor& cursor, int& retValue, std::vector<SqliteValue> const& values = std::vector<SqliteValue>());
+
+        //--------------------------------------------------------------------------------------
+        // @description Change the maximum number of idle prepared statements kept in the cache.
+        //              0 disables the cache.
+        // @param       capacity    Number of statements.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void SetStatementCacheSize(size_t capacity);
+
         //--------------------------------------------------------------------------------------
         // @description   Start an SQL transaction. EndTransaction() must be called at the end.
         // @return        True if everything went well, false otherwise.
@@ -137,11 +692,27 @@ namespace A3D
         //+---------------+---------------+---------------+---------------+---------------+------
         bool IsInTransaction();
 
+        //--------------------------------------------------------------------------------------
+        // @description   Return the connection, for the SQLite calls the wrapper does not cover.
+        //                Calls made on it bypass the locking and retries of the wrapper, and
+        //                the connection changes if the wrapper reconnects.
+        // @return        The connection, nullptr if the database could not be opened. Opens
+        //                the database if its opening was deferred.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        sqlite3* GetHandle() const;
+
         //--------------------------------------------------------------------------------------
         // @description   Return last message error triggered by Sqlite.
         // @return        A string with the message.
         // @bsimethod                                         Alexandre Gbaguidi A�sse   08/19
         //+---------------+---------------+---------------+---------------+---------------+------
         std::string LastErrorMessage();
+
+        //--------------------------------------------------------------------------------------
+        // @description   Quote a table, column or index name for an SQL statement.
+        // @param         name    The name.
+        // @return        The name between double quotes, its own double quotes doubled.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        static std::string QuoteIdentifier(std::string const& name);
     };
 }
@@ -0,0 +1,76 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteWrapperOptions.cpp $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#include "SqliteWrapperOptions.h"
+
+#include <string.h>
+
+namespace A3D
+{
+    SqliteWrapperOptions SqliteWrapperOptions::ReadHeavyMmap()
+    {
+        SqliteWrapperOptions options;
+        options.mmapSize = 256 * 1024 * 1024;
+        // The memory map holds the pages, the cache only those not mapped yet
+        options.cacheSize = -16 * 1024;
+        options.pageSize = 4096;
+        options.lookasideSlotSize = 1200;
+        options.lookasideSlotCount = 256;
+        options.tempStore = "MEMORY";
+        return options;
+    }
+
+    SqliteWrapperOptions SqliteWrapperOptions::WriteHeavyWal()
+    {
+        SqliteWrapperOptions options;
+        options.mmapSize = 0;
+        options.cacheSize = -64 * 1024;
+        options.pageSize = 4096;
+        options.lookasideSlotSize = 1200;
+        options.lookasideSlotCount = 256;
+        options.tempStore = "MEMORY";
+        options.journalMode = "WAL";
+        // Durable at each checkpoint rather than at each commit, never corrupted
+        options.synchronous = "NORMAL";
+        return options;
+    }
+
+    SqliteWrapperOptions SqliteWrapperOptions::LowMemoryEmbedded()
+    {
+        SqliteWrapperOptions options;
+        options.statementCacheSize = 16;
+        options.mmapSize = 0;
+        options.cacheSize = -512;
+        options.pageSize = 1024;
+        options.lookasideSlotSize = 128;
+        options.lookasideSlotCount = 32;
+        options.tempStore = "FILE";
+        return options;
+    }
+
+    bool SqliteWrapperOptions::FromProfileName(const char* profileName, SqliteWrapperOptions& options)
+    {
+        if (strcmp(profileName, "read-heavy-mmap") == 0)
+        {
+            options = ReadHeavyMmap();
+        }
+        else if (strcmp(profileName, "write-heavy-wal") == 0)
+        {
+            options = WriteHeavyWal();
+        }
+        else if (strcmp(profileName, "low-memory-embedded") == 0)
+        {
+            options = LowMemoryEmbedded();
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,68 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteWrapperOptions.h $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#pragma once
+extern "C" {
+    #include "sqlite3.h"
+}
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace A3D
+{
+    //--------------------------------------------------------------------------------------
+    // Settings of a SqliteWrapper given at construction: how the connection is opened, its
+    // memory-mapped I/O, page cache, lookaside and journal. They are applied right after
+    // the connection is opened and again after each reconnection. The profiles set them
+    // together for a kind of workload.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    struct SqliteWrapperOptions
+    {
+        unsigned int timeoutMs = 3000;                               // Retry timeout (ms). 0 = forever.
+        int openFlags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX;
+        size_t statementCacheSize = 64;                              // Prepared statements kept by the wrapper.
+
+        int64_t mmapSize = -1;                                       // mmap_size (bytes). -1 = unchanged.
+        int cacheSize = 0;                                           // cache_size: pages when positive, KiB when negative. 0 = unchanged.
+        int pageSize = 0;                                            // page_size, only effective on a new database or by VACUUM outside WAL mode. 0 = unchanged.
+        int lookasideSlotSize = 0;                                   // Lookaside allocator, both sizes set or none. 0 = unchanged.
+        int lookasideSlotCount = 0;
+        std::string tempStore;                                       // temp_store: DEFAULT, FILE or MEMORY. Empty = unchanged.
+        std::string journalMode;                                     // journal_mode. Empty = unchanged.
+        std::string synchronous;                                     // synchronous. Empty = unchanged.
+        bool lazyOpen = false;                                       // Open the connection at the first call instead of in the constructor.
+
+        //--------------------------------------------------------------------------------------
+        // @description Profile for concurrent readers of a database larger than the page cache:
+        //              pages are read through a 256 MiB memory map instead of being copied.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        static SqliteWrapperOptions ReadHeavyMmap();
+
+        //--------------------------------------------------------------------------------------
+        // @description Profile for frequent small transactions: WAL with synchronous=NORMAL,
+        //              a 64 MiB page cache holding the pages being modified.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        static SqliteWrapperOptions WriteHeavyWal();
+
+        //--------------------------------------------------------------------------------------
+        // @description Profile for embedded devices: small pages, a 512 KiB page cache, no
+        //              memory map, temporary tables on disk and few cached statements.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        static SqliteWrapperOptions LowMemoryEmbedded();
+
+        //--------------------------------------------------------------------------------------
+        // @description Get a profile by its name: "read-heavy-mmap", "write-heavy-wal" or
+        //              "low-memory-embedded".
+        // @param       profileName The name of the profile.
+        // @param       options     Set to the profile.
+        // @return      False if there is no profile with this name, true otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        static bool FromProfileName(const char* profileName, SqliteWrapperOptions& options);
+    };
+}
@@ -0,0 +1,152 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteWriteBatch.cpp $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#include "SqliteWriteBatch.h"
+
+#include <iostream>
+
+namespace A3D
+{
+    SqliteWriteBatch::SqliteWriteBatch(SqliteWrapper& wrapper, size_t maxRows, size_t maxBytes)
+        : m_wrapper(wrapper),
+        m_maxRows(maxRows),
+        m_maxBytes(maxBytes),
+        m_byteCount(0)
+    {
+    }
+
+    SqliteWriteBatch::~SqliteWriteBatch()
+    {
+        if (!Flush())
+            std::cout << "SqliteWriteBatch: could not flush " << m_entries.size() << " pending statements" << std::endl;
+    }
+
+    bool SqliteWriteBatch::Add(const char* statementText, std::initializer_list<SqliteValue> values)
+    {
+        return Add(statementText, std::vector<SqliteValue>(values));
+    }
+
+    bool SqliteWriteBatch::Add(const char* statementText, std::vector<SqliteValue> const& values)
+    {
+        auto found = m_statementIndexes.find(statementText);
+        if (found == m_statementIndexes.end())
+        {
+            found = m_statementIndexes.emplace(statementText, m_statementTexts.size()).first;
+            m_statementTexts.push_back(statementText);
+        }
+
+        Entry entry;
+        entry.statementIndex = found->second;
+        entry.firstValue = m_values.size();
+        entry.valueCount = values.size();
+        m_entries.push_back(entry);
+        for (SqliteValue const& value : values)
+        {
+            m_values.push_back(value);
+            m_byteCount += value.GetType() == SQLITE_TEXT || value.GetType() == SQLITE_BLOB ? value.GetBytes().size() : sizeof(sqlite3_a3d_int64);
+        }
+
+        if ((m_maxRows > 0 && m_entries.size() >= m_maxRows) || (m_maxBytes > 0 && m_byteCount >= m_maxBytes))
+        {
+            return Flush();
+        }
+        return true;
+    }
+
+    bool SqliteWriteBatch::Execute(std::vector<SqliteStatement>& statements, int& retValue)
+    {
+        for (Entry const& entry : m_entries)
+        {
+            SqliteStatement& statement = statements[entry.statementIndex];
+            if (!statement.IsValid() && !m_wrapper.Prepare(m_statementTexts[entry.statementIndex].c_str(), statement, retValue))
+            {
+                return false;
+            }
+            // Parameters left out by this entry are NULL, not the values of the previous one
+            statement.ClearBindings();
+            for (size_t i = 0; i < entry.valueCount; ++i)
+            {
+                if (!statement.BindValue((int)i + 1, m_values[entry.firstValue + i]))
+                {
+                    retValue = SQLITE_RANGE;
+                    return false;
+                }
+            }
+            if (!statement.Exec(retValue))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool SqliteWriteBatch::Flush(int& retValue)
+    {
+        retValue = 0;
+        if (m_entries.empty())
+            return true;
+
+        // Join the transaction of the caller if there is one
+        bool useSavepoint = m_wrapper.IsInTransaction();
+        if (useSavepoint ? !m_wrapper.ExecStatement("SAVEPOINT write_batch", retValue) : !m_wrapper.ExecStatement("BEGIN IMMEDIATE TRANSACTION", retValue))
+        {
+            return false;
+        }
+
+        bool succeeded;
+        {
+            std::vector<SqliteStatement> statements(m_statementTexts.size());
+            succeeded = Execute(statements, retValue);
+        }
+
+        if (succeeded)
+        {
+            succeeded = useSavepoint ? m_wrapper.ExecStatement("RELEASE write_batch", retValue) : m_wrapper.ExecStatement("COMMIT", retValue);
+        }
+        if (!succeeded)
+        {
+            int rollbackRetValue = 0;
+            if (useSavepoint)
+            {
+                m_wrapper.ExecStatement("ROLLBACK TO write_batch", rollbackRetValue);
+                m_wrapper.ExecStatement("RELEASE write_batch", rollbackRetValue);
+            }
+            else if (m_wrapper.IsInTransaction())
+            {
+                m_wrapper.RollBackTransaction();
+            }
+            return false;
+        }
+
+        Clear();
+        return true;
+    }
+
+    bool SqliteWriteBatch::Flush()
+    {
+        int retValue;
+        return Flush(retValue);
+    }
+
+    void SqliteWriteBatch::Clear()
+    {
+        m_entries.clear();
+        m_values.clear();
+        m_byteCount = 0;
+    }
+
+    size_t SqliteWriteBatch::GetPendingRows() const
+    {
+        return m_entries.size();
+    }
+
+    size_t SqliteWriteBatch::GetPendingBytes() const
+    {
+        return m_byteCount;
+    }
+}
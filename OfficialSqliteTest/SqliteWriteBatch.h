@@ -0,0 +1,81 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteWriteBatch.h $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#pragma once
+#include "SqliteWrapper.h"
+#include <initializer_list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace A3D
+{
+    //--------------------------------------------------------------------------------------
+    // Group of parameterized write statements executed in a single transaction
+    // (BEGIN IMMEDIATE / COMMIT, or a savepoint if a transaction is already open).
+    // Each distinct SQL text is prepared once per flush and reused for all its rows.
+    // The batch flushes by itself when it holds 'maxRows' statements or 'maxBytes' bytes
+    // of parameters, and when it is destroyed. Not thread safe: one batch per thread.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    class SqliteWriteBatch
+    {
+    private:
+        struct Entry
+        {
+            size_t statementIndex;
+            size_t firstValue;
+            size_t valueCount;
+        };
+
+        SqliteWrapper& m_wrapper;
+        size_t m_maxRows;
+        size_t m_maxBytes;
+        size_t m_byteCount;
+        std::vector<std::string> m_statementTexts;
+        std::unordered_map<std::string, size_t> m_statementIndexes;
+        std::vector<Entry> m_entries;
+        std::vector<SqliteValue> m_values;
+
+        bool Execute(std::vector<SqliteStatement>& statements, int& retValue);
+
+    public:
+        //--------------------------------------------------------------------------------------
+        // @param       wrapper     The database to write to. Must outlive the batch.
+        // @param       maxRows     Number of statements that triggers a flush. 0 = no limit.
+        // @param       maxBytes    Size of the parameters that triggers a flush. 0 = no limit.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        explicit SqliteWriteBatch(SqliteWrapper& wrapper, size_t maxRows = 1000, size_t maxBytes = 4 * 1024 * 1024);
+        ~SqliteWriteBatch();
+
+        //--------------------------------------------------------------------------------------
+        // @description Append a statement to the batch, flushing it if a threshold is reached.
+        // @param       statementText   The request, with '?' parameters.
+        // @param       values          The parameters, the first one being bound to '?1'.
+        // @return      False if the automatic flush failed, true otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool Add(const char* statementText, std::initializer_list<SqliteValue> values);
+        bool Add(const char* statementText, std::vector<SqliteValue> const& values);
+
+        //--------------------------------------------------------------------------------------
+        // @description Execute all the pending statements in one transaction. On failure the
+        //              transaction is rolled back and the statements stay pending.
+        // @param       retValue    Return code of the failing call, 0 on success.
+        // @return      True if everything went well, false otherwise.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        bool Flush(int& retValue);
+        bool Flush();
+
+        //--------------------------------------------------------------------------------------
+        // @description Forget the pending statements without executing them.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void Clear();
+
+        size_t GetPendingRows() const;
+        size_t GetPendingBytes() const;
+    };
+}
@@ -0,0 +1,251 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteWriteQueue.cpp $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#include "SqliteWriteQueue.h"
+#include "SqliteWrapper.h"
+
+#include <iostream>
+
+namespace A3D
+{
+    SqliteWriteQueue::SqliteWriteQueue(SqliteWrapper& wrapper, size_t maxGroupSize)
+        : m_wrapper(wrapper),
+        m_maxGroupSize(maxGroupSize > 0 ? maxGroupSize : 1),
+        m_head(&m_stub),
+        m_tail(&m_stub),
+        m_pendingCount(0),
+        m_isStopping(false)
+    {
+        m_stub.next.store(nullptr, std::memory_order_relaxed);
+        m_writerThread = std::thread(&SqliteWriteQueue::WriterLoop, this);
+    }
+
+    SqliteWriteQueue::~SqliteWriteQueue()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+            m_isStopping = true;
+        }
+        m_wake.notify_one();
+        m_writerThread.join();
+    }
+
+    /*
+    *   Intrusive MPSC queue from Dmitry Vyukov: producers only exchange the head, then link
+    *   the previous head to their node. Between both steps the list is cut, Pop() then
+    *   returns nullptr although the queue is not empty and the writer tries again.
+    */
+    void SqliteWriteQueue::Push(Request* request)
+    {
+        request->next.store(nullptr, std::memory_order_relaxed);
+        Request* previous = m_head.exchange(request, std::memory_order_acq_rel);
+        previous->next.store(request, std::memory_order_release);
+    }
+
+    SqliteWriteQueue::Request* SqliteWriteQueue::Pop()
+    {
+        Request* tail = m_tail;
+        Request* next = tail->next.load(std::memory_order_acquire);
+        if (tail == &m_stub)
+        {
+            if (!next)
+                return nullptr;
+            m_tail = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next)
+        {
+            m_tail = next;
+            return tail;
+        }
+        if (tail != m_head.load(std::memory_order_acquire))
+            return nullptr;
+
+        // Last node: put the stub behind it so it can be detached
+        Push(&m_stub);
+        next = tail->next.load(std::memory_order_acquire);
+        if (next)
+        {
+            m_tail = next;
+            return tail;
+        }
+        return nullptr;
+    }
+
+    void SqliteWriteQueue::Submit(Request* request)
+    {
+        Push(request);
+        // Only the first write of an idle period has to wake the writer up
+        if (m_pendingCount.fetch_add(1, std::memory_order_acq_rel) == 0)
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+            m_wake.notify_one();
+        }
+    }
+
+    std::future<SqliteWriteResult> SqliteWriteQueue::Submit(const char* statementText, std::vector<SqliteValue> values)
+    {
+        Request* request = new Request;
+        request->statementText = statementText ? statementText : "";
+        request->values = std::move(values);
+        std::future<SqliteWriteResult> result = request->promise.get_future();
+        Submit(request);
+        return result;
+    }
+
+    void SqliteWriteQueue::Submit(const char* statementText, std::vector<SqliteValue> values, SqliteWriteCallback callback)
+    {
+        Request* request = new Request;
+        request->statementText = statementText ? statementText : "";
+        request->values = std::move(values);
+        request->callback = std::move(callback);
+        Submit(request);
+    }
+
+    void SqliteWriteQueue::Flush()
+    {
+        Submit(nullptr, std::vector<SqliteValue>()).wait();
+    }
+
+    void SqliteWriteQueue::SetMaxGroupSize(size_t maxGroupSize)
+    {
+        // Read by the writer thread between two groups, a stale value only affects one group
+        m_maxGroupSize = maxGroupSize > 0 ? maxGroupSize : 1;
+    }
+
+    void SqliteWriteQueue::WriterLoop()
+    {
+        std::vector<Request*> group;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_wakeMutex);
+                m_wake.wait(lock, [this]() { return m_isStopping || m_pendingCount.load(std::memory_order_acquire) > 0; });
+            }
+            size_t pendingCount = m_pendingCount.load(std::memory_order_acquire);
+            if (pendingCount == 0)
+                break; // Stopping and everything was executed
+
+            group.clear();
+            size_t maxGroupSize = m_maxGroupSize;
+            while (group.size() < pendingCount && group.size() < maxGroupSize)
+            {
+                Request* request = Pop();
+                if (!request)
+                {
+                    // A producer is between its two steps of Push()
+                    std::this_thread::yield();
+                    continue;
+                }
+                group.push_back(request);
+            }
+
+            ExecuteGroup(group);
+            m_pendingCount.fetch_sub(group.size(), std::memory_order_acq_rel);
+        }
+    }
+
+    void SqliteWriteQueue::ExecuteGroup(std::vector<Request*>& group)
+    {
+        // Never run outside a transaction of the queue: in one of another thread, the writes
+        // reported as committed could still be rolled back. BEGIN waits through the retry policy.
+        int beginRetValue = 0;
+        bool inTransaction = m_wrapper.ExecStatement("BEGIN IMMEDIATE TRANSACTION", beginRetValue);
+        if (!inTransaction)
+        {
+            std::cout << "WriteQueue: could not begin a transaction for " << group.size() << " writes: " << sqlite3_a3d_errstr(beginRetValue) << std::endl;
+        }
+
+        SqliteStatement statement;
+        std::string const* preparedText = nullptr;
+        for (size_t i = 0; i < group.size(); ++i)
+        {
+            Request& request = *group[i];
+            SqliteWriteResult& result = request.result;
+            if (request.statementText.empty())
+            {
+                result.succeeded = true;
+                continue;
+            }
+            if (!inTransaction)
+            {
+                result.retValue = beginRetValue;
+                continue;
+            }
+
+            // Consecutive writes of the same request share its prepared statement
+            if (!preparedText || *preparedText != request.statementText)
+            {
+                preparedText = nullptr;
+                if (!m_wrapper.Prepare(request.statementText.c_str(), statement, result.retValue))
+                    continue;
+                preparedText = &request.statementText;
+            }
+            bool isBound = true;
+            for (size_t value = 0; isBound && value < request.values.size(); ++value)
+            {
+                isBound = statement.BindValue((int)value + 1, request.values[value]);
+            }
+            if (!isBound)
+            {
+                result.succeeded = false;
+                result.retValue = SQLITE_RANGE;
+            }
+            else
+            {
+                do
+                {
+                    result.succeeded = statement.Step(result.retValue, &result.updatedRows);
+                } while (result.succeeded && result.retValue == SQLITE_ROW);
+            }
+            statement.Reset();
+            statement.ClearBindings();
+
+            if (inTransaction && !result.succeeded && !m_wrapper.IsInTransaction())
+            {
+                // SQLite rolled back the whole transaction (SQLITE_FULL, SQLITE_IOERR...): the previous writes are lost too
+                for (size_t previous = 0; previous < i; ++previous)
+                {
+                    if (group[previous]->result.succeeded && !group[previous]->statementText.empty())
+                    {
+                        group[previous]->result.succeeded = false;
+                        group[previous]->result.retValue = result.retValue;
+                    }
+                }
+                // The next writes of the group fail with the same code
+                inTransaction = false;
+                beginRetValue = result.retValue;
+            }
+        }
+        statement.Release();
+
+        int retValue = 0;
+        if (inTransaction && !m_wrapper.ExecStatement("COMMIT", retValue))
+        {
+            m_wrapper.RollBackTransaction();
+            for (Request* request : group)
+            {
+                if (request->result.succeeded && !request->statementText.empty())
+                {
+                    request->result.succeeded = false;
+                    request->result.retValue = retValue;
+                }
+            }
+        }
+
+        for (Request* request : group)
+        {
+            if (request->callback)
+                request->callback(request->result);
+            else
+                request->promise.set_value(request->result);
+            delete request;
+        }
+    }
+}
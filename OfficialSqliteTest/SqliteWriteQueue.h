@@ -0,0 +1,118 @@
+/*--------------------------------------------------------------------------------------+
+|
+|     $Source: A3D/SqliteWrapper/SqliteWriteQueue.h $
+|
+|  $Copyright: (c) 2019 Bentley Systems, Incorporated. All rights reserved. $
+|
++--------------------------------------------------------------------------------------*/
+
+#pragma once
+#include "SqliteValue.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace A3D
+{
+    class SqliteWrapper;
+
+    //--------------------------------------------------------------------------------------
+    // Outcome of an asynchronous write, known once its transaction is committed.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    struct SqliteWriteResult
+    {
+        bool succeeded = false;
+        int retValue = 0;                                            // Return code of the statement, or of the BEGIN or COMMIT if that failed.
+        int updatedRows = 0;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Called on the writer thread with the result of a write. It must not wait for other
+    // asynchronous writes of the same wrapper.
+    //+---------------+---------------+---------------+---------------+---------------+------
+    typedef std::function<void(SqliteWriteResult const& result)> SqliteWriteCallback;
+
+    //--------------------------------------------------------------------------------------
+    // Writes submitted by any thread and executed in order by a single writer thread.
+    // Submission is lock-free (intrusive MPSC queue); the writer takes every pending write,
+    // up to the group size, and runs them in one BEGIN IMMEDIATE / COMMIT. A failing
+    // statement only fails its own write, unless SQLite rolled back the whole transaction.
+    // When the BEGIN fails, for instance while another thread holds a transaction on the
+    // connection, the whole group fails with its return code. Used through SqliteWrapper::ExecStatementAsync().
+    //+---------------+---------------+---------------+---------------+---------------+------
+    class SqliteWriteQueue
+    {
+    private:
+        struct Request
+        {
+            std::atomic<Request*> next;
+            std::string statementText;                               // Empty for a fence, which only waits for the previous writes.
+            std::vector<SqliteValue> values;
+            SqliteWriteCallback callback;
+            std::promise<SqliteWriteResult> promise;
+            SqliteWriteResult result;
+        };
+
+        SqliteWrapper& m_wrapper;
+        size_t m_maxGroupSize;
+
+        std::atomic<Request*> m_head;                                // Last pushed, exchanged by the producers.
+        Request* m_tail;                                             // Next to pop, only used by the writer thread.
+        Request m_stub;
+
+        std::atomic<size_t> m_pendingCount;
+        std::atomic<bool> m_isStopping;
+        std::mutex m_wakeMutex;
+        std::condition_variable m_wake;
+        std::thread m_writerThread;
+
+        void Push(Request* request);
+        Request* Pop();
+        void Submit(Request* request);
+        void WriterLoop();
+        void ExecuteGroup(std::vector<Request*>& group);
+
+    public:
+        explicit SqliteWriteQueue(SqliteWrapper& wrapper, size_t maxGroupSize = 256);
+
+        //--------------------------------------------------------------------------------------
+        // @description Stop the writer thread once all the submitted writes are executed.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        ~SqliteWriteQueue();
+
+        SqliteWriteQueue(SqliteWriteQueue const&) = delete;
+        SqliteWriteQueue& operator=(SqliteWriteQueue const&) = delete;
+
+        //--------------------------------------------------------------------------------------
+        // @description Queue a write.
+        // @param       statementText   The request, with '?' parameters. Only its first statement is executed.
+        // @param       values          The parameters, the first one being bound to '?1'.
+        // @return      The result, available once the write is committed.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        std::future<SqliteWriteResult> Submit(const char* statementText, std::vector<SqliteValue> values);
+
+        //--------------------------------------------------------------------------------------
+        // @description Queue a write and get its result through a callback.
+        // @param       statementText   The request, with '?' parameters. Only its first statement is executed.
+        // @param       values          The parameters, the first one being bound to '?1'.
+        // @param       callback        Called on the writer thread once the write is committed.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void Submit(const char* statementText, std::vector<SqliteValue> values, SqliteWriteCallback callback);
+
+        //--------------------------------------------------------------------------------------
+        // @description Wait until all the writes submitted before this call are committed.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void Flush();
+
+        //--------------------------------------------------------------------------------------
+        // @description Change the maximum number of writes grouped in one transaction.
+        // @param       maxGroupSize    Number of writes, at least 1.
+        //+---------------+---------------+---------------+---------------+---------------+------
+        void SetMaxGroupSize(size_t maxGroupSize);
+    };
+}
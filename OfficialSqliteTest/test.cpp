@@ -7,18 +7,34 @@
 static const char zHelp[] =
 "Usage: %s [--options] DATABASE\n"
 "Options:\n"
+"  --allocator A       SQLite memory allocator: system (default) or pool, the\n"
+"                        size-class pools of the wrapper cached per thread\n"
 "  --autovacuum        Enable AUTOVACUUM mode\n"
+"  --backend B         Run the SQL through B: raw, wrapper or prepared (default)\n"
+"  --backup FILE       Copy the database to FILE after the tests, 256 pages per step\n"
 "  --cachesize N       Set the cache size to N\n"
 "  --checkpoint        Run PRAGMA wal_checkpoint after each test case\n"
+"  --checkpointer      Checkpoint the WAL from a background thread (needs --journal wal)\n"
+"  --clients N         Run the mixed read/write workload from N threads\n"
+"  --clients-pool      Run the --clients workload a second time, each thread leasing\n"
+"                        a reader or the writer of a connection pool (switches to WAL)\n"
+"  --compare BASE NEW  Compare two --json or --csv files and show regressions\n"
+"  --csv FILE          Write the measures of each test to FILE as CSV ('-' = stdout)\n"
 "  --exclusive         Enable locking_mode=EXCLUSIVE\n"
 "  --explain           Like --sqlonly but with added EXPLAIN keywords\n"
 "  --heap SZ MIN       Memory allocator uses SZ bytes & min allocation MIN\n"
 "  --incrvacuum        Enable incremenatal vacuum mode\n"
+"  --json FILE         Write the measures of each test to FILE as JSON ('-' = stdout)\n"
 "  --journal M         Set the journal_mode to M\n"
 "  --key KEY           Set the encryption key to KEY\n"
+"  --lazy-open         Build the wrapper before configuring SQLite, open it at its\n"
+"                        first use and warm it up before the tests\n"
 "  --lookaside N SZ    Configure lookaside for N slots of SZ bytes each\n"
 "  --memdb             Use an in-memory database\n"
+"  --metrics           Show the wrapper metrics of each statement at the end\n"
 "  --mmap SZ           MMAP the first SZ bytes of the database file\n"
+"  --multirow N        Tests 100 to 120 insert N rows per statement through the\n"
+"                        multi-row INSERT of the wrapper, test 120 as an UPSERT\n"
 "  --multithread       Set multithreaded mode\n"
 "  --nomemstat         Disable memory statistics\n"
 "  --nosync            Set PRAGMA synchronous=OFF\n"
@@ -27,16 +43,29 @@ static const char zHelp[] =
 "  --pagesize N        Set the page size to N\n"
 "  --pcache N SZ       Configure N pages of pagecache each of size SZ bytes\n"
 "  --primarykey        Use PRIMARY KEY instead of UNIQUE where appropriate\n"
+"  --profile P         Open the wrapper with profile P: read-heavy-mmap,\n"
+"                        write-heavy-wal or low-memory-embedded\n"
+"  --reads P           Percentage of reads of the --clients workload (default: 80)\n"
 "  --repeat N          Repeat each SELECT N times (default: 1)\n"
 "  --reprepare         Reprepare each statement upon every invocation\n"
+"  --resultcache N     Cache up to N MB of SELECT results in the wrapper, with\n"
+"                        --backend wrapper (NULL values are then hashed as '')\n"
 "  --serialized        Set serialized threading mode\n"
 "  --singlethread      Set single-threaded mode - disables all mutexing\n"
 "  --sqlonly           No-op.  Only show the SQL that would have been run.\n"
 "  --shrink-memory     Invoke sqlite3_a3d_db_release_memory() frequently.\n"
 "  --size N            Relative test size.  Default=100\n"
+"  --slowlog MS        Log the statements lasting MS milliseconds or more, with\n"
+"                        their plan, and show them at the end (not with --trace)\n"
 "  --stats             Show statistics at the end\n"
+"  --sweep MIN MAX     Run the testsets at sizes MIN, 2*MIN, ... up to MAX and show\n"
+"                        the statements per second and page cache hit ratio of each\n"
+"  --sweep-clients MIN MAX  Same with MIN, 2*MIN, ... up to MAX --clients threads,\n"
+"                        at each size of --sweep or at --size\n"
 "  --temp N            N from 0 to 9.  0: no temp table. 9: all temp tables\n"
-"  --testset T         Run test-set T (main, cte, rtree, orm, fp, debug)\n"
+"  --testset T         Run test-set T (main, cte, rtree, orm, fp, debug, clients,\n"
+"                        csv, async)\n"
+"  --threshold P       Slowdown in percent reported as a regression (default: 10)\n"
 "  --trace             Turn on SQL tracing\n"
 "  --threads N         Use up to N threads for sorting\n"
 "  --utf16be           Set text encoding to UTF-16BE\n"
@@ -49,7 +78,16 @@ static const char zHelp[] =
 #define _CRT_SECURE_NO_WARNINGS
 #include <stdio.h>
 #include <string>
+#include "SqliteConnectionPool.h"
+#include "SqlitePoolAllocator.h"
 #include "SqliteWrapper.h"
+#include "SqliteWriteBatch.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -82,6 +120,16 @@ struct HashContext {
 };
 
 
+/* How the testsets run their SQL, see --backend */
+#define BACKEND_RAW       0    /* sqlite3_a3d_exec() and prepared statements on db */
+#define BACKEND_WRAPPER   1    /* SqliteWrapper::ExecStatement() only */
+#define BACKEND_PREPARED  2    /* SqliteWrapper::Prepare() and SqliteStatement */
+
+/* Format of the --json and --csv outputs */
+#define REPORT_JSON       1
+#define REPORT_CSV        2
+#define NIOSTAT           6     /* Number of I/O counters of each test */
+
 /* All global state is held in this structure */
 static struct Global {
     sqlite3* db;               /* The open database connection */
@@ -98,6 +146,29 @@ static struct Global {
     int szTest;                /* Scale factor for test iterations */
     int nRepeat;               /* Repeat selects this many times */
     int doCheckpoint;          /* Run PRAGMA wal_checkpoint after each trans */
+    int eBackend;              /* BACKEND_RAW, BACKEND_WRAPPER or BACKEND_PREPARED */
+    A3D::SqliteWrapper* pWrapper;  /* Wrapper that opened db */
+    int bResultCache;          /* BACKEND_WRAPPER runs through the result cache */
+    A3D::SqliteStatement prepared; /* Current statement of BACKEND_PREPARED */
+    char* zExecSql;            /* Current statement of BACKEND_WRAPPER */
+    std::vector<std::string> aExecBind; /* Its parameters, as SQL literals */
+    std::vector<A3D::SqliteValue> aExecValues; /* The same, bound by the result cache */
+    int nMultiRow;             /* Rows per statement of --multirow, 0 for one */
+    A3D::SqliteMultiRowInsert multiRow; /* Current insert of speedtest1_prepare_multirow() */
+    std::vector<A3D::SqliteValue> aMultiRowValues; /* Its current row */
+    int iTestNum;              /* Number of the current test */
+    char zTestName[64];        /* Name of the current test */
+    const char* zTestSet;      /* Name of the current testset */
+    sqlite3_a3d_int64 nTestRow;    /* Rows returned by the current test */
+    sqlite3_a3d_int64 nTestByte;   /* Bytes of text and blobs returned by the current test */
+    sqlite3_a3d_int64 nStatement;  /* Statements run so far, for --sweep */
+    u64 aIoStart[NIOSTAT];         /* I/O counters when the current test started */
+    FILE* pReport;             /* Output of --json or --csv */
+    int eReport;               /* REPORT_JSON or REPORT_CSV */
+    int nReport;               /* Number of tests written to pReport */
+    int nClients;              /* Number of threads of the clients testset */
+    int pctReads;              /* Percentage of reads of the clients testset */
+    int bClientsPool;          /* Also run the clients testset through a connection pool */
     const char* zWR;           /* Might be WITHOUT ROWID */
     const char* zNN;           /* Might be NOT NULL */
     const char* zPK;           /* Might be UNIQUE or PRIMARY KEY */
@@ -371,6 +442,103 @@ int speedtest1_numbername(unsigned int n, char* zOut, int nOut) {
 }
 
 
+/* Names of the I/O counters of /proc/PID/io kept for each test */
+static const char* azIoStat[NIOSTAT] = {
+    "rchar", "wchar", "syscr", "syscw", "read_bytes", "write_bytes"
+};
+
+/* Read the I/O counters of the process.  They stay at 0 if not on Linux. */
+static void speedtest1_io_stats(u64* aIo) {
+    int i;
+    for (i = 0; i < NIOSTAT; i++) aIo[i] = 0;
+#ifdef __linux__
+    {
+        FILE* in;
+        char z[200];
+        sqlite3_a3d_snprintf(sizeof(z), z, "/proc/%d/io", getpid());
+        in = fopen(z, "rb");
+        if (in == 0) return;
+        while (fgets(z, sizeof(z), in) != 0) {
+            for (i = 0; i < NIOSTAT; i++) {
+                int n = (int)strlen(azIoStat[i]);
+                if (strncmp(azIoStat[i], z, n) == 0 && z[n] == ':') {
+                    aIo[i] = strtoull(&z[n + 1], 0, 10);
+                    break;
+                }
+            }
+        }
+        fclose(in);
+    }
+#endif
+}
+
+/* Write a string as a CSV or JSON field */
+static void speedtest1_report_string(const char* z) {
+    char cQuote = '"';
+    fputc(cQuote, g.pReport);
+    for (; *z; z++) {
+        if (*z == '"') {
+            fputs(g.eReport == REPORT_CSV ? "\"\"" : "\\\"", g.pReport);
+        }
+        else if (*z == '\\' && g.eReport == REPORT_JSON) {
+            fputs("\\\\", g.pReport);
+        }
+        else {
+            fputc(*z, g.pReport);
+        }
+    }
+    fputc(cQuote, g.pReport);
+}
+
+/* Write the measures of the test that just ended to the --json or --csv file */
+static void speedtest1_report_test(sqlite3_a3d_int64 iElapseTime) {
+    sqlite3_a3d_int64 iCur, iHi;
+    u64 aIo[NIOSTAT];
+    int i;
+    if (g.pReport == 0) return;
+    sqlite3_a3d_status64(SQLITE_STATUS_MEMORY_USED, &iCur, &iHi, 0);
+    speedtest1_io_stats(aIo);
+    if (g.eReport == REPORT_CSV) {
+        if (g.nReport == 0) {
+            fprintf(g.pReport, "testset,test,name,ms,rows,bytes,mem_highwater");
+            for (i = 0; i < NIOSTAT; i++) fprintf(g.pReport, ",%s", azIoStat[i]);
+            fprintf(g.pReport, "\n");
+        }
+        speedtest1_report_string(g.zTestSet);
+        fprintf(g.pReport, ",%d,", g.iTestNum);
+        speedtest1_report_string(g.zTestName);
+        fprintf(g.pReport, ",%lld,%lld,%lld,%lld", iElapseTime, g.nTestRow,
+            g.nTestByte, iHi);
+        for (i = 0; i < NIOSTAT; i++) {
+            fprintf(g.pReport, ",%llu", (unsigned long long)(aIo[i] - g.aIoStart[i]));
+        }
+        fprintf(g.pReport, "\n");
+    }
+    else {
+        /* One test per line, so that --compare can read it back without a JSON parser */
+        fprintf(g.pReport, "%s\n  {\"testset\": ", g.nReport ? "," : "[");
+        speedtest1_report_string(g.zTestSet);
+        fprintf(g.pReport, ", \"test\": %d, \"name\": ", g.iTestNum);
+        speedtest1_report_string(g.zTestName);
+        fprintf(g.pReport, ", \"ms\": %lld, \"rows\": %lld, \"bytes\": %lld, \"mem_highwater\": %lld",
+            iElapseTime, g.nTestRow, g.nTestByte, iHi);
+        for (i = 0; i < NIOSTAT; i++) {
+            fprintf(g.pReport, ", \"%s\": %llu", azIoStat[i],
+                (unsigned long long)(aIo[i] - g.aIoStart[i]));
+        }
+        fprintf(g.pReport, "}");
+    }
+    g.nReport++;
+}
+
+/* Close the --json or --csv file */
+static void speedtest1_report_close(void) {
+    if (g.pReport == 0) return;
+    if (g.eReport == REPORT_JSON) fprintf(g.pReport, "%s]\n", g.nReport ? "\n" : "[");
+    if (g.pReport != stdout) fclose(g.pReport);
+    g.pReport = 0;
+}
+
 /* Start a new test case */
 #define NAMEWIDTH 60
 static const char zDots[] =
@@ -394,8 +562,17 @@ void speedtest1_begin_test(int iTestNum, const char* zTestName, ...) {
         printf("%4d - %s%.*s ", iTestNum, zName, NAMEWIDTH - n, zDots);
         fflush(stdout);
     }
+    g.iTestNum = iTestNum;
+    sqlite3_a3d_snprintf(sizeof(g.zTestName), g.zTestName, "%s", zName);
     sqlite3_a3d_free(zName);
     g.nResult = 0;
+    g.nTestRow = 0;
+    g.nTestByte = 0;
+    if (g.pReport) {
+        sqlite3_a3d_int64 iCur, iHi;
+        sqlite3_a3d_status64(SQLITE_STATUS_MEMORY_USED, &iCur, &iHi, 1);
+        speedtest1_io_stats(g.aIoStart);
+    }
     g.iStart = speedtest1_timestamp();
     g.x = 0xad131d0b;
     g.y = 0x44f9eac8;
@@ -411,11 +588,17 @@ void speedtest1_end_test(void) {
     if (!g.bSqlOnly) {
         g.iTotal += iElapseTime;
         printf("%4d.%03ds\n", (int)(iElapseTime / 1000), (int)(iElapseTime % 1000));
+        speedtest1_report_test(iElapseTime);
     }
     if (g.pStmt) {
         sqlite3_a3d_finalize(g.pStmt);
         g.pStmt = 0;
     }
+    g.prepared.Release();
+    if (g.zExecSql) {
+        sqlite3_a3d_free(g.zExecSql);
+        g.zExecSql = 0;
+    }
 }
 
 /* Report end of testing */
@@ -439,6 +622,7 @@ void speedtest1_final(void) {
 #endif
         printf("\n");
     }
+    speedtest1_report_close();
 }
 
 /* Print an SQL statement to standard output */
@@ -468,8 +652,15 @@ void speedtest1_shrink_memory(void) {
 #endif
 }
 
+/* Report a failed call of the backend and exit */
+static void speedtest1_backend_error(const char* zWhat) {
+    if (g.eBackend == BACKEND_RAW) {
+        fatal_error("%s error: %s\n", zWhat, sqlite3_a3d_errmsg(g.db));
+    }
+    fatal_error("%s error: %s\n", zWhat, g.pWrapper->LastErrorMessage().c_str());
+}
+
 /* Run SQL */
-A3D::SqliteWrapper wrapper("database.db");
 void speedtest1_exec(const char* zFormat, ...) {
     va_list ap;
     char* zSql;
@@ -479,22 +670,17 @@ void speedtest1_exec(const char* zFormat, ...) {
     if (g.bSqlOnly) {
         printSql(zSql);
     }
-    else {
-        if (!wrapper.ExecStatement(zSql))
-        {
-            fatal_error("exec error: %s\n", sqlite3_a3d_errmsg(g.db));
-        }
-        else
-        {
-            //printf("Exec Success\n");
-        }
-        /*
+    else if (g.eBackend == BACKEND_RAW) {
         char* zErrMsg = 0;
         int rc = sqlite3_a3d_exec(g.db, zSql, 0, 0, &zErrMsg);
         if (zErrMsg) fatal_error("SQL error: %s\n%s\n", zErrMsg, zSql);
         if (rc != SQLITE_OK) fatal_error("exec error: %s\n", sqlite3_a3d_errmsg(g.db));
-        */
     }
+    else {
+        /* The text may hold several statements: both wrapper backends use sqlite3_a3d_exec() */
+        if (!g.pWrapper->ExecStatement(zSql)) speedtest1_backend_error("exec");
+    }
+    if (!g.bSqlOnly) g.nStatement++;
     sqlite3_a3d_free(zSql);
     speedtest1_shrink_memory();
 }
@@ -514,7 +700,7 @@ char* speedtest1_once(const char* zFormat, ...) {
     if (g.bSqlOnly) {
         printSql(zSql);
     }
-    else {
+    else if (g.eBackend == BACKEND_RAW) {
         int rc = sqlite3_a3d_prepare_v2(g.db, zSql, -1, &pStmt, 0);
         if (rc) {
             fatal_error("SQL error: %s\n", sqlite3_a3d_errmsg(g.db));
@@ -525,11 +711,49 @@ char* speedtest1_once(const char* zFormat, ...) {
         }
         sqlite3_a3d_finalize(pStmt);
     }
+    else if (g.eBackend == BACKEND_WRAPPER) {
+        std::vector<std::vector<std::string>> results;
+        int rc;
+        if (!g.pWrapper->ExecStatement(zSql, rc, results)) speedtest1_backend_error("SQL");
+        if (!results.empty() && !results[0].empty()) {
+            zResult = sqlite3_a3d_mprintf("%s", results[0][0].c_str());
+        }
+    }
+    else {
+        int rc;
+        if (!g.pWrapper->ExecStatement(zSql, rc, [&zResult](A3D::SqliteRow const& row) {
+            std::string_view z = row.GetText(0);
+            if (z.data()) zResult = sqlite3_a3d_mprintf("%.*s", (int)z.size(), z.data());
+            return false;
+        })) {
+            speedtest1_backend_error("SQL");
+        }
+    }
+    if (!g.bSqlOnly) g.nStatement++;
     sqlite3_a3d_free(zSql);
     speedtest1_shrink_memory();
     return zResult;
 }
 
+/* Set a pragma of the connection, restored if the wrapper reconnects */
+void speedtest1_pragma(const char* zName, const char* zFormat, ...) {
+    va_list ap;
+    char* zValue;
+    int rc;
+    va_start(ap, zFormat);
+    zValue = sqlite3_a3d_vmprintf(zFormat, ap);
+    va_end(ap);
+    if (g.bSqlOnly) {
+        char* zSql = sqlite3_a3d_mprintf("PRAGMA %s=%s", zName, zValue);
+        printSql(zSql);
+        sqlite3_a3d_free(zSql);
+    }
+    else if (!g.pWrapper->SetPragma(zName, zValue, rc)) {
+        fatal_error("PRAGMA %s=%s error: %s\n", zName, zValue, g.pWrapper->LastErrorMessage().c_str());
+    }
+    sqlite3_a3d_free(zValue);
+}
+
 /* Prepare an SQL statement */
 void speedtest1_prepare(const char* zFormat, ...) {
     va_list ap;
@@ -540,7 +764,7 @@ void speedtest1_prepare(const char* zFormat, ...) {
     if (g.bSqlOnly) {
         printSql(zSql);
     }
-    else {
+    else if (g.eBackend == BACKEND_RAW) {
         int rc;
         if (g.pStmt) sqlite3_a3d_finalize(g.pStmt);
         rc = sqlite3_a3d_prepare_v2(g.db, zSql, -1, &g.pStmt, 0);
@@ -548,75 +772,291 @@ void speedtest1_prepare(const char* zFormat, ...) {
             fatal_error("SQL error: %s\n", sqlite3_a3d_errmsg(g.db));
         }
     }
+    else if (g.eBackend == BACKEND_WRAPPER) {
+        /* Parameters are substituted in the text by speedtest1_run() */
+        sqlite3_a3d_free(g.zExecSql);
+        g.zExecSql = zSql;
+        g.aExecBind.clear();
+        g.aExecValues.clear();
+        return;
+    }
+    else {
+        if (!g.pWrapper->Prepare(zSql, g.prepared)) speedtest1_backend_error("SQL");
+    }
     sqlite3_a3d_free(zSql);
 }
 
+/* Prepare the insert of rows of a table g.nMultiRow at a time, an UPSERT
+** if zConflict names a unique column.  The values bound by the
+** speedtest1_bind routines are a row, added by speedtest1_run() and
+** inserted by speedtest1_flush_multirow() at the latest. */
+void speedtest1_prepare_multirow(const char* zTable, const char* zConflict) {
+    A3D::SqliteMultiRowInsertOptions options;
+    int rc;
+    if (g.bSqlOnly) {
+        char* zSql = sqlite3_a3d_mprintf("-- INSERT INTO %s VALUES (...), (...)%s%s, %d rows per statement",
+            zTable, zConflict ? " ON CONFLICT " : "", zConflict ? zConflict : "", g.nMultiRow);
+        printSql(zSql);
+        sqlite3_a3d_free(zSql);
+        return;
+    }
+    options.rowsPerStatement = g.nMultiRow;
+    if (zConflict) options.conflictColumns.push_back(zConflict);
+    if (!g.pWrapper->PrepareMultiRowInsert(zTable, g.multiRow, rc, options)) speedtest1_backend_error("SQL");
+    g.aMultiRowValues.clear();
+}
+
+/* Insert the last rows of speedtest1_prepare_multirow() */
+void speedtest1_flush_multirow(void) {
+    int rc;
+    if (!g.multiRow.IsValid()) return;
+    if (!g.multiRow.Flush(rc)) speedtest1_backend_error("INSERT");
+    g.multiRow.Release();
+}
+
+static void speedtest1_multirow_bind(int iParam, A3D::SqliteValue const& value) {
+    if ((int)g.aMultiRowValues.size() < iParam) g.aMultiRowValues.resize(iParam);
+    g.aMultiRowValues[iParam - 1] = value;
+}
+
+/* Keep a parameter of the wrapper backend, as an SQL literal and as a value */
+static void speedtest1_keep_bind(int iParam, std::string const& zLiteral, A3D::SqliteValue const& value) {
+    if ((int)g.aExecBind.size() < iParam) {
+        g.aExecBind.resize(iParam, "NULL");
+        g.aExecValues.resize(iParam);
+    }
+    g.aExecBind[iParam - 1] = zLiteral;
+    g.aExecValues[iParam - 1] = value;
+}
+
+/* Bind a parameter of the statement of speedtest1_prepare().  The wrapper
+** backend keeps it as an SQL literal. */
+void speedtest1_bind_int64(int iParam, sqlite3_a3d_int64 iValue) {
+    if (g.bSqlOnly) return;
+    if (g.multiRow.IsValid()) {
+        speedtest1_multirow_bind(iParam, A3D::SqliteValue(iValue));
+    }
+    else if (g.eBackend == BACKEND_RAW) {
+        sqlite3_a3d_bind_int64(g.pStmt, iParam, iValue);
+    }
+    else if (g.eBackend == BACKEND_WRAPPER) {
+        speedtest1_keep_bind(iParam, std::to_string(iValue), A3D::SqliteValue(iValue));
+    }
+    else {
+        g.prepared.BindInt64(iParam, iValue);
+    }
+}
+
+void speedtest1_bind_int(int iParam, int iValue) {
+    if (g.bSqlOnly) return;
+    if (g.multiRow.IsValid()) {
+        speedtest1_multirow_bind(iParam, A3D::SqliteValue(iValue));
+    }
+    else if (g.eBackend == BACKEND_RAW) {
+        sqlite3_a3d_bind_int(g.pStmt, iParam, iValue);
+    }
+    else if (g.eBackend == BACKEND_PREPARED) {
+        g.prepared.BindInt(iParam, iValue);
+    }
+    else {
+        speedtest1_bind_int64(iParam, iValue);
+    }
+}
+
+void speedtest1_bind_double(int iParam, double rValue) {
+    if (g.bSqlOnly) return;
+    if (g.multiRow.IsValid()) {
+        speedtest1_multirow_bind(iParam, A3D::SqliteValue(rValue));
+    }
+    else if (g.eBackend == BACKEND_RAW) {
+        sqlite3_a3d_bind_double(g.pStmt, iParam, rValue);
+    }
+    else if (g.eBackend == BACKEND_WRAPPER) {
+        char* z = sqlite3_a3d_mprintf("%!.17g", rValue);
+        speedtest1_keep_bind(iParam, z, A3D::SqliteValue(rValue));
+        sqlite3_a3d_free(z);
+    }
+    else {
+        g.prepared.BindDouble(iParam, rValue);
+    }
+}
+
+/* The text must stay valid until speedtest1_run() for the raw backend */
+void speedtest1_bind_text(int iParam, const char* zValue, int nValue) {
+    if (g.bSqlOnly) return;
+    if (g.multiRow.IsValid()) {
+        speedtest1_multirow_bind(iParam, A3D::SqliteValue(zValue, nValue));
+    }
+    else if (g.eBackend == BACKEND_RAW) {
+        sqlite3_a3d_bind_text(g.pStmt, iParam, zValue, nValue, SQLITE_STATIC);
+    }
+    else if (g.eBackend == BACKEND_WRAPPER) {
+        std::string value = nValue < 0 ? std::string(zValue) : std::string(zValue, nValue);
+        char* z = sqlite3_a3d_mprintf("%Q", value.c_str());
+        speedtest1_keep_bind(iParam, z, A3D::SqliteValue(value));
+        sqlite3_a3d_free(z);
+    }
+    else {
+        g.prepared.BindText(iParam, zValue, nValue);
+    }
+}
+
+/* Return the statement of the wrapper backend with its parameters
+** replaced by their bound values. */
+static std::string speedtest1_substitute(const char* zSql) {
+    std::string sql;
+    int iNext = 1;
+    while (*zSql) {
+        if (*zSql == '\'' || *zSql == '"') {
+            char cQuote = *zSql;
+            sql += *zSql++;
+            while (*zSql && *zSql != cQuote) sql += *zSql++;
+            if (*zSql) sql += *zSql++;
+        }
+        else if (*zSql == '-' && zSql[1] == '-') {
+            while (*zSql && *zSql != '\n') sql += *zSql++;
+        }
+        else if (*zSql == '?') {
+            int iParam = 0;
+            zSql++;
+            if (ISDIGIT(*zSql)) {
+                while (ISDIGIT(*zSql)) iParam = iParam * 10 + (*zSql++ - '0');
+            }
+            else {
+                iParam = iNext;
+            }
+            iNext = iParam + 1;
+            sql += iParam <= (int)g.aExecBind.size() ? g.aExecBind[iParam - 1] : std::string("NULL");
+        }
+        else {
+            sql += *zSql++;
+        }
+    }
+    return sql;
+}
+
+/* Add one value of a result row to g.zResult and to the verification hash */
+static void speedtest1_result_value(int eType, const char* z, const void* pBlob, int nBlob) {
+    int len;
+    if (z == 0) z = "nil";
+    len = (int)strlen(z);
+#ifndef SPEEDTEST_OMIT_HASH
+    if (g.bVerify) {
+        unsigned char zPrefix[2];
+        zPrefix[0] = '\n';
+        zPrefix[1] = "-IFTBN"[eType];
+        if (g.nResByte) {
+            HashUpdate(zPrefix, 2);
+        }
+        else {
+            HashUpdate(zPrefix + 1, 1);
+        }
+        if (eType == SQLITE_FLOAT) {
+            /* Omit the value of floating-point results from the verification
+            ** hash.  The only thing we record is the fact that the result was
+            ** a floating-point value. */
+            g.nResByte += 2;
+        }
+        else if (eType == SQLITE_BLOB) {
+            int iBlob;
+            unsigned char zChar[2];
+            const unsigned char* aBlob = reinterpret_cast<const unsigned char*>(pBlob);
+            for (iBlob = 0; iBlob < nBlob; iBlob++) {
+                zChar[0] = "0123456789abcdef"[aBlob[iBlob] >> 4];
+                zChar[1] = "0123456789abcdef"[aBlob[iBlob] & 15];
+                HashUpdate(zChar, 2);
+            }
+            g.nResByte += nBlob * 2 + 2;
+        }
+        else {
+            HashUpdate((unsigned char*)z, len);
+            g.nResByte += len + 2;
+        }
+    }
+#endif
+    g.nTestByte += eType == SQLITE_BLOB ? nBlob : len;
+    if (g.nResult + len < sizeof(g.zResult) - 2) {
+        if (g.nResult > 0) g.zResult[g.nResult++] = ' ';
+        memcpy(g.zResult + g.nResult, z, len + 1);
+        g.nResult += len;
+    }
+}
+
+/* Add the current row of a statement to the result */
+static void speedtest1_result_row(sqlite3_a3d_stmt* pStmt) {
+    int i, n;
+    g.nTestRow++;
+    n = sqlite3_a3d_column_count(pStmt);
+    for (i = 0; i < n; i++) {
+        const char* z = (const char*)sqlite3_a3d_column_text(pStmt, i);
+        int eType = sqlite3_a3d_column_type(pStmt, i);
+        if (eType == SQLITE_BLOB) {
+            speedtest1_result_value(eType, z, sqlite3_a3d_column_blob(pStmt, i),
+                sqlite3_a3d_column_bytes(pStmt, i));
+        }
+        else {
+            speedtest1_result_value(eType, z, 0, 0);
+        }
+    }
+}
+
 /* Run an SQL statement previously prepared */
 void speedtest1_run(void) {
-    int i, n, len;
+    int rc;
     if (g.bSqlOnly) return;
-    assert(g.pStmt);
     g.nResult = 0;
-    while (sqlite3_a3d_step(g.pStmt) == SQLITE_ROW) {
-        n = sqlite3_a3d_column_count(g.pStmt);
-        for (i = 0; i < n; i++) {
-            const char* z = (const char*)sqlite3_a3d_column_text(g.pStmt, i);
-            if (z == 0) z = "nil";
-            len = (int)strlen(z);
-#ifndef SPEEDTEST_OMIT_HASH
-            if (g.bVerify) {
-                int eType = sqlite3_a3d_column_type(g.pStmt, i);
-                unsigned char zPrefix[2];
-                zPrefix[0] = '\n';
-                zPrefix[1] = "-IFTBN"[eType];
-                if (g.nResByte) {
-                    HashUpdate(zPrefix, 2);
-                }
-                else {
-                    HashUpdate(zPrefix + 1, 1);
-                }
-                if (eType == SQLITE_FLOAT) {
-                    /* Omit the value of floating-point results from the verification
-                    ** hash.  The only thing we record is the fact that the result was
-                    ** a floating-point value. */
-                    g.nResByte += 2;
-                }
-                else if (eType == SQLITE_BLOB) {
-                    int nBlob = sqlite3_a3d_column_bytes(g.pStmt, i);
-                    int iBlob;
-                    unsigned char zChar[2];
-                    const unsigned char* aBlob = reinterpret_cast<const unsigned char *>(sqlite3_a3d_column_blob(g.pStmt, i));
-                    for (iBlob = 0; iBlob < nBlob; iBlob++) {
-                        zChar[0] = "0123456789abcdef"[aBlob[iBlob] >> 4];
-                        zChar[1] = "0123456789abcdef"[aBlob[iBlob] & 15];
-                        HashUpdate(zChar, 2);
-                    }
-                    g.nResByte += nBlob * 2 + 2;
-                }
-                else {
-                    HashUpdate((unsigned char*)z, len);
-                    g.nResByte += len + 2;
-                }
+    g.nStatement++;
+    if (g.multiRow.IsValid()) {
+        if (!g.multiRow.AddRow(g.aMultiRowValues, rc)) speedtest1_backend_error("INSERT");
+        return;
+    }
+    if (g.eBackend == BACKEND_WRAPPER) {
+        /* The arena keeps the type of each value, hashed as speedtest1_result_row() does.
+        ** It is reused by all the statements so that results allocate nothing. */
+        static A3D::SqliteResultArena arena;
+        size_t iRow, iCol;
+        assert(g.zExecSql);
+        if (g.bResultCache) {
+            if (!g.pWrapper->ExecCachedStatement(g.zExecSql, rc, arena, g.aExecValues)) {
+                speedtest1_backend_error("SQL");
             }
-#endif
-            if (g.nResult + len < sizeof(g.zResult) - 2) {
-                if (g.nResult > 0) g.zResult[g.nResult++] = ' ';
-                memcpy(g.zResult + g.nResult, z, len + 1);
-                g.nResult += len;
+        }
+        else if (!g.pWrapper->ExecStatement(speedtest1_substitute(g.zExecSql).c_str(), rc, arena)) {
+            speedtest1_backend_error("SQL");
+        }
+        for (iRow = 0; iRow < arena.GetRowCount(); iRow++) {
+            g.nTestRow++;
+            for (iCol = 0; iCol < arena.GetColumnCount(); iCol++) {
+                std::string_view value = arena.GetText(iRow, iCol);
+                speedtest1_result_value(arena.GetType(iRow, iCol), value.data(), value.data(), (int)value.size());
             }
         }
     }
-#if SQLITE_VERSION_NUMBER>=3006001
-    if (g.bReprepare) {
-        sqlite3_a3d_stmt* pNew;
-        sqlite3_a3d_prepare_v2(g.db, sqlite3_a3d_sql(g.pStmt), -1, &pNew, 0);
-        sqlite3_a3d_finalize(g.pStmt);
-        g.pStmt = pNew;
+    else if (g.eBackend == BACKEND_PREPARED) {
+        assert(g.prepared.IsValid());
+        while (g.prepared.Step(rc) && rc == SQLITE_ROW) {
+            speedtest1_result_row(g.prepared.GetHandle());
+        }
+        if (rc != SQLITE_DONE) speedtest1_backend_error("step");
+        g.prepared.Reset();
     }
-    else
+    else {
+        assert(g.pStmt);
+        while (sqlite3_a3d_step(g.pStmt) == SQLITE_ROW) {
+            speedtest1_result_row(g.pStmt);
+        }
+#if SQLITE_VERSION_NUMBER>=3006001
+        if (g.bReprepare) {
+            sqlite3_a3d_stmt* pNew;
+            sqlite3_a3d_prepare_v2(g.db, sqlite3_a3d_sql(g.pStmt), -1, &pNew, 0);
+            sqlite3_a3d_finalize(g.pStmt);
+            g.pStmt = pNew;
+        }
+        else
 #endif
-    {
-        sqlite3_a3d_reset(g.pStmt);
+        {
+            sqlite3_a3d_reset(g.pStmt);
+        }
     }
     speedtest1_shrink_memory();
 }
@@ -731,84 +1171,77 @@ void testset_main(void) {
     sz = n = g.szTest * 500;
     zNum[0] = 0;
     maxb = roundup_allones(sz);
-    speedtest1_begin_test(100, "%d INSERTs into table with no index", n);
+    speedtest1_begin_test(100, "%d INSERTs into table with no index%s", n,
+        g.nMultiRow ? ", multi-row" : "");
     speedtest1_exec("BEGIN");
     speedtest1_exec("CREATE%s TABLE t1(a INTEGER %s, b INTEGER %s, c TEXT %s);",
         isTemp(9), g.zNN, g.zNN, g.zNN);
-    /*
-    speedtest1_prepare("INSERT INTO t1 VALUES(?1,?2,?3); --  %d times", n);
-    */
+    if (g.nMultiRow) {
+        speedtest1_prepare_multirow("t1", 0);
+    }
+    else {
+        speedtest1_prepare("INSERT INTO t1 VALUES(?1,?2,?3); --  %d times", n);
+    }
     for (i = 1; i <= n; i++) {
         x1 = swizzle(i, maxb);
         speedtest1_numbername(x1, zNum, sizeof(zNum));
-        if (!wrapper.ExecStatement((
-            "INSERT INTO t1 VALUES(" + std::to_string((sqlite3_a3d_int64)x1) + ',' + std::to_string(i) + ",\"" + std::to_string(*zNum) + "\");"
-            ).c_str()))
-        {
-            printf("fail\n");
-            break;
-        }
-        /*
-        sqlite3_a3d_bind_int64(g.pStmt, 1, (sqlite3_a3d_int64)x1);
-        sqlite3_a3d_bind_int(g.pStmt, 2, i);
-        sqlite3_a3d_bind_text(g.pStmt, 3, zNum, -1, SQLITE_STATIC);
+        speedtest1_bind_int64(1, (sqlite3_a3d_int64)x1);
+        speedtest1_bind_int(2, i);
+        speedtest1_bind_text(3, zNum, -1);
         speedtest1_run();
-        */
     }
+    speedtest1_flush_multirow();
     speedtest1_exec("COMMIT");
     speedtest1_end_test();
 
     n = sz;
-    speedtest1_begin_test(110, "%d ordered INSERTS with one index/PK", n);
+    speedtest1_begin_test(110, "%d ordered INSERTS with one index/PK%s", n,
+        g.nMultiRow ? ", multi-row" : "");
     speedtest1_exec("BEGIN");
     speedtest1_exec(
         "CREATE%s TABLE t2(a INTEGER %s %s, b INTEGER %s, c TEXT %s) %s",
         isTemp(5), g.zNN, g.zPK, g.zNN, g.zNN, g.zWR);
-    // speedtest1_prepare("INSERT INTO t2 VALUES(?1,?2,?3); -- %d times", n);
+    if (g.nMultiRow) {
+        speedtest1_prepare_multirow("t2", 0);
+    }
+    else {
+        speedtest1_prepare("INSERT INTO t2 VALUES(?1,?2,?3); --  %d times", n);
+    }
     for (i = 1; i <= n; i++) {
         x1 = swizzle(i, maxb);
         speedtest1_numbername(x1, zNum, sizeof(zNum));
-        if (!wrapper.ExecStatement((
-            "INSERT INTO t2 VALUES(" + std::to_string(i) + ',' + std::to_string((sqlite3_a3d_int64)x1) + ",\"" + std::to_string(*zNum) + "\");"
-            ).c_str()))
-        {
-            printf("fail\n");
-            break;
-        }
-        /*
-        sqlite3_a3d_bind_int(g.pStmt, 1, i);
-        sqlite3_a3d_bind_int64(g.pStmt, 2, (sqlite3_a3d_int64)x1);
-        sqlite3_a3d_bind_text(g.pStmt, 3, zNum, -1, SQLITE_STATIC);
+        speedtest1_bind_int(1, i);
+        speedtest1_bind_int64(2, (sqlite3_a3d_int64)x1);
+        speedtest1_bind_text(3, zNum, -1);
         speedtest1_run();
-        */
     }
+    speedtest1_flush_multirow();
     speedtest1_exec("COMMIT");
     speedtest1_end_test();
 
     n = sz;
-    speedtest1_begin_test(120, "%d unordered INSERTS with one index/PK", n);
+    speedtest1_begin_test(120, "%d unordered %s with one index/PK%s", n,
+        g.nMultiRow ? "UPSERTS" : "INSERTS", g.nMultiRow ? ", multi-row" : "");
     speedtest1_exec("BEGIN");
     speedtest1_exec(
         "CREATE%s TABLE t3(a INTEGER %s %s, b INTEGER %s, c TEXT %s) %s",
         isTemp(3), g.zNN, g.zPK, g.zNN, g.zNN, g.zWR);
-    // speedtest1_prepare("INSERT INTO t3 VALUES(?1,?2,?3); -- %d times", n);
+    if (g.nMultiRow) {
+        speedtest1_prepare_multirow("t3", "a");
+    }
+    else {
+        speedtest1_prepare("INSERT INTO t3 VALUES(?1,?2,?3); --  %d times", n);
+    }
     for (i = 1; i <= n; i++) {
         x1 = swizzle(i, maxb);
         speedtest1_numbername(x1, zNum, sizeof(zNum));
-        if (!wrapper.ExecStatement((
-            "INSERT INTO t3 VALUES(" + std::to_string(i) + ',' + std::to_string((sqlite3_a3d_int64)x1) + ",\"" + std::to_string(*zNum) + "\");"
-            ).c_str()))
-        {
-            printf("fail\n");
-            break;
-        }
-        /*
-        sqlite3_a3d_bind_int(g.pStmt, 2, i);
-        sqlite3_a3d_bind_int64(g.pStmt, 1, (sqlite3_a3d_int64)x1);
-        sqlite3_a3d_bind_text(g.pStmt, 3, zNum, -1, SQLITE_STATIC);
+        /* The random-order value goes to the PK, unlike test 110 */
+        speedtest1_bind_int(2, i);
+        speedtest1_bind_int64(1, (sqlite3_a3d_int64)x1);
+        speedtest1_bind_text(3, zNum, -1);
         speedtest1_run();
-        */
     }
+    speedtest1_flush_multirow();
     speedtest1_exec("COMMIT");
     speedtest1_end_test();
 
@@ -820,30 +1253,19 @@ void testset_main(void) {
     n = 25;
     speedtest1_begin_test(130, "%d SELECTS, numeric BETWEEN, unindexed", n);
     speedtest1_exec("BEGIN");
-    /*
     speedtest1_prepare(
         "SELECT count(*), avg(b), sum(length(c)), group_concat(c) FROM t1\n"
         " WHERE b BETWEEN ?1 AND ?2; -- %d times", n
     );
-    */
     for (i = 1; i <= n; i++) {
         if ((i - 1) % g.nRepeat == 0) {
             x1 = speedtest1_random() % maxb;
             x2 = speedtest1_random() % 10 + sz / 5000 + x1;
         }
 
-        if (!wrapper.ExecStatement((
-            "SELECT count(*), avg(b), sum(length(c)), group_concat(c) FROM t1 WHERE b BETWEEN " + std::to_string(x1) + " AND " + std::to_string(x2) + ';'
-            ).c_str()))
-        {
-            printf("fail\n");
-            break;
-        }
-        /*
-        sqlite3_a3d_bind_int(g.pStmt, 1, x1);
-        sqlite3_a3d_bind_int(g.pStmt, 2, x2);
+        speedtest1_bind_int(1, x1);
+        speedtest1_bind_int(2, x2);
         speedtest1_run();
-        */
     }
     speedtest1_exec("COMMIT");
     speedtest1_end_test();
@@ -851,12 +1273,10 @@ void testset_main(void) {
     n = 10;
     speedtest1_begin_test(140, "%d SELECTS, LIKE, unindexed", n);
     speedtest1_exec("BEGIN");
-    /*
     speedtest1_prepare(
         "SELECT count(*), avg(b), sum(length(c)), group_concat(c) FROM t1\n"
         " WHERE c LIKE ?1; -- %d times", n
     );
-    */
     for (i = 1; i <= n; i++) {
         if ((i - 1) % g.nRepeat == 0) {
             x1 = speedtest1_random() % maxb;
@@ -865,17 +1285,8 @@ void testset_main(void) {
             zNum[len] = '%';
             zNum[len + 1] = 0;
         }
-        if (!wrapper.ExecStatement((
-            "SELECT count(*), avg(b), sum(length(c)), group_concat(c) FROM t1 WHERE c LIKE \"" + std::string(zNum) + "\";"
-            ).c_str()))
-        {
-            printf("fail\n");
-            break;
-        }
-        /*
-        sqlite3_a3d_bind_text(g.pStmt, 1, zNum, len + 1, SQLITE_STATIC);
+        speedtest1_bind_text(1, zNum, len + 1);
         speedtest1_run();
-        */
     }
     speedtest1_exec("COMMIT");
     speedtest1_end_test();
@@ -883,12 +1294,10 @@ void testset_main(void) {
     n = 10;
     speedtest1_begin_test(142, "%d SELECTS w/ORDER BY, unindexed", n);
     speedtest1_exec("BEGIN");
-    /*
     speedtest1_prepare(
         "SELECT a, b, c FROM t1 WHERE c LIKE ?1\n"
         " ORDER BY a; -- %d times", n
     );
-    */
     for (i = 1; i <= n; i++) {
         if ((i - 1) % g.nRepeat == 0) {
             x1 = speedtest1_random() % maxb;
@@ -897,17 +1306,8 @@ void testset_main(void) {
             zNum[len] = '%';
             zNum[len + 1] = 0;
         }
-        if (!wrapper.ExecStatement((
-            "SELECT a, b, c FROM t1 WHERE c LIKE \"" + std::string(zNum) + "\" ORDER BY a;"
-            ).c_str()))
-        {
-            printf("fail\n");
-            break;
-        }
-        /*
-        sqlite3_a3d_bind_text(g.pStmt, 1, zNum, len + 1, SQLITE_STATIC);
+        speedtest1_bind_text(1, zNum, len + 1);
         speedtest1_run();
-        */
     }
     speedtest1_exec("COMMIT");
     speedtest1_end_test();
@@ -916,12 +1316,10 @@ void testset_main(void) {
     n = 10; // g.szTest/5;
     speedtest1_begin_test(145, "%d SELECTS w/ORDER BY and LIMIT, unindexed", n);
     speedtest1_exec("BEGIN");
-    /*
     speedtest1_prepare(
         "SELECT a, b, c FROM t1 WHERE c LIKE ?1\n"
         " ORDER BY a LIMIT 10; -- %d times", n
     );
-    */
     for (i = 1; i <= n; i++) {
         if ((i - 1) % g.nRepeat == 0) {
             x1 = speedtest1_random() % maxb;
@@ -930,17 +1328,8 @@ void testset_main(void) {
             zNum[len] = '%';
             zNum[len + 1] = 0;
         }
-        if (!wrapper.ExecStatement((
-            "SELECT a, b, c FROM t1 WHERE c LIKE \"" + std::string(zNum) +  "\" ORDER BY a LIMIT 10;"
-            ).c_str()))
-        {
-            printf("fail\n");
-            break;
-        }
-        /*
-        sqlite3_a3d_bind_text(g.pStmt, 1, zNum, len + 1, SQLITE_STATIC);
+        speedtest1_bind_text(1, zNum, len + 1);
         speedtest1_run();
-        */
     }
     speedtest1_exec("COMMIT");
     speedtest1_end_test();
@@ -960,29 +1349,18 @@ void testset_main(void) {
     n = sz / 5;
     speedtest1_begin_test(160, "%d SELECTS, numeric BETWEEN, indexed", n);
     speedtest1_exec("BEGIN");
-    /*
     speedtest1_prepare(
         "SELECT count(*), avg(b), sum(length(c)), group_concat(a) FROM t1\n"
         " WHERE b BETWEEN ?1 AND ?2; -- %d times", n
     );
-    */
     for (i = 1; i <= n; i++) {
         if ((i - 1) % g.nRepeat == 0) {
             x1 = speedtest1_random() % maxb;
             x2 = speedtest1_random() % 10 + sz / 5000 + x1;
         }
-        if (!wrapper.ExecStatement((
-            "SELECT count(*), avg(b), sum(length(c)), group_concat(a) FROM t1 WHERE b BETWEEN " + std::to_string(x1) + " AND " + std::to_string(x2) + ';'
-            ).c_str()))
-        {
-            printf("fail\n");
-            break;
-        }
-        /*
-        sqlite3_a3d_bind_int(g.pStmt, 1, x1);
-        sqlite3_a3d_bind_int(g.pStmt, 2, x2);
+        speedtest1_bind_int(1, x1);
+        speedtest1_bind_int(2, x2);
         speedtest1_run();
-        */
     }
     speedtest1_exec("COMMIT");
     speedtest1_end_test();
@@ -991,29 +1369,18 @@ void testset_main(void) {
     n = sz / 5;
     speedtest1_begin_test(161, "%d SELECTS, numeric BETWEEN, PK", n);
     speedtest1_exec("BEGIN");
-    /*
     speedtest1_prepare(
         "SELECT count(*), avg(b), sum(length(c)), group_concat(a) FROM t2\n"
         " WHERE a BETWEEN ?1 AND ?2; -- %d times", n
     );
-    */
     for (i = 1; i <= n; i++) {
         if ((i - 1) % g.nRepeat == 0) {
             x1 = speedtest1_random() % maxb;
             x2 = speedtest1_random() % 10 + sz / 5000 + x1;
         }
-        if (!wrapper.ExecStatement((
-            "SELECT count(*), avg(b), sum(length(c)), group_concat(a) FROM t2 WHERE a BETWEEN " + std::to_string(x1) + " AND " + std::to_string(x2) + ';'
-            ).c_str()))
-        {
-            printf("fail\n");
-            break;
-        }
-        /*
-        sqlite3_a3d_bind_int(g.pStmt, 1, x1);
-        sqlite3_a3d_bind_int(g.pStmt, 2, x2);
+        speedtest1_bind_int(1, x1);
+        speedtest1_bind_int(2, x2);
         speedtest1_run();
-        */
     }
     speedtest1_exec("COMMIT");
     speedtest1_end_test();
@@ -1022,28 +1389,17 @@ void testset_main(void) {
     n = sz / 5;
     speedtest1_begin_test(170, "%d SELECTS, text BETWEEN, indexed", n);
     speedtest1_exec("BEGIN");
-    /*
     speedtest1_prepare(
         "SELECT count(*), avg(b), sum(length(c)), group_concat(a) FROM t1\n"
         " WHERE c BETWEEN ?1 AND (?1||'~'); -- %d times", n
     );
-    */
     for (i = 1; i <= n; i++) {
         if ((i - 1) % g.nRepeat == 0) {
             x1 = swizzle(i, maxb);
             len = speedtest1_numbername(x1, zNum, sizeof(zNum) - 1);
         }
-        if (!wrapper.ExecStatement((
-            "SELECT count(*), avg(b), sum(length(c)), group_concat(a) FROM t1 WHERE c BETWEEN \"" + std::string(zNum) + "\" AND ( \"" + std::string(zNum) + "\" ||'~');"
-            ).c_str()))
-        {
-            printf("fail\n");
-            break;
-        }
-        /*
-        sqlite3_a3d_bind_text(g.pStmt, 1, zNum, len, SQLITE_STATIC);
+        speedtest1_bind_text(1, zNum, len);
         speedtest1_run();
-        */
     }
     speedtest1_exec("COMMIT");
     speedtest1_end_test();
@@ -1085,26 +1441,15 @@ void testset_main(void) {
     n = sz / 5;
     speedtest1_begin_test(230, "%d UPDATES, numeric BETWEEN, indexed", n);
     speedtest1_exec("BEGIN");
-    /*
     speedtest1_prepare(
         "UPDATE t2 SET d=b*2 WHERE b BETWEEN ?1 AND ?2; -- %d times", n
     );
-    */
     for (i = 1; i <= n; i++) {
         x1 = speedtest1_random() % maxb;
         x2 = speedtest1_random() % 10 + sz / 5000 + x1;
-        if (!wrapper.ExecStatement((
-            "UPDATE t2 SET d=b*2 WHERE b BETWEEN " + std::to_string(x1) + " AND " + std::to_string(x2) + ';'
-            ).c_str()))
-        {
-            printf("fail\n");
-            break;
-        }
-        /*
-        sqlite3_a3d_bind_int(g.pStmt, 1, x1);
-        sqlite3_a3d_bind_int(g.pStmt, 2, x2);
+        speedtest1_bind_int(1, x1);
+        speedtest1_bind_int(2, x2);
         speedtest1_run();
-        */
     }
     speedtest1_exec("COMMIT");
     speedtest1_end_test();
@@ -1112,24 +1457,13 @@ void testset_main(void) {
     n = sz;
     speedtest1_begin_test(240, "%d UPDATES of individual rows", n);
     speedtest1_exec("BEGIN");
-    /*
     speedtest1_prepare(
         "UPDATE t2 SET d=b*3 WHERE a=?1; -- %d times", n
     );
-    */
     for (i = 1; i <= n; i++) {
         x1 = speedtest1_random() % sz + 1;
-        if (!wrapper.ExecStatement((
-            "UPDATE t2 SET d=b*3 WHERE a= " + std::to_string(x1) + ';'
-            ).c_str()))
-        {
-            printf("fail\n");
-            break;
-        }
-        /*
-        sqlite3_a3d_bind_int(g.pStmt, 1, x1);
+        speedtest1_bind_int(1, x1);
         speedtest1_run();
-        */
     }
     speedtest1_exec("COMMIT");
     speedtest1_end_test();
@@ -1148,26 +1482,15 @@ void testset_main(void) {
     n = sz / 5;
     speedtest1_begin_test(270, "%d DELETEs, numeric BETWEEN, indexed", n);
     speedtest1_exec("BEGIN");
-    /*
     speedtest1_prepare(
         "DELETE FROM t2 WHERE b BETWEEN ?1 AND ?2; -- %d times", n
     );
-    */
     for (i = 1; i <= n; i++) {
         x1 = speedtest1_random() % maxb + 1;
         x2 = speedtest1_random() % 10 + sz / 5000 + x1;
-        if (!wrapper.ExecStatement((
-            "DELETE FROM t2 WHERE b BETWEEN " + std::to_string(x1) + " AND " + std::to_string(x2) + ';'
-            ).c_str()))
-        {
-            printf("fail\n");
-            break;
-        }
-        /*
-        sqlite3_a3d_bind_int(g.pStmt, 1, x1);
-        sqlite3_a3d_bind_int(g.pStmt, 2, x2);
+        speedtest1_bind_int(1, x1);
+        speedtest1_bind_int(2, x2);
         speedtest1_run();
-        */
     }
     speedtest1_exec("COMMIT");
     speedtest1_end_test();
@@ -1176,24 +1499,13 @@ void testset_main(void) {
     n = sz;
     speedtest1_begin_test(280, "%d DELETEs of individual rows", n);
     speedtest1_exec("BEGIN");
-    /*
     speedtest1_prepare(
         "DELETE FROM t3 WHERE a=?1; -- %d times", n
     );
-    */
     for (i = 1; i <= n; i++) {
         x1 = speedtest1_random() % sz + 1;
-        if (!wrapper.ExecStatement((
-            "DELETE FROM t3 WHERE a=" + std::to_string(x1) + ';'
-            ).c_str()))
-        {
-            printf("fail\n");
-            break;
-        }
-        /*
-        sqlite3_a3d_bind_int(g.pStmt, 1, x1);
+        speedtest1_bind_int(1, x1);
         speedtest1_run();
-        */
     }
     speedtest1_exec("COMMIT");
     speedtest1_end_test();
@@ -1216,7 +1528,6 @@ void testset_main(void) {
     n = sz / 5;
     speedtest1_begin_test(310, "%d four-ways joins", n);
     speedtest1_exec("BEGIN");
-    /*
     speedtest1_prepare(
         "SELECT t1.c FROM t1, t2, t3, t4\n"
         " WHERE t4.a BETWEEN ?1 AND ?2\n"
@@ -1224,43 +1535,24 @@ void testset_main(void) {
         "   AND t2.a=t3.b\n"
         "   AND t1.c=t2.c"
     );
-    */
     for (i = 1; i <= 100; i++) {
         x1 = speedtest1_random() % sz + 1;
         x2 = speedtest1_random() % 10 + x1 + 4;
-        if (!wrapper.ExecStatement((
-            "SELECT t1.c FROM t1, t2, t3, t4 WHERE t4.a BETWEEN " + std::to_string(x1) + " AND " + std::to_string(x2) + " AND t3.a=t4.b AND t2.a=t3.b AND t1.c=t2.c"
-            ).c_str()))
-        {
-            printf("fail\n");
-            break;
-        }
-        /*
-        sqlite3_a3d_bind_int(g.pStmt, 1, x1);
-        sqlite3_a3d_bind_int(g.pStmt, 2, x2);
+        speedtest1_bind_int(1, x1);
+        speedtest1_bind_int(2, x2);
         speedtest1_run();
-        */
     }
     speedtest1_exec("COMMIT");
     speedtest1_end_test();
 
     speedtest1_begin_test(320, "subquery in result set", n);
-    /*
     speedtest1_prepare(
         "SELECT sum(a), max(c),\n"
         "       avg((SELECT a FROM t2 WHERE 5+t2.b=t1.b) AND rowid<?1), max(c)\n"
         " FROM t1 WHERE rowid<?1;"
     );
-    sqlite3_a3d_bind_int(g.pStmt, 1, est_square_root(g.szTest) * 50);
+    speedtest1_bind_int(1, est_square_root(g.szTest) * 50);
     speedtest1_run();
-    */
-    if (!wrapper.ExecStatement((
-        "SELECT sum(a), max(c), avg((SELECT a FROM t2 WHERE 5+t2.b=t1.b) AND rowid<" + std::to_string(est_square_root(g.szTest)) + "), max(c) FROM t1 WHERE rowid<?1;"
-        ).c_str()))
-    {
-        printf("fail\n");
-        return;
-    }
     speedtest1_end_test();
 
     
@@ -1271,49 +1563,27 @@ void testset_main(void) {
     speedtest1_exec("BEGIN");
     speedtest1_exec("CREATE%s TABLE t5(a INTEGER PRIMARY KEY, b %s);",
         isTemp(9), g.zNN);
-    /*
     speedtest1_prepare(
     "REPLACE INTO t5 VALUES(?1,?2); --  %d times"
     , n);
-    */
     for (i = 1; i <= n; i++) {
         x1 = swizzle(i, maxb);
         speedtest1_numbername(i, zNum, sizeof(zNum));
-        if (!wrapper.ExecStatement((
-            "REPLACE INTO t5 VALUES(" + std::to_string((sqlite3_a3d_int64)x1) + ",\"" + std::string(zNum) + "\");"
-            ).c_str()))
-        {
-            printf("fail\n");
-            break;
-        }
-        /*
-        sqlite3_a3d_bind_int(g.pStmt, 1, (sqlite3_a3d_int64)x1);
-        sqlite3_a3d_bind_text(g.pStmt, 2, zNum, -1, SQLITE_STATIC);
+        speedtest1_bind_int(1, (sqlite3_a3d_int64)x1);
+        speedtest1_bind_text(2, zNum, -1);
         speedtest1_run();
-        */
     }
     speedtest1_exec("COMMIT");
     speedtest1_end_test();
 
     speedtest1_begin_test(410, "%d SELECTS on an IPK", n);
-    /*
     speedtest1_prepare(
         "SELECT b FROM t5 WHERE a=?1; --  %d times"
         , n);
-        */
     for (i = 1; i <= n; i++) {
         x1 = swizzle(i, maxb);
-        if (!wrapper.ExecStatement((
-            "SELECT b FROM t5 WHERE a=" + std::to_string((sqlite3_a3d_int64)x1) + ';'
-            ).c_str()))
-        {
-            printf("fail\n");
-            break;
-        }
-        /*
-        sqlite3_a3d_bind_int(g.pStmt, 1, (sqlite3_a3d_int64)x1);
+        speedtest1_bind_int(1, (sqlite3_a3d_int64)x1);
         speedtest1_run();
-        */
     }
     speedtest1_end_test();
 
@@ -1325,49 +1595,27 @@ void testset_main(void) {
     speedtest1_exec("CREATE%s TABLE t6(a TEXT PRIMARY KEY, b %s)%s;",
         isTemp(9), g.zNN,
         sqlite3_a3d_libversion_number() >= 3008002 ? "WITHOUT ROWID" : "");
-    /*
     speedtest1_prepare(
     "REPLACE INTO t6 VALUES(?1,?2); --  %d times", n);
-    */
     for (i = 1; i <= n; i++) {
         x1 = swizzle(i, maxb);
         speedtest1_numbername(x1, zNum, sizeof(zNum));
-        if (!wrapper.ExecStatement((
-            "REPLACE INTO t6 VALUES(\"" + std::string(zNum) + "\"," + std::to_string(i) + ");"
-            ).c_str()))
-        {
-            printf("fail\n");
-            break;
-        }
-        /*
-        sqlite3_a3d_bind_int(g.pStmt, 2, i);
-        sqlite3_a3d_bind_text(g.pStmt, 1, zNum, -1, SQLITE_STATIC);
+        speedtest1_bind_int(2, i);
+        speedtest1_bind_text(1, zNum, -1);
         speedtest1_run();
-        */
     }
     speedtest1_exec("COMMIT");
     speedtest1_end_test();
 
     speedtest1_begin_test(510, "%d SELECTS on a TEXT PK", n);
-    /*
     speedtest1_prepare(
     "SELECT b FROM t6 WHERE a=?1; --  %d times"
     , n);
-    */
     for (i = 1; i <= n; i++) {
         x1 = swizzle(i, maxb);
         speedtest1_numbername(x1, zNum, sizeof(zNum));
-        if (!wrapper.ExecStatement((
-            "SELECT b FROM t6 WHERE a=\"" + std::string(zNum) + "\";"
-            ).c_str()))
-        {
-            printf("fail\n");
-            break;
-        }
-        /*
-        sqlite3_a3d_bind_text(g.pStmt, 1, zNum, -1, SQLITE_STATIC);
+        speedtest1_bind_text(1, zNum, -1);
         speedtest1_run();
-        */
     }
     speedtest1_end_test();
     speedtest1_begin_test(520, "%d SELECT DISTINCT", n);
@@ -1467,7 +1715,7 @@ void testset_cte(void) {
         "  )\n"
         "SELECT s FROM x WHERE ind=0;"
     );
-    sqlite3_a3d_bind_text(g.pStmt, 1, zPuz, -1, SQLITE_STATIC);
+    speedtest1_bind_text(1, zPuz, -1);
     speedtest1_run();
     speedtest1_end_test();
 
@@ -1497,7 +1745,7 @@ void testset_cte(void) {
         "  )\n"
         "SELECT s FROM x WHERE ind=0;"
     );
-    sqlite3_a3d_bind_text(g.pStmt, 1, zPuz, -1, SQLITE_STATIC);
+    speedtest1_bind_text(1, zPuz, -1);
     speedtest1_run();
     speedtest1_end_test();
 
@@ -1522,8 +1770,8 @@ void testset_cte(void) {
         "  )\n"
         "SELECT group_concat(rtrim(t),x'0a') FROM a;"
     );
-    sqlite3_a3d_bind_double(g.pStmt, 1, rSpacing * .05);
-    sqlite3_a3d_bind_double(g.pStmt, 2, rSpacing);
+    speedtest1_bind_double(1, rSpacing * .05);
+    speedtest1_bind_double(2, rSpacing);
     speedtest1_run();
     speedtest1_end_test();
 
@@ -1573,8 +1821,8 @@ void testset_fp(void) {
     for (i = 1; i <= n; i++) {
         speedtest1_random_ascii_fp(zFP1);
         speedtest1_random_ascii_fp(zFP2);
-        sqlite3_a3d_bind_text(g.pStmt, 1, zFP1, -1, SQLITE_STATIC);
-        sqlite3_a3d_bind_text(g.pStmt, 2, zFP2, -1, SQLITE_STATIC);
+        speedtest1_bind_text(1, zFP1, -1);
+        speedtest1_bind_text(2, zFP2, -1);
         speedtest1_run();
     }
     speedtest1_exec("COMMIT");
@@ -1586,8 +1834,8 @@ void testset_fp(void) {
     for (i = 1; i <= n; i++) {
         speedtest1_random_ascii_fp(zFP1);
         speedtest1_random_ascii_fp(zFP2);
-        sqlite3_a3d_bind_text(g.pStmt, 1, zFP1, -1, SQLITE_STATIC);
-        sqlite3_a3d_bind_text(g.pStmt, 2, zFP2, -1, SQLITE_STATIC);
+        speedtest1_bind_text(1, zFP1, -1);
+        speedtest1_bind_text(2, zFP2, -1);
         speedtest1_run();
     }
     speedtest1_end_test();
@@ -1606,8 +1854,8 @@ void testset_fp(void) {
     for (i = 1; i <= n; i++) {
         speedtest1_random_ascii_fp(zFP1);
         speedtest1_random_ascii_fp(zFP2);
-        sqlite3_a3d_bind_text(g.pStmt, 1, zFP1, -1, SQLITE_STATIC);
-        sqlite3_a3d_bind_text(g.pStmt, 2, zFP2, -1, SQLITE_STATIC);
+        speedtest1_bind_text(1, zFP1, -1);
+        speedtest1_bind_text(2, zFP2, -1);
         speedtest1_run();
     }
     speedtest1_end_test();
@@ -1694,13 +1942,13 @@ void testset_rtree(int p1, int p2) {
         twoCoords(p1, p2, mxCoord, &x0, &x1);
         twoCoords(p1, p2, mxCoord, &y0, &y1);
         twoCoords(p1, p2, mxCoord, &z0, &z1);
-        sqlite3_a3d_bind_int(g.pStmt, 1, i);
-        sqlite3_a3d_bind_int(g.pStmt, 2, x0);
-        sqlite3_a3d_bind_int(g.pStmt, 3, x1);
-        sqlite3_a3d_bind_int(g.pStmt, 4, y0);
-        sqlite3_a3d_bind_int(g.pStmt, 5, y1);
-        sqlite3_a3d_bind_int(g.pStmt, 6, z0);
-        sqlite3_a3d_bind_int(g.pStmt, 7, z1);
+        speedtest1_bind_int(1, i);
+        speedtest1_bind_int(2, x0);
+        speedtest1_bind_int(3, x1);
+        speedtest1_bind_int(4, y0);
+        speedtest1_bind_int(5, y1);
+        speedtest1_bind_int(6, z0);
+        speedtest1_bind_int(7, z1);
         speedtest1_run();
     }
     speedtest1_exec("COMMIT");
@@ -1716,8 +1964,8 @@ void testset_rtree(int p1, int p2) {
     speedtest1_prepare("SELECT count(*) FROM rt1 WHERE x0>=?1 AND x1<=?2");
     iStep = mxCoord / n;
     for (i = 0; i < n; i++) {
-        sqlite3_a3d_bind_int(g.pStmt, 1, i * iStep);
-        sqlite3_a3d_bind_int(g.pStmt, 2, (i + 1) * iStep);
+        speedtest1_bind_int(1, i * iStep);
+        speedtest1_bind_int(2, (i + 1) * iStep);
         speedtest1_run();
         aCheck[i] = atoi(g.zResult);
     }
@@ -1729,8 +1977,8 @@ void testset_rtree(int p1, int p2) {
         speedtest1_prepare("SELECT count(*) FROM t1 WHERE x0>=?1 AND x1<=?2");
         iStep = mxCoord / n;
         for (i = 0; i < n; i++) {
-            sqlite3_a3d_bind_int(g.pStmt, 1, i * iStep);
-            sqlite3_a3d_bind_int(g.pStmt, 2, (i + 1) * iStep);
+            speedtest1_bind_int(1, i * iStep);
+            speedtest1_bind_int(2, (i + 1) * iStep);
             speedtest1_run();
             if (aCheck[i] != atoi(g.zResult)) {
                 fatal_error("Count disagree step %d: %d..%d.  %d vs %d",
@@ -1745,8 +1993,8 @@ void testset_rtree(int p1, int p2) {
     speedtest1_prepare("SELECT count(*) FROM rt1 WHERE y1>=?1 AND y0<=?2");
     iStep = mxCoord / n;
     for (i = 0; i < n; i++) {
-        sqlite3_a3d_bind_int(g.pStmt, 1, i * iStep);
-        sqlite3_a3d_bind_int(g.pStmt, 2, (i + 1) * iStep);
+        speedtest1_bind_int(1, i * iStep);
+        speedtest1_bind_int(2, (i + 1) * iStep);
         speedtest1_run();
         aCheck[i] = atoi(g.zResult);
     }
@@ -1758,8 +2006,8 @@ void testset_rtree(int p1, int p2) {
         speedtest1_prepare("SELECT count(*) FROM t1 WHERE y1>=?1 AND y0<=?2");
         iStep = mxCoord / n;
         for (i = 0; i < n; i++) {
-            sqlite3_a3d_bind_int(g.pStmt, 1, i * iStep);
-            sqlite3_a3d_bind_int(g.pStmt, 2, (i + 1) * iStep);
+            speedtest1_bind_int(1, i * iStep);
+            speedtest1_bind_int(2, (i + 1) * iStep);
             speedtest1_run();
             if (aCheck[i] != atoi(g.zResult)) {
                 fatal_error("Count disagree step %d: %d..%d.  %d vs %d",
@@ -1776,8 +2024,8 @@ void testset_rtree(int p1, int p2) {
     speedtest1_prepare("SELECT count(*) FROM rt1 WHERE id MATCH xslice(?1,?2)");
     iStep = mxCoord / n;
     for (i = 0; i < n; i++) {
-        sqlite3_a3d_bind_int(g.pStmt, 1, i * iStep);
-        sqlite3_a3d_bind_int(g.pStmt, 2, (i + 1) * iStep);
+        speedtest1_bind_int(1, i * iStep);
+        speedtest1_bind_int(2, (i + 1) * iStep);
         speedtest1_run();
         if (aCheck[i] != atoi(g.zResult)) {
             fatal_error("Count disagree step %d: %d..%d.  %d vs %d",
@@ -1792,8 +2040,8 @@ void testset_rtree(int p1, int p2) {
         " AND y1>=?1 AND y0<=?2 AND z1>=?1 AND z0<=?2");
     iStep = mxCoord / n;
     for (i = 0; i < n; i++) {
-        sqlite3_a3d_bind_int(g.pStmt, 1, i * iStep);
-        sqlite3_a3d_bind_int(g.pStmt, 2, (i + 1) * iStep);
+        speedtest1_bind_int(1, i * iStep);
+        speedtest1_bind_int(2, (i + 1) * iStep);
         speedtest1_run();
         aCheck[i] = atoi(g.zResult);
     }
@@ -1803,7 +2051,7 @@ void testset_rtree(int p1, int p2) {
     speedtest1_begin_test(140, "%d rowid queries", n);
     speedtest1_prepare("SELECT * FROM rt1 WHERE id=?1");
     for (i = 1; i <= n; i++) {
-        sqlite3_a3d_bind_int(g.pStmt, 1, i);
+        speedtest1_bind_int(1, i);
         speedtest1_run();
     }
     speedtest1_end_test();
@@ -1812,7 +2060,7 @@ void testset_rtree(int p1, int p2) {
     speedtest1_begin_test(150, "%d UPDATEs using rowid", n);
     speedtest1_prepare("UPDATE rt1 SET x0=x0+100, x1=x1+100 WHERE id=?1");
     for (i = 1; i <= n; i++) {
-        sqlite3_a3d_bind_int(g.pStmt, 1, (i * 251) % mxRowid + 1);
+        speedtest1_bind_int(1, (i * 251) % mxRowid + 1);
         speedtest1_run();
     }
     speedtest1_end_test();
@@ -1823,7 +2071,7 @@ void testset_rtree(int p1, int p2) {
         " WHERE y1>=?1 AND y0<=?1+5");
     iStep = mxCoord / n;
     for (i = 0; i < n; i++) {
-        sqlite3_a3d_bind_int(g.pStmt, 1, i * iStep);
+        speedtest1_bind_int(1, i * iStep);
         speedtest1_run();
         aCheck[i] = atoi(g.zResult);
     }
@@ -1833,7 +2081,7 @@ void testset_rtree(int p1, int p2) {
     speedtest1_begin_test(160, "%d DELETEs using rowid", n);
     speedtest1_prepare("DELETE FROM rt1 WHERE id=?1");
     for (i = 1; i <= n; i++) {
-        sqlite3_a3d_bind_int(g.pStmt, 1, (i * 257) % mxRowid + 1);
+        speedtest1_bind_int(1, (i * 257) % mxRowid + 1);
         speedtest1_run();
     }
     speedtest1_end_test();
@@ -1844,7 +2092,7 @@ void testset_rtree(int p1, int p2) {
     speedtest1_prepare("DELETE FROM rt1 WHERE y1>=?1 AND y0<=?1+5");
     iStep = mxCoord / n;
     for (i = 0; i < n; i++) {
-        sqlite3_a3d_bind_int(g.pStmt, 1, i * iStep);
+        speedtest1_bind_int(1, i * iStep);
         speedtest1_run();
         aCheck[i] = atoi(g.zResult);
     }
@@ -2050,20 +2298,19 @@ void testset_orm(void) {
         x1 = speedtest1_random();
         speedtest1_numbername(x1 % 1000, zNum, sizeof(zNum));
         len = (int)strlen(zNum);
-        sqlite3_a3d_bind_int(g.pStmt, 1, i ^ 0xf);
+        speedtest1_bind_int(1, i ^ 0xf);
         for (j = 0; zType[j]; j++) {
             switch (zType[j]) {
             case 'I':
             case 'T':
-                sqlite3_a3d_bind_int64(g.pStmt, j + 2, x1);
+                speedtest1_bind_int64(j + 2, x1);
                 break;
             case 'F':
-                sqlite3_a3d_bind_double(g.pStmt, j + 2, (double)x1);
+                speedtest1_bind_double(j + 2, (double)x1);
                 break;
             case 'V':
             case 'B':
-                sqlite3_a3d_bind_text64(g.pStmt, j + 2, zNum, len,
-                    SQLITE_STATIC, SQLITE_UTF8);
+                speedtest1_bind_text(j + 2, zNum, (int)len);
                 break;
             }
         }
@@ -2119,7 +2366,7 @@ void testset_orm(void) {
     );
     for (i = 0; i < n; i++) {
         x1 = speedtest1_random() % nRow;
-        sqlite3_a3d_bind_int(g.pStmt, 1, x1);
+        speedtest1_bind_int(1, x1);
         speedtest1_run();
     }
     speedtest1_end_test();
@@ -2148,8 +2395,8 @@ void testset_trigger(void) {
         for (ii = 0; ii < NROW; ii++) {
             int x1 = speedtest1_random() % NROW;
             speedtest1_numbername(x1, zNum, sizeof(zNum));
-            sqlite3_a3d_bind_int(g.pStmt, 1, x1);
-            sqlite3_a3d_bind_text(g.pStmt, 2, zNum, -1, SQLITE_STATIC);
+            speedtest1_bind_int(1, x1);
+            speedtest1_bind_text(2, zNum, -1);
             speedtest1_run();
         }
     }
@@ -2178,7 +2425,7 @@ void testset_trigger(void) {
     for (jj = 1; jj <= 3; jj++) {
         speedtest1_prepare("SELECT * FROM v%d WHERE rowid = ?", jj);
         for (ii = 0; ii < NROW2; ii += 3) {
-            sqlite3_a3d_bind_int(g.pStmt, 1, ii * 3);
+            speedtest1_bind_int(1, ii * 3);
             speedtest1_run();
         }
     }
@@ -2188,7 +2435,7 @@ void testset_trigger(void) {
     for (jj = 1; jj <= 3; jj++) {
         speedtest1_prepare("SELECT * FROM t%d WHERE rowid = ?", jj);
         for (ii = 0; ii < NROW2; ii += 3) {
-            sqlite3_a3d_bind_int(g.pStmt, 1, ii * 3);
+            speedtest1_bind_int(1, ii * 3);
             speedtest1_run();
         }
     }
@@ -2198,7 +2445,7 @@ void testset_trigger(void) {
     for (jj = 1; jj <= 3; jj++) {
         speedtest1_prepare("SELECT * FROM t%d WHERE rowid = ?", jj);
         for (ii = 0; ii < NROW2; ii += 3) {
-            sqlite3_a3d_bind_int(g.pStmt, 1, ii * 3);
+            speedtest1_bind_int(1, ii * 3);
             speedtest1_run();
         }
     }
@@ -2211,7 +2458,7 @@ void testset_trigger(void) {
         "(SELECT t FROM t3 WHERE rowid = ?1)"
     );
     for (jj = 0; jj < NROW2; jj++) {
-        sqlite3_a3d_bind_int(g.pStmt, 1, jj * 3);
+        speedtest1_bind_int(1, jj * 3);
         speedtest1_run();
     }
     speedtest1_end_test();
@@ -2220,7 +2467,7 @@ void testset_trigger(void) {
     speedtest1_exec("BEGIN");
     speedtest1_prepare("UPDATE t1 SET i=i+1 WHERE rowid=?1");
     for (jj = 0; jj < NROW2; jj++) {
-        sqlite3_a3d_bind_int(g.pStmt, 1, jj);
+        speedtest1_bind_int(1, jj);
         speedtest1_run();
     }
     speedtest1_exec("COMMIT");
@@ -2250,8 +2497,8 @@ void testset_trigger(void) {
     speedtest1_prepare("INSERT INTO t4 VALUES(NULL, ?1, ?2)");
     for (jj = 0; jj < NROW2; jj++) {
         speedtest1_numbername(jj, zNum, sizeof(zNum));
-        sqlite3_a3d_bind_int(g.pStmt, 1, jj);
-        sqlite3_a3d_bind_text(g.pStmt, 2, zNum, -1, SQLITE_STATIC);
+        speedtest1_bind_int(1, jj);
+        speedtest1_bind_text(2, zNum, -1);
         speedtest1_run();
     }
     speedtest1_end_test();
@@ -2265,9 +2512,9 @@ void testset_trigger(void) {
     speedtest1_prepare("UPDATE t4 SET i = ?1, t = ?2 WHERE rowid = ?3");
     for (jj = 1; jj <= NROW2 * 2; jj += 2) {
         speedtest1_numbername(jj * 2, zNum, sizeof(zNum));
-        sqlite3_a3d_bind_int(g.pStmt, 1, jj * 2);
-        sqlite3_a3d_bind_text(g.pStmt, 2, zNum, -1, SQLITE_STATIC);
-        sqlite3_a3d_bind_int(g.pStmt, 3, jj);
+        speedtest1_bind_int(1, jj * 2);
+        speedtest1_bind_text(2, zNum, -1);
+        speedtest1_bind_int(3, jj);
         speedtest1_run();
     }
     speedtest1_end_test();
@@ -2278,7 +2525,7 @@ void testset_trigger(void) {
     speedtest1_begin_test(200, "speed4p-trigger3");
     speedtest1_prepare("DELETE FROM t4 WHERE rowid = ?1");
     for (jj = 1; jj <= NROW2 * 2; jj += 2) {
-        sqlite3_a3d_bind_int(g.pStmt, 1, jj * 2);
+        speedtest1_bind_int(1, jj * 2);
         speedtest1_run();
     }
     speedtest1_end_test();
@@ -2301,8 +2548,8 @@ void testset_trigger(void) {
     speedtest1_prepare("INSERT INTO t4 VALUES(NULL, ?1, ?2)");
     for (jj = 0; jj < NROW2; jj++) {
         speedtest1_numbername(jj, zNum, sizeof(zNum));
-        sqlite3_a3d_bind_int(g.pStmt, 1, jj);
-        sqlite3_a3d_bind_text(g.pStmt, 2, zNum, -1, SQLITE_STATIC);
+        speedtest1_bind_int(1, jj);
+        speedtest1_bind_text(2, zNum, -1);
         speedtest1_run();
     }
     speedtest1_end_test();
@@ -2310,16 +2557,16 @@ void testset_trigger(void) {
     speedtest1_prepare("UPDATE t4 SET i = ?1, t = ?2 WHERE rowid = ?3");
     for (jj = 1; jj <= NROW2 * 2; jj += 2) {
         speedtest1_numbername(jj * 2, zNum, sizeof(zNum));
-        sqlite3_a3d_bind_int(g.pStmt, 1, jj * 2);
-        sqlite3_a3d_bind_text(g.pStmt, 2, zNum, -1, SQLITE_STATIC);
-        sqlite3_a3d_bind_int(g.pStmt, 3, jj);
+        speedtest1_bind_int(1, jj * 2);
+        speedtest1_bind_text(2, zNum, -1);
+        speedtest1_bind_int(3, jj);
         speedtest1_run();
     }
     speedtest1_end_test();
     speedtest1_begin_test(220, "speed4p-notrigger3");
     speedtest1_prepare("DELETE FROM t4 WHERE rowid = ?1");
     for (jj = 1; jj <= NROW2 * 2; jj += 2) {
-        sqlite3_a3d_bind_int(g.pStmt, 1, jj * 2);
+        speedtest1_bind_int(1, jj * 2);
         speedtest1_run();
     }
     speedtest1_end_test();
@@ -2343,6 +2590,440 @@ void testset_debug1(void) {
     }
 }
 
+/*
+** Latencies measured by one thread of the clients testset, in nanoseconds.
+*/
+struct ClientStats {
+    std::vector<sqlite3_a3d_int64> aRead;   /* Latency of each read */
+    std::vector<sqlite3_a3d_int64> aWrite;  /* Latency of each write */
+    sqlite3_a3d_int64 iElapse;              /* Total run time of the thread */
+    int nFail;                              /* Number of failed operations */
+};
+
+/* Return the P-th quantile of sorted latencies, in milliseconds */
+static double clientQuantile(std::vector<sqlite3_a3d_int64> const& a, double p) {
+    size_t i;
+    if (a.empty()) return 0.0;
+    i = (size_t)(p * (double)a.size());
+    if (i >= a.size()) i = a.size() - 1;
+    return (double)a[i] / 1e6;
+}
+
+static void clientReport(const char* zName, std::vector<sqlite3_a3d_int64>& a,
+    sqlite3_a3d_int64 iElapse) {
+    std::sort(a.begin(), a.end());
+    printf("-- %-10s %8d ops %10.0f ops/s  p50 %8.3fms  p99 %8.3fms  p999 %8.3fms\n",
+        zName, (int)a.size(),
+        iElapse > 0 ? (double)a.size() * 1e9 / (double)iElapse : 0.0,
+        clientQuantile(a, 0.50), clientQuantile(a, 0.99), clientQuantile(a, 0.999));
+}
+
+/*
+** Workload of one thread of the clients testset: point reads and updates on
+** random keys of table clients, through the shared wrapper.
+*/
+static void clientRun(A3D::SqliteWrapper* pDb, int iClient, int nOp, int sz,
+    ClientStats* pStats) {
+    A3D::SqliteStatement readStmt;
+    A3D::SqliteStatement writeStmt;
+    unsigned int x = 0x9e3779b9u * (unsigned int)(iClient + 1);
+    std::chrono::steady_clock::time_point iBegin, iStart;
+    int i, rc, nUpdated;
+
+    if (!pDb->Prepare("SELECT v, t FROM clients WHERE k=?1", readStmt)
+        || !pDb->Prepare("UPDATE clients SET v=v+1 WHERE k=?1", writeStmt)) {
+        pStats->nFail = nOp;
+        return;
+    }
+    iBegin = std::chrono::steady_clock::now();
+    for (i = 0; i < nOp; i++) {
+        bool ok;
+        int bRead;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        bRead = (int)((x >> 8) % 100) < g.pctReads;
+        iStart = std::chrono::steady_clock::now();
+        if (bRead) {
+            readStmt.BindInt(1, (int)(x % (unsigned int)sz) + 1);
+            ok = readStmt.ForEachRow(rc, [](A3D::SqliteRow const& row) {
+                return row.GetInt64(0) >= 0 && row.GetText(1).size() > 0;
+            });
+        }
+        else {
+            writeStmt.BindInt(1, (int)(x % (unsigned int)sz) + 1);
+            ok = writeStmt.Step(rc, &nUpdated);
+            writeStmt.Reset();
+        }
+        (bRead ? pStats->aRead : pStats->aWrite).push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - iStart).count());
+        if (!ok) pStats->nFail++;
+    }
+    pStats->iElapse = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - iBegin).count();
+}
+
+/*
+** Same workload as clientRun(), each operation leasing a reader or the
+** writer of the pool, so that reads run in parallel on their own connection.
+*/
+static void clientRunPool(A3D::SqliteConnectionPool* pPool, int iClient, int nOp, int sz,
+    ClientStats* pStats) {
+    A3D::SqliteResultArena results;
+    unsigned int x = 0x9e3779b9u * (unsigned int)(iClient + 1);
+    std::chrono::steady_clock::time_point iBegin, iStart;
+    int i, rc;
+
+    iBegin = std::chrono::steady_clock::now();
+    for (i = 0; i < nOp; i++) {
+        bool ok;
+        int bRead;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        bRead = (int)((x >> 8) % 100) < g.pctReads;
+        iStart = std::chrono::steady_clock::now();
+        {
+            A3D::SqliteConnectionLease lease = bRead ? pPool->AcquireReader() : pPool->AcquireWriter();
+            ok = lease.IsValid() && lease->ExecCachedStatement(
+                bRead ? "SELECT v, t FROM clients WHERE k=?1" : "UPDATE clients SET v=v+1 WHERE k=?1",
+                rc, results, { A3D::SqliteValue((int)(x % (unsigned int)sz) + 1) });
+            if (ok && bRead) ok = results.GetRowCount() == 1 && results.GetText(0, 1).size() > 0;
+        }
+        (bRead ? pStats->aRead : pStats->aWrite).push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - iStart).count());
+        if (!ok) pStats->nFail++;
+    }
+    pStats->iElapse = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - iBegin).count();
+}
+
+/*
+** Show the latencies of each client of a run, then of all the reads and
+** all the writes.
+*/
+static void clientSummary(std::vector<ClientStats>& aStats) {
+    std::vector<sqlite3_a3d_int64> aAllRead, aAllWrite;
+    sqlite3_a3d_int64 iElapse = 0;
+    int nFail = 0;
+    size_t i;
+
+    for (i = 0; i < aStats.size(); i++) {
+        ClientStats& s = aStats[i];
+        std::vector<sqlite3_a3d_int64> aAll(s.aRead);
+        char zName[32];
+        aAll.insert(aAll.end(), s.aWrite.begin(), s.aWrite.end());
+        sqlite3_a3d_snprintf(sizeof(zName), zName, "client %d", (int)i);
+        clientReport(zName, aAll, s.iElapse);
+        aAllRead.insert(aAllRead.end(), s.aRead.begin(), s.aRead.end());
+        aAllWrite.insert(aAllWrite.end(), s.aWrite.begin(), s.aWrite.end());
+        if (s.iElapse > iElapse) iElapse = s.iElapse;
+        nFail += s.nFail;
+        g.nStatement += (sqlite3_a3d_int64)(s.aRead.size() + s.aWrite.size());
+    }
+    clientReport("reads", aAllRead, iElapse);
+    clientReport("writes", aAllWrite, iElapse);
+    if (nFail) printf("-- %d operations failed\n", nFail);
+}
+
+/*
+** A testset for concurrency: N threads share the SqliteWrapper of the
+** other testsets and run a mix of point reads and single row updates,
+** whatever the --backend. With --clients-pool, the same mix runs again
+** through a SqliteConnectionPool of one reader per thread.
+*/
+void testset_clients(void) {
+    int i;                        /* Loop counter */
+    int n;                        /* Operations per client */
+    int sz;                       /* Size of the table */
+    int nClient;                  /* Number of threads */
+    char zNum[2000];              /* A number name */
+    std::vector<ClientStats> aStats;
+    std::vector<std::thread> aThread;
+
+    A3D::SqliteWrapper& db = *g.pWrapper;
+    nClient = g.nClients > 0 ? g.nClients : 1;
+    sz = g.szTest * 100;
+    n = g.szTest * 10;
+
+    speedtest1_begin_test(1000, "%d rows for %d clients", sz, nClient);
+    db.ExecStatement("DROP TABLE IF EXISTS clients");
+    db.ExecStatement("CREATE TABLE clients(k INTEGER PRIMARY KEY, v INTEGER, t TEXT)");
+    {
+        A3D::SqliteWriteBatch batch(db, 10000);
+        for (i = 1; i <= sz; i++) {
+            speedtest1_numbername(i, zNum, sizeof(zNum));
+            batch.Add("INSERT INTO clients VALUES(?1,?2,?3)",
+                { A3D::SqliteValue(i), A3D::SqliteValue(0), A3D::SqliteValue(std::string(zNum)) });
+        }
+        if (!batch.Flush()) fatal_error("SQL error: %s\n", db.LastErrorMessage().c_str());
+    }
+    speedtest1_end_test();
+
+    speedtest1_begin_test(1010, "%d operations from %d clients, %d%% reads",
+        n * nClient, nClient, g.pctReads);
+    aStats.resize(nClient);
+    for (i = 0; i < nClient; i++) {
+        aThread.emplace_back(clientRun, &db, i, n, sz, &aStats[i]);
+    }
+    for (i = 0; i < nClient; i++) {
+        aThread[i].join();
+    }
+    speedtest1_end_test();
+    clientSummary(aStats);
+
+    if (g.bClientsPool) {
+        const char* zDb = sqlite3_a3d_db_filename(db.GetHandle(), "main");
+        A3D::SqliteConnectionPool pool(zDb, (size_t)nClient);
+        if (!pool.IsReady()) fatal_error("--clients-pool: cannot open the pool on %s\n", zDb);
+
+        speedtest1_begin_test(1020, "%d operations from %d clients, %d readers in a pool",
+            n * nClient, nClient, nClient);
+        aStats.clear();
+        aStats.resize(nClient);
+        aThread.clear();
+        for (i = 0; i < nClient; i++) {
+            aThread.emplace_back(clientRunPool, &pool, i, n, sz, &aStats[i]);
+        }
+        for (i = 0; i < nClient; i++) {
+            aThread[i].join();
+        }
+        speedtest1_end_test();
+        clientSummary(aStats);
+    }
+}
+
+/*
+** Size of a file, 0 if it cannot be opened.
+*/
+static sqlite3_a3d_int64 speedtest1_file_size(const char* zFile) {
+    sqlite3_a3d_int64 sz = 0;
+    FILE* f = fopen(zFile, "rb");
+    if (f) {
+        fseek(f, 0, SEEK_END);
+        sz = ftell(f);
+        fclose(f);
+    }
+    return sz;
+}
+
+/*
+** Export a table to CSV and TSV files next to the database and import them
+** back through the wrapper, checking the copies with --verify.
+*/
+void testset_csv(void) {
+    int n;                        /* Rows of the table */
+    size_t nRow = 0;              /* Rows exported or imported */
+    int rc;                       /* Return code of the wrapper */
+    const char* zDb;              /* Path of the database */
+    std::string zCsv, zTsv;       /* Files next to it */
+    A3D::SqliteDelimitedTextOptions csv, tsv;
+
+    A3D::SqliteWrapper& db = *g.pWrapper;
+    zDb = sqlite3_a3d_db_filename(g.db, "main");
+    zCsv = std::string(zDb && zDb[0] ? zDb : "speedtest1") + "-export.csv";
+    zTsv = std::string(zDb && zDb[0] ? zDb : "speedtest1") + "-export.tsv";
+    tsv.delimiter = '\t';
+    n = g.szTest * 5000;
+
+    speedtest1_begin_test(1100, "Fill %d rows with numbers, text and quotes", n);
+    speedtest1_exec(
+        "CREATE TABLE csv1(a INTEGER PRIMARY KEY, b INTEGER, c REAL, d TEXT, e TEXT);"
+        "WITH RECURSIVE s(i) AS (VALUES(1) UNION ALL SELECT i+1 FROM s WHERE i<%d)"
+        " INSERT INTO csv1 SELECT i, (i*7919)%%100003, i*0.25,"
+        " 'item \"' || i || '\", size ' || (i%%97),"
+        " CASE i%%10 WHEN 0 THEN NULL WHEN 5 THEN '' ELSE hex(randomblob(12)) END FROM s", n);
+    speedtest1_end_test();
+
+    speedtest1_begin_test(1110, "Export %d rows to CSV", n);
+    if (!db.ExportDelimitedText("SELECT * FROM csv1", zCsv.c_str(), rc, csv, &nRow)) {
+        fatal_error("CSV export error: %d\n", rc);
+    }
+    g.nTestRow = (sqlite3_a3d_int64)nRow;
+    g.nTestByte = speedtest1_file_size(zCsv.c_str());
+    speedtest1_end_test();
+
+    speedtest1_begin_test(1120, "Import %d rows from CSV into a new table", n);
+    csv.emptyIsNull = 1;
+    if (!db.ImportDelimitedText(zCsv.c_str(), "csv2", rc, csv, &nRow)) {
+        fatal_error("CSV import error: %d\n", rc);
+    }
+    g.nTestRow = (sqlite3_a3d_int64)nRow;
+    g.nTestByte = speedtest1_file_size(zCsv.c_str());
+    speedtest1_end_test();
+
+    speedtest1_begin_test(1130, "Export %d rows to TSV", n);
+    if (!db.ExportDelimitedText("SELECT * FROM csv1", zTsv.c_str(), rc, tsv, &nRow)) {
+        fatal_error("TSV export error: %d\n", rc);
+    }
+    g.nTestRow = (sqlite3_a3d_int64)nRow;
+    g.nTestByte = speedtest1_file_size(zTsv.c_str());
+    speedtest1_end_test();
+
+    speedtest1_begin_test(1140, "Import %d rows from TSV into an indexed table", n);
+    speedtest1_exec(
+        "CREATE TABLE csv3(a INTEGER PRIMARY KEY, b INTEGER, c REAL, d TEXT, e TEXT);"
+        "CREATE INDEX csv3b ON csv3(b);"
+        "CREATE INDEX csv3d ON csv3(d)");
+    tsv.emptyIsNull = 1;
+    if (!db.ImportDelimitedText(zTsv.c_str(), "csv3", rc, tsv, &nRow)) {
+        fatal_error("TSV import error: %d\n", rc);
+    }
+    g.nTestRow = (sqlite3_a3d_int64)nRow;
+    g.nTestByte = speedtest1_file_size(zTsv.c_str());
+    speedtest1_end_test();
+
+    if (g.bVerify) {
+        char* zCsvMatch;
+        char* zTsvMatch;
+        speedtest1_begin_test(1150, "Verify the imported tables");
+        /* csv2 has TEXT columns, compared as numbers through the affinity of csv1 */
+        zCsvMatch = speedtest1_once("SELECT count(*) FROM csv1 JOIN csv2 USING(a)"
+            " WHERE csv1.b==csv2.b AND csv1.c==csv2.c AND csv1.d==csv2.d"
+            " AND csv1.e IS csv2.e");
+        zTsvMatch = speedtest1_once("SELECT count(*) FROM csv1 JOIN csv3 USING(a,b,c,d)"
+            " WHERE csv1.e IS csv3.e");
+        if (zCsvMatch == 0 || zTsvMatch == 0 || atoi(zCsvMatch) != n || atoi(zTsvMatch) != n) {
+            fatal_error("imported rows differ: %s and %s match out of %d\n",
+                zCsvMatch ? zCsvMatch : "none", zTsvMatch ? zTsvMatch : "none", n);
+        }
+        sqlite3_a3d_free(zCsvMatch);
+        sqlite3_a3d_free(zTsvMatch);
+        speedtest1_end_test();
+    }
+
+    speedtest1_begin_test(1190, "DROP the CSV tables");
+    speedtest1_exec("DROP TABLE csv1; DROP TABLE csv2; DROP TABLE csv3");
+    speedtest1_end_test();
+    remove(zCsv.c_str());
+    remove(zTsv.c_str());
+}
+
+/*
+** Counts the asynchronous queries of the async testset until they are all
+** completed.
+*/
+struct AsyncLatch {
+    std::mutex mutex;
+    std::condition_variable done;
+    int nPending;                 /* Queries not completed yet */
+    int nFail;                    /* Queries not returning exactly one row */
+    sqlite3_a3d_int64 nRow;       /* Rows returned */
+};
+
+static void asyncLatch_complete(AsyncLatch* p, A3D::SqliteQueryResult const& result) {
+    size_t nRow = result.results.empty() ? 0 : result.results[0].size();
+    std::lock_guard<std::mutex> lock(p->mutex);
+    if (!result.succeeded || nRow != 1) p->nFail++;
+    p->nRow += (sqlite3_a3d_int64)nRow;
+    /* Notified under the lock: the waiter cannot destroy the latch before */
+    if (--p->nPending == 0) p->done.notify_all();
+}
+
+static void asyncLatch_wait(AsyncLatch* p) {
+    std::unique_lock<std::mutex> lock(p->mutex);
+    p->done.wait(lock, [p]() { return p->nPending == 0; });
+}
+
+#ifdef A3D_SQLITE_COROUTINES
+/*
+** A coroutine started at once and never awaited, destroyed at its end.
+*/
+struct AsyncLookupTask {
+    struct promise_type {
+        AsyncLookupTask get_return_object() { return AsyncLookupTask(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { abort(); }
+    };
+};
+
+/*
+** Look up the keys of lookups iFirst, iFirst+nStep, ... one after the other.
+*/
+static AsyncLookupTask asyncLookups(A3D::SqliteWrapper* pDb, int iFirst, int nStep,
+    int n, int sz, AsyncLatch* pLatch) {
+    int i;
+    for (i = iFirst; i < n; i += nStep) {
+        std::vector<A3D::SqliteValue> aValue(1, A3D::SqliteValue((int)(((sqlite3_a3d_int64)i * 7919) % sz) + 1));
+        A3D::SqliteQueryResult result = co_await pDb->Query("SELECT v FROM async WHERE k=?1", std::move(aValue));
+        asyncLatch_complete(pLatch, result);
+    }
+}
+#endif
+
+/*
+** A testset for the asynchronous queries of the wrapper: point reads run by
+** the threads of its executor, with callbacks and, when the compiler has C++20
+** coroutines, from coroutines awaiting each query.
+*/
+void testset_async(void) {
+    int i;                        /* Loop counter */
+    int n;                        /* Number of lookups */
+    int sz;                       /* Size of the table */
+    char zNum[2000];              /* A number name */
+    A3D::SqliteWrapper& db = *g.pWrapper;
+    sz = g.szTest * 100;
+    n = g.szTest * 500;
+
+    speedtest1_begin_test(1200, "%d rows for asynchronous lookups", sz);
+    db.ExecStatement("DROP TABLE IF EXISTS async");
+    db.ExecStatement("CREATE TABLE async(k INTEGER PRIMARY KEY, v TEXT)");
+    {
+        A3D::SqliteWriteBatch batch(db, 10000);
+        for (i = 1; i <= sz; i++) {
+            speedtest1_numbername(i, zNum, sizeof(zNum));
+            batch.Add("INSERT INTO async VALUES(?1,?2)",
+                { A3D::SqliteValue(i), A3D::SqliteValue(std::string(zNum)) });
+        }
+        if (!batch.Flush()) fatal_error("SQL error: %s\n", db.LastErrorMessage().c_str());
+    }
+    speedtest1_end_test();
+
+    speedtest1_begin_test(1210, "%d lookups with QueryAsync(), all in flight", n);
+    {
+        AsyncLatch latch;
+        latch.nPending = n;
+        latch.nFail = 0;
+        latch.nRow = 0;
+        for (i = 0; i < n; i++) {
+            std::vector<A3D::SqliteValue> aValue(1, A3D::SqliteValue((int)(((sqlite3_a3d_int64)i * 7919) % sz) + 1));
+            db.QueryAsync("SELECT v FROM async WHERE k=?1", std::move(aValue),
+                [&latch](A3D::SqliteQueryResult&& result) { asyncLatch_complete(&latch, result); });
+        }
+        asyncLatch_wait(&latch);
+        if (latch.nFail) fatal_error("%d asynchronous lookups failed\n", latch.nFail);
+        g.nTestRow = latch.nRow;
+        g.nStatement += n;
+    }
+    speedtest1_end_test();
+
+#ifdef A3D_SQLITE_COROUTINES
+    speedtest1_begin_test(1220, "%d lookups with co_await Query(), 16 coroutines", n);
+    {
+        AsyncLatch latch;
+        latch.nPending = n;
+        latch.nFail = 0;
+        latch.nRow = 0;
+        for (i = 0; i < 16; i++) {
+            asyncLookups(&db, i, 16, n, sz, &latch);
+        }
+        asyncLatch_wait(&latch);
+        if (latch.nFail) fatal_error("%d awaited lookups failed\n", latch.nFail);
+        g.nTestRow = latch.nRow;
+        g.nStatement += n;
+    }
+    speedtest1_end_test();
+#endif
+
+    speedtest1_begin_test(1290, "DROP the table of the asynchronous lookups");
+    speedtest1_exec("DROP TABLE async");
+    speedtest1_end_test();
+}
+
 #ifdef __linux__
 #include <sys/types.h>
 #include <unistd.h>
@@ -2391,6 +3072,275 @@ static int xCompileOptions(void* pCtx, int nVal, char** azVal, char** azCol) {
     return SQLITE_OK;
 }
 
+/* One test read back from a --json or --csv file by --compare */
+struct ReportTest {
+    std::string zTestSet;
+    int iTestNum;
+    std::string zName;
+    sqlite3_a3d_int64 iMs;
+};
+
+/* Read a quoted field of a report line starting at z.  Return the end of the field. */
+static const char* reportQuoted(const char* z, std::string& out) {
+    out.clear();
+    if (*z != '"') return z;
+    for (z++; *z; z++) {
+        if (z[0] == '"' && z[1] == '"') {
+            out += '"';
+            z++;
+        }
+        else if (z[0] == '\\' && z[1] != 0) {
+            out += z[1];
+            z++;
+        }
+        else if (z[0] == '"') {
+            return z + 1;
+        }
+        else {
+            out += z[0];
+        }
+    }
+    return z;
+}
+
+/* Find the value of a field of a JSON line written by speedtest1_report_test() */
+static const char* reportJsonField(const char* zLine, const char* zField) {
+    char zKey[40];
+    const char* z;
+    sqlite3_a3d_snprintf(sizeof(zKey), zKey, "\"%s\": ", zField);
+    z = strstr(zLine, zKey);
+    return z ? z + strlen(zKey) : 0;
+}
+
+/* Load the tests of a --json or --csv file */
+static int reportLoad(const char* zFile, std::vector<ReportTest>& aTest) {
+    FILE* in = fopen(zFile, "rb");
+    char zLine[1000];
+    if (in == 0) {
+        fprintf(stderr, "cannot open \"%s\"\n", zFile);
+        return 0;
+    }
+    while (fgets(zLine, sizeof(zLine), in) != 0) {
+        ReportTest t;
+        const char* z;
+        if (strstr(zLine, "{\"testset\": ") != 0) {
+            const char* zSet = reportJsonField(zLine, "testset");
+            const char* zTest = reportJsonField(zLine, "test");
+            const char* zName = reportJsonField(zLine, "name");
+            const char* zMs = reportJsonField(zLine, "ms");
+            if (zSet == 0 || zTest == 0 || zName == 0 || zMs == 0) continue;
+            reportQuoted(zSet, t.zTestSet);
+            reportQuoted(zName, t.zName);
+            t.iTestNum = atoi(zTest);
+            t.iMs = strtoll(zMs, 0, 10);
+        }
+        else if (zLine[0] == '"') {
+            z = reportQuoted(zLine, t.zTestSet);
+            if (*z++ != ',') continue;
+            t.iTestNum = atoi(z);
+            z = strchr(z, ',');
+            if (z == 0) continue;
+            z = reportQuoted(z + 1, t.zName);
+            if (*z++ != ',') continue;
+            t.iMs = strtoll(z, 0, 10);
+        }
+        else {
+            continue;
+        }
+        aTest.push_back(t);
+    }
+    fclose(in);
+    return 1;
+}
+
+/*
+** Compare the tests of two --json or --csv files and show the change of the
+** time of each one.  A test that is slower by more than pctThreshold percent
+** is a regression.  Return the exit code of the program: 1 if any regression
+** was found, 2 if a file cannot be read, 0 otherwise.
+*/
+static int speedtest1_compare(const char* zBase, const char* zNew, int pctThreshold) {
+    std::vector<ReportTest> aBase, aNew;
+    sqlite3_a3d_int64 iBaseTotal = 0, iNewTotal = 0;
+    int nRegression = 0;
+    size_t i, j;
+    if (!reportLoad(zBase, aBase) || !reportLoad(zNew, aNew)) return 2;
+    printf("-- %-10s %4s %-40s %9s %9s %8s\n", "testset", "test", "name",
+        "base ms", "new ms", "change");
+    for (i = 0; i < aNew.size(); i++) {
+        ReportTest const& t = aNew[i];
+        for (j = 0; j < aBase.size(); j++) {
+            if (aBase[j].iTestNum == t.iTestNum && aBase[j].zTestSet == t.zTestSet) break;
+        }
+        if (j == aBase.size()) {
+            printf("   %-10s %4d %-40.40s %9s %9lld %8s\n", t.zTestSet.c_str(),
+                t.iTestNum, t.zName.c_str(), "-", t.iMs, "new");
+            continue;
+        }
+        iBaseTotal += aBase[j].iMs;
+        iNewTotal += t.iMs;
+        /* Tests of less than 1ms only measure the noise of the timer */
+        double rChange = aBase[j].iMs > 0 ? 100.0 * (t.iMs - aBase[j].iMs) / aBase[j].iMs : 0.0;
+        int isRegression = rChange > pctThreshold && t.iMs - aBase[j].iMs > 1;
+        printf("   %-10s %4d %-40.40s %9lld %9lld %+7.1f%%%s\n", t.zTestSet.c_str(),
+            t.iTestNum, t.zName.c_str(), aBase[j].iMs, t.iMs, rChange,
+            isRegression ? "  REGRESSION" : "");
+        nRegression += isRegression;
+    }
+    printf("-- TOTAL %9lld ms -> %lld ms, %d regression(s) beyond %d%%\n",
+        iBaseTotal, iNewTotal, nRegression, pctThreshold);
+    return nRegression ? 1 : 0;
+}
+
+/* Drop all the tables, between two testsets */
+static void speedtest1_reset_database(void) {
+    char* zSql, * zObj;
+    speedtest1_begin_test(999, "Reset the database");
+    while (1) {
+        zObj = speedtest1_once(
+            "SELECT name FROM main.sqlite_master"
+            " WHERE sql LIKE 'CREATE %%TABLE%%'");
+        if (zObj == 0) break;
+        zSql = sqlite3_a3d_mprintf("DROP TABLE main.\"%w\"", zObj);
+        speedtest1_exec(zSql);
+        sqlite3_a3d_free(zSql);
+        sqlite3_a3d_free(zObj);
+    }
+    while (1) {
+        zObj = speedtest1_once(
+            "SELECT name FROM temp.sqlite_master"
+            " WHERE sql LIKE 'CREATE %%TABLE%%'");
+        if (zObj == 0) break;
+        zSql = sqlite3_a3d_mprintf("DROP TABLE main.\"%w\"", zObj);
+        speedtest1_exec(zSql);
+        sqlite3_a3d_free(zSql);
+        sqlite3_a3d_free(zObj);
+    }
+    speedtest1_end_test();
+}
+
+/* Run a comma-separated list of testsets */
+static void speedtest1_testsets(const char* zTSetList) {
+    char* zList = sqlite3_a3d_mprintf("%s", zTSetList);
+    char* zTSet = zList;
+    do {
+        char* zThisTest = zTSet;
+        char* zComma = strchr(zThisTest, ',');
+        g.zTestSet = zThisTest;
+        if (zComma) {
+            *zComma = 0;
+            zTSet = zComma + 1;
+        }
+        else {
+            zTSet = "";
+        }
+        if (g.iTotal > 0 || zComma != 0) {
+            printf("       Begin testset \"%s\"\n", zThisTest);
+        }
+        if (strcmp(zThisTest, "main") == 0) {
+            testset_main();
+        }
+        else if (strcmp(zThisTest, "debug1") == 0) {
+            testset_debug1();
+        }
+        else if (strcmp(zThisTest, "orm") == 0) {
+            testset_orm();
+        }
+        else if (strcmp(zThisTest, "cte") == 0) {
+            testset_cte();
+        }
+        else if (strcmp(zThisTest, "fp") == 0) {
+            testset_fp();
+        }
+        else if (strcmp(zThisTest, "trigger") == 0) {
+            testset_trigger();
+        }
+        else if (strcmp(zThisTest, "clients") == 0) {
+            testset_clients();
+        }
+        else if (strcmp(zThisTest, "async") == 0) {
+            testset_async();
+        }
+        else if (strcmp(zThisTest, "csv") == 0) {
+            testset_csv();
+        }
+        else if (strcmp(zThisTest, "rtree") == 0) {
+#ifdef SQLITE_ENABLE_RTREE
+            testset_rtree(6, 147);
+#else
+            fatal_error("compile with -DSQLITE_ENABLE_RTREE to enable "
+                "the R-Tree tests\n");
+#endif
+        }
+        else {
+            fatal_error("unknown testset: \"%s\"\n"
+                "Choices: async clients csv cte debug1 fp main orm rtree trigger\n",
+                zThisTest);
+        }
+        if (zTSet[0]) speedtest1_reset_database();
+    } while (zTSet[0]);
+    g.zTestSet = "";
+    sqlite3_a3d_free(zList);
+}
+
+/* Measures of one point of --sweep */
+struct SweepPoint {
+    int szTest;                /* --size of the point */
+    int nClients;              /* --clients of the point */
+    sqlite3_a3d_int64 iMs;         /* Time of its tests */
+    sqlite3_a3d_int64 nStatement;  /* Statements they ran */
+    int nHit, nMiss;           /* Page cache hits and misses of the connection */
+};
+
+/* Run the testsets at each size from mnSize to mxSize and each number of
+** clients from mnClient to mxClient, doubling each time, then show the
+** throughput and page cache hit ratio of each point.  A bound of 0 keeps
+** the value of --size or --clients. */
+static void speedtest1_sweep(const char* zTSet, int mnSize, int mxSize, int mnClient, int mxClient) {
+    std::vector<SweepPoint> aPoint;
+    int sz, nClient, iCur, iHi;
+    size_t i;
+    if (mnSize <= 0) mnSize = mxSize = g.szTest;
+    if (mnClient <= 0) mnClient = mxClient = g.nClients > 0 ? g.nClients : 1;
+    for (sz = mnSize; sz <= mxSize; sz *= 2) {
+        for (nClient = mnClient; nClient <= mxClient; nClient *= 2) {
+            SweepPoint p;
+            sqlite3* db;
+            if (!aPoint.empty()) speedtest1_reset_database();
+            printf("       Sweep size %d, %d client(s)\n", sz, nClient);
+            g.szTest = sz;
+            g.nClients = nClient;
+            p.szTest = sz;
+            p.nClients = nClient;
+            p.iMs = g.iTotal;
+            p.nStatement = g.nStatement;
+            /* Each point starts from an empty cache, its counters reset */
+            db = g.pWrapper->GetHandle();
+            sqlite3_a3d_db_release_memory(db);
+            sqlite3_a3d_db_status(db, SQLITE_DBSTATUS_CACHE_HIT, &iCur, &iHi, 1);
+            sqlite3_a3d_db_status(db, SQLITE_DBSTATUS_CACHE_MISS, &iCur, &iHi, 1);
+            speedtest1_testsets(zTSet);
+            db = g.pWrapper->GetHandle();
+            sqlite3_a3d_db_status(db, SQLITE_DBSTATUS_CACHE_HIT, &p.nHit, &iHi, 0);
+            sqlite3_a3d_db_status(db, SQLITE_DBSTATUS_CACHE_MISS, &p.nMiss, &iHi, 0);
+            p.iMs = g.iTotal - p.iMs;
+            p.nStatement = g.nStatement - p.nStatement;
+            aPoint.push_back(p);
+        }
+    }
+    if (g.bSqlOnly) return;
+    printf("-- Sweep of \"%s\":\n", zTSet);
+    printf("--     size  clients          ms  statements/s  cache hits  cache misses  hit ratio\n");
+    for (i = 0; i < aPoint.size(); i++) {
+        SweepPoint const& p = aPoint[i];
+        sqlite3_a3d_int64 nAccess = (sqlite3_a3d_int64)p.nHit + p.nMiss;
+        printf("-- %8d %8d %11lld %13.0f %11d %13d %9.2f%%\n",
+            p.szTest, p.nClients, p.iMs,
+            p.iMs > 0 ? p.nStatement * 1000.0 / p.iMs : 0.0,
+            p.nHit, p.nMiss, nAccess > 0 ? 100.0 * p.nHit / nAccess : 100.0);
+    }
+}
+
 int main(int argc, char** argv) {
     int doAutovac = 0;            /* True for --autovacuum */
     int cacheSize = 0;            /* Desired cache size.  0 means default */
@@ -2402,16 +3352,30 @@ int main(int argc, char** argv) {
     int nLook = -1, szLook = 0;   /* --lookaside configuration */
     int noSync = 0;               /* True for --nosync */
     int pageSize = 0;             /* Desired page size.  0 means default */
+    const char* zProfile = 0;     /* Wrapper options profile from --profile */
+    int usePoolAllocator = 0;     /* True for --allocator pool */
+    int lazyOpen = 0;             /* True for --lazy-open */
     int nPCache = 0, szPCache = 0;/* --pcache configuration */
     int doPCache = 0;             /* True if --pcache is seen */
     int showStats = 0;            /* True for --stats */
+    int showMetrics = 0;          /* True for --metrics */
+    int useCheckpointer = 0;      /* True for --checkpointer */
+    int nResultCacheMB = 0;       /* --resultcache value */
+    const char* zBackup = 0;      /* --backup destination */
+    int slowLogMs = -1;           /* --slowlog threshold, -1 if not logged */
     int nThread = 0;              /* --threads value */
     int mmapSize = 0;             /* How big of a memory map to use */
     int memDb = 0;                /* --memdb.  Use an in-memory database */
-    char* zTSet = "main";         /* Which --testset torun */
+    const char* zTSet = "main";   /* Which --testset torun */
+    int bTSet = 0;                /* True if --testset is seen */
     int doTrace = 0;              /* True for --trace */
     const char* zEncoding = 0;    /* --utf16be or --utf16le */
     const char* zDbName = 0;      /* Name of the test database */
+    const char* zCompareBase = 0; /* First file of --compare */
+    const char* zCompareNew = 0;  /* Second file of --compare */
+    int pctThreshold = 10;        /* --threshold value */
+    int mnSweepSize = 0, mxSweepSize = 0;     /* --sweep sizes, 0 if not set */
+    int mnSweepClient = 0, mxSweepClient = 0; /* --sweep-clients threads, 0 if not set */
 
     void* pHeap = 0;              /* Allocated heap space */
     void* pLook = 0;              /* Allocated lookaside space */
@@ -2430,13 +3394,54 @@ int main(int argc, char** argv) {
     g.zPK = "UNIQUE";
     g.szTest = 100;
     g.nRepeat = 1;
+    g.pctReads = 80;
+    g.eBackend = BACKEND_PREPARED;
     for (i = 1; i < argc; i++) {
         const char* z = argv[i];
         if (z[0] == '-') {
             do { z++; } while (z[0] == '-');
-            if (strcmp(z, "autovacuum") == 0) {
+            if (strcmp(z, "allocator") == 0) {
+                if (i >= argc - 1) fatal_error("missing argument on %s\n", argv[i]);
+                z = argv[++i];
+                if (strcmp(z, "pool") == 0) {
+                    usePoolAllocator = 1;
+                }
+                else if (strcmp(z, "system") == 0) {
+                    usePoolAllocator = 0;
+                }
+                else {
+                    fatal_error("unknown allocator: %s\n", z);
+                }
+            }
+            else if (strcmp(z, "autovacuum") == 0) {
                 doAutovac = 1;
             }
+            else if (strcmp(z, "backup") == 0) {
+                if (i >= argc - 1) fatal_error("missing argument on %s\n", argv[i]);
+                zBackup = argv[++i];
+            }
+            else if (strcmp(z, "backend") == 0) {
+                if (i >= argc - 1) fatal_error("missing argument on %s\n", argv[i]);
+                i++;
+                if (strcmp(argv[i], "raw") == 0) {
+                    g.eBackend = BACKEND_RAW;
+                }
+                else if (strcmp(argv[i], "wrapper") == 0) {
+                    g.eBackend = BACKEND_WRAPPER;
+                }
+                else if (strcmp(argv[i], "prepared") == 0) {
+                    g.eBackend = BACKEND_PREPARED;
+                }
+                else {
+                    fatal_error("unknown backend: %s\nChoices: raw wrapper prepared\n", argv[i]);
+                }
+            }
+            else if (strcmp(z, "compare") == 0) {
+                if (i >= argc - 2) fatal_error("missing arguments on %s\n", argv[i]);
+                zCompareBase = argv[i + 1];
+                zCompareNew = argv[i + 2];
+                i += 2;
+            }
             else if (strcmp(z, "cachesize") == 0) {
                 if (i >= argc - 1) fatal_error("missing argument on %s\n", argv[i]);
                 i++;
@@ -2445,9 +3450,21 @@ int main(int argc, char** argv) {
             else if (strcmp(z, "exclusive") == 0) {
                 doExclusive = 1;
             }
+            else if (strcmp(z, "clients") == 0) {
+                if (i >= argc - 1) fatal_error("missing argument on %s\n", argv[i]);
+                g.nClients = integerValue(argv[++i]);
+                if (!bTSet) zTSet = "clients";
+            }
+            else if (strcmp(z, "clients-pool") == 0) {
+                g.bClientsPool = 1;
+                if (!bTSet) zTSet = "clients";
+            }
             else if (strcmp(z, "checkpoint") == 0) {
                 g.doCheckpoint = 1;
             }
+            else if (strcmp(z, "checkpointer") == 0) {
+                useCheckpointer = 1;
+            }
             else if (strcmp(z, "explain") == 0) {
                 g.bSqlOnly = 1;
                 g.bExplain = 1;
@@ -2465,18 +3482,43 @@ int main(int argc, char** argv) {
                 if (i >= argc - 1) fatal_error("missing argument on %s\n", argv[i]);
                 zJMode = argv[++i];
             }
+            else if (strcmp(z, "json") == 0 || strcmp(z, "csv") == 0) {
+                if (i >= argc - 1) fatal_error("missing argument on %s\n", argv[i]);
+                if (g.pReport) fatal_error("only one of --json and --csv may be given\n");
+                g.eReport = z[0] == 'j' ? REPORT_JSON : REPORT_CSV;
+                i++;
+                if (strcmp(argv[i], "-") == 0) {
+                    g.pReport = stdout;
+                }
+                else {
+                    g.pReport = fopen(argv[i], "wb");
+                    if (g.pReport == 0) {
+                        fatal_error("cannot open \"%s\" for writing\n", argv[i]);
+                    }
+                }
+            }
             else if (strcmp(z, "key") == 0) {
                 if (i >= argc - 1) fatal_error("missing argument on %s\n", argv[i]);
                 zKey = argv[++i];
             }
+            else if (strcmp(z, "lazy-open") == 0) {
+                lazyOpen = 1;
+            }
             else if (strcmp(z, "lookaside") == 0) {
                 if (i >= argc - 2) fatal_error("missing arguments on %s\n", argv[i]);
                 nLook = integerValue(argv[i + 1]);
                 szLook = integerValue(argv[i + 2]);
                 i += 2;
             }
+            else if (strcmp(z, "metrics") == 0) {
+                showMetrics = 1;
+            }
             else if (strcmp(z, "memdb") == 0) {
                 memDb = 1;
+            }
+            else if (strcmp(z, "multirow") == 0) {
+                if (i >= argc - 1) fatal_error("missing argument on %s\n", argv[i]);
+                g.nMultiRow = integerValue(argv[++i]);
 #if SQLITE_VERSION_NUMBER>=3006000
             }
             else if (strcmp(z, "multithread") == 0) {
@@ -2495,6 +3537,14 @@ int main(int argc, char** argv) {
             else if (strcmp(z, "nosync") == 0) {
                 noSync = 1;
             }
+            else if (strcmp(z, "profile") == 0) {
+                A3D::SqliteWrapperOptions options;
+                if (i >= argc - 1) fatal_error("missing argument on %s\n", argv[i]);
+                zProfile = argv[++i];
+                if (!A3D::SqliteWrapperOptions::FromProfileName(zProfile, options)) {
+                    fatal_error("unknown profile: %s\n", zProfile);
+                }
+            }
             else if (strcmp(z, "notnull") == 0) {
                 g.zNN = "NOT NULL";
             }
@@ -2530,11 +3580,19 @@ int main(int argc, char** argv) {
             else if (strcmp(z, "primarykey") == 0) {
                 g.zPK = "PRIMARY KEY";
             }
+            else if (strcmp(z, "reads") == 0) {
+                if (i >= argc - 1) fatal_error("missing argument on %s\n", argv[i]);
+                g.pctReads = integerValue(argv[++i]);
+            }
             else if (strcmp(z, "repeat") == 0) {
                 if (i >= argc - 1) fatal_error("missing arguments on %s\n", argv[i]);
                 g.nRepeat = integerValue(argv[i + 1]);
                 i += 1;
             }
+            else if (strcmp(z, "resultcache") == 0) {
+                if (i >= argc - 1) fatal_error("missing argument on %s\n", argv[i]);
+                nResultCacheMB = integerValue(argv[++i]);
+            }
             else if (strcmp(z, "reprepare") == 0) {
                 g.bReprepare = 1;
 #if SQLITE_VERSION_NUMBER>=3006000
@@ -2556,9 +3614,25 @@ int main(int argc, char** argv) {
                 if (i >= argc - 1) fatal_error("missing argument on %s\n", argv[i]);
                 g.szTest = integerValue(argv[++i]);
             }
+            else if (strcmp(z, "slowlog") == 0) {
+                if (i >= argc - 1) fatal_error("missing argument on %s\n", argv[i]);
+                slowLogMs = integerValue(argv[++i]);
+            }
             else if (strcmp(z, "stats") == 0) {
                 showStats = 1;
             }
+            else if (strcmp(z, "sweep") == 0) {
+                if (i >= argc - 2) fatal_error("missing arguments on %s\n", argv[i]);
+                mnSweepSize = integerValue(argv[++i]);
+                mxSweepSize = integerValue(argv[++i]);
+                if (mnSweepSize <= 0 || mxSweepSize < mnSweepSize) fatal_error("--sweep needs 0 < MIN <= MAX\n");
+            }
+            else if (strcmp(z, "sweep-clients") == 0) {
+                if (i >= argc - 2) fatal_error("missing arguments on %s\n", argv[i]);
+                mnSweepClient = integerValue(argv[++i]);
+                mxSweepClient = integerValue(argv[++i]);
+                if (mnSweepClient <= 0 || mxSweepClient < mnSweepClient) fatal_error("--sweep-clients needs 0 < MIN <= MAX\n");
+            }
             else if (strcmp(z, "temp") == 0) {
                 if (i >= argc - 1) fatal_error("missing argument on %s\n", argv[i]);
                 i++;
@@ -2570,6 +3644,11 @@ int main(int argc, char** argv) {
             else if (strcmp(z, "testset") == 0) {
                 if (i >= argc - 1) fatal_error("missing argument on %s\n", argv[i]);
                 zTSet = argv[++i];
+                bTSet = 1;
+            }
+            else if (strcmp(z, "threshold") == 0) {
+                if (i >= argc - 1) fatal_error("missing argument on %s\n", argv[i]);
+                pctThreshold = integerValue(argv[++i]);
             }
             else if (strcmp(z, "trace") == 0) {
                 doTrace = 1;
@@ -2611,9 +3690,26 @@ int main(int argc, char** argv) {
                 argv[i], argv[0]);
         }
     }
+    if (zCompareBase != 0) {
+        return speedtest1_compare(zCompareBase, zCompareNew, pctThreshold);
+    }
+    if (g.bClientsPool && (memDb || zDbName == 0)) fatal_error("--clients-pool needs a database file\n");
+    if (slowLogMs >= 0 && doTrace) fatal_error("--slowlog and --trace cannot be used together\n");
     if (zDbName != 0) _unlink(zDbName);
+    if (lazyOpen) {
+        /* The connection is opened by its first use, after the configuration of SQLite below */
+        A3D::SqliteWrapperOptions options;
+        if (zProfile) A3D::SqliteWrapperOptions::FromProfileName(zProfile, options);
+        options.lazyOpen = true;
+        g.pWrapper = new A3D::SqliteWrapper(memDb ? ":memory:" : (zDbName ? zDbName : ""), options);
+    }
 #if SQLITE_VERSION_NUMBER>=3006001
     printf("--> SQLITE_VERSION_NUMBER>=3006001\n");
+    if (usePoolAllocator) {
+        if (nHeap > 0) fatal_error("--allocator pool and --heap cannot be used together\n");
+        printf("--> pool allocator\n");
+        if (!A3D::SqlitePoolAllocator::Install(rc)) fatal_error("allocator configuration failed: %d\n", rc);
+    }
     if (nHeap > 0) {
         printf("--> nHeap=(%d)\n", nHeap);
         pHeap = malloc(nHeap);
@@ -2640,9 +3736,33 @@ int main(int argc, char** argv) {
 
     /* Open the database and the input file */
     printf("--> zDbName (%s)\n", zDbName);
-    if (sqlite3_a3d_open(memDb ? ":memory:" : zDbName, &g.db)) {
+    /* Every backend uses the connection of the wrapper, so that all the options apply to it */
+    if (g.pWrapper) {
+        printf("--> lazy open%s%s%s\n", zProfile ? " (profile=" : "", zProfile ? zProfile : "", zProfile ? ")" : "");
+    }
+    else if (zProfile) {
+        /* The other options below still apply on top of the profile */
+        A3D::SqliteWrapperOptions options;
+        A3D::SqliteWrapperOptions::FromProfileName(zProfile, options);
+        printf("--> profile=(%s)\n", zProfile);
+        g.pWrapper = new A3D::SqliteWrapper(memDb ? ":memory:" : (zDbName ? zDbName : ""), options);
+    }
+    else {
+        g.pWrapper = new A3D::SqliteWrapper(memDb ? ":memory:" : (zDbName ? zDbName : ""));
+    }
+    if (!g.pWrapper->IsReady()) {
         fatal_error("Cannot open database file: %s\n", zDbName);
     }
+    g.db = g.pWrapper->GetHandle();
+    if (showMetrics) g.pWrapper->EnableMetrics(true);
+    if (g.bReprepare && g.eBackend == BACKEND_PREPARED) g.pWrapper->SetStatementCacheSize(0);
+    if (nResultCacheMB > 0) {
+        A3D::SqliteResultCacheOptions cacheOptions;
+        if (g.eBackend != BACKEND_WRAPPER) fatal_error("--resultcache needs --backend wrapper\n");
+        cacheOptions.maxBytes = (size_t)nResultCacheMB * 1024 * 1024;
+        printf("--> result cache of %d MB\n", nResultCacheMB);
+        g.bResultCache = g.pWrapper->EnableResultCache(cacheOptions);
+    }
 #if SQLITE_VERSION_NUMBER>=3006001
     printf("--> SQLITE_VERSION_NUMBER>=3006001 for the second time\n");
     if (nLook > 0 && szLook > 0) {
@@ -2654,20 +3774,25 @@ int main(int argc, char** argv) {
 #endif
 
     /* Set database connection options */
-    sqlite3_a3d_create_function(g.db, "random", 0, SQLITE_UTF8, 0, randomFunc, 0, 0);
+    g.pWrapper->CreateFunction("random", 0, 0, randomFunc, 0, 0, rc);
 #ifndef SQLITE_OMIT_DEPRECATED
     if (doTrace) sqlite3_a3d_trace(g.db, traceCallback, 0);
 #endif
+    if (slowLogMs >= 0) {
+        A3D::SqliteSlowQueryOptions slowOptions;
+        slowOptions.thresholdMs = (unsigned int)slowLogMs;
+        g.pWrapper->EnableSlowQueryLog(slowOptions);
+    }
     if (memDb > 0) {
         printf("--> memDb > 0\n");
-        speedtest1_exec("PRAGMA temp_store=memory");
+        speedtest1_pragma("temp_store", "memory");
     }
     if (mmapSize > 0) {
         printf("--> mmapSize > 0\n");
-        speedtest1_exec("PRAGMA mmap_size=%d", mmapSize);
+        speedtest1_pragma("mmap_size", "%d", mmapSize);
     }
     printf("--> threads=(%d)\n", nThread);
-    speedtest1_exec("PRAGMA threads=%d", nThread);
+    speedtest1_pragma("threads", "%d", nThread);
     if (zKey) {
         printf("--> zKey=(%s)\n", zKey);
         speedtest1_exec("PRAGMA key('%s')", zKey);
@@ -2690,93 +3815,108 @@ int main(int argc, char** argv) {
     }
     if (cacheSize) {
         printf("--> cache_size=(%d)\n", cacheSize);
-        speedtest1_exec("PRAGMA cache_size=%d", cacheSize);
+        speedtest1_pragma("cache_size", "%d", cacheSize);
     }
     if (noSync) {
         printf("--> synchronous=OFF\n");
-        speedtest1_exec("PRAGMA synchronous=OFF");
+        speedtest1_pragma("synchronous", "OFF");
     }
     if (doExclusive) {
         printf("--> locking_mode=EXCLUSIVE\n");
-        speedtest1_exec("PRAGMA locking_mode=EXCLUSIVE");
+        speedtest1_pragma("locking_mode", "EXCLUSIVE");
     }
     if (zJMode) {
         printf("--> journal_mode=(%s)\n", zJMode);
-        speedtest1_exec("PRAGMA journal_mode=%s", zJMode);
+        speedtest1_pragma("journal_mode", "%s", zJMode);
     }
-
-    if (g.bExplain) printf(".explain\n.echo on\n");
-    do {
-        char* zThisTest = zTSet;
-        char* zComma = strchr(zThisTest, ',');
-        if (zComma) {
-            *zComma = 0;
-            zTSet = zComma + 1;
+    if (useCheckpointer) {
+        if (g.pWrapper->StartCheckpointer()) {
+            printf("--> background checkpointer\n");
         }
         else {
-            zTSet = "";
-        }
-        if (g.iTotal > 0 || zComma != 0) {
-            printf("       Begin testset \"%s\"\n", zThisTest);
-        }
-        if (strcmp(zThisTest, "main") == 0) {
-            testset_main();
-        }
-        else if (strcmp(zThisTest, "debug1") == 0) {
-            testset_debug1();
-        }
-        else if (strcmp(zThisTest, "orm") == 0) {
-            testset_orm();
-        }
-        else if (strcmp(zThisTest, "cte") == 0) {
-            testset_cte();
+            printf("--> no background checkpointer: the database must be a WAL file\n");
         }
-        else if (strcmp(zThisTest, "fp") == 0) {
-            testset_fp();
-        }
-        else if (strcmp(zThisTest, "trigger") == 0) {
-            testset_trigger();
+    }
+    if (lazyOpen) {
+        /* The statement of speedtest1_reset_database() is prepared before it is needed */
+        sqlite3_a3d_int64 iStart = speedtest1_timestamp();
+        std::future<bool> warmup;
+        g.pWrapper->SetHotStatements({ "SELECT name FROM main.sqlite_master WHERE sql LIKE 'CREATE %TABLE%'" });
+        warmup = g.pWrapper->Warmup();
+        if (!warmup.get()) fatal_error("warm-up error: %s\n", g.pWrapper->LastErrorMessage().c_str());
+        printf("--> warmup (%lld ms)\n", speedtest1_timestamp() - iStart);
+    }
+
+    if (g.bExplain) printf(".explain\n.echo on\n");
+    if (mnSweepSize > 0 || mnSweepClient > 0) {
+        speedtest1_sweep(zTSet, mnSweepSize, mxSweepSize, mnSweepClient, mxSweepClient);
+    }
+    else {
+        speedtest1_testsets(zTSet);
+    }
+    speedtest1_final();
+
+    if (slowLogMs >= 0) {
+        std::vector<A3D::SqliteSlowQuery> aSlow = g.pWrapper->GetSlowQueries();
+        A3D::SqliteSlowQueryStats slowStats = g.pWrapper->GetSlowQueryStats();
+        printf("-- %llu statement(s) of %d ms or more, last %d:\n",
+            (unsigned long long)slowStats.slowQueries, slowLogMs, (int)aSlow.size());
+        for (i = 0; i < (int)aSlow.size(); i++) {
+            A3D::SqliteSlowQuery const& q = aSlow[i];
+            printf("-- %10.3fms %8llu runs %10llu steps %8llu scans %llu sorts %llu autoindexes: %.100s\n",
+                q.durationNs / 1e6, (unsigned long long)q.runs, (unsigned long long)q.vmSteps,
+                (unsigned long long)q.fullscanSteps, (unsigned long long)q.sorts,
+                (unsigned long long)q.autoindexes, q.statementText.c_str());
+            if (!q.plan.empty()) printf("%s", q.plan.c_str());
         }
-        else if (strcmp(zThisTest, "rtree") == 0) {
-#ifdef SQLITE_ENABLE_RTREE
-            testset_rtree(6, 147);
-#else
-            fatal_error("compile with -DSQLITE_ENABLE_RTREE to enable "
-                "the R-Tree tests\n");
-#endif
+    }
+
+    if (zBackup) {
+        A3D::SqliteBackupProgress progress;
+        if (!g.pWrapper->Backup(zBackup, rc, A3D::SqliteBackupOptions(), A3D::SqliteBackupCallback(), &progress)) {
+            fatal_error("backup to %s failed: %d\n", zBackup, rc);
         }
-        else {
-            fatal_error("unknown testset: \"%s\"\n"
-                "Choices: cte debug1 fp main orm rtree trigger\n",
-                zThisTest);
+        printf("-- Backup: %d pages in %d steps, %.3fs, %.1f MB/s, %d restart(s)\n",
+            progress.totalPages, progress.steps, progress.elapsedMs / 1000.0,
+            progress.bytesPerSecond / (1024 * 1024), progress.restarts);
+    }
+
+    if (showMetrics) {
+        A3D::SqliteMetricsSnapshot metrics = g.pWrapper->GetMetrics();
+        printf("-- Wrapper lock waits:          %llu (%.3fms)\n",
+            (unsigned long long)metrics.lockWaits, metrics.lockWaitNs / 1e6);
+        printf("-- Wrapper BUSY retries:        %llu\n", (unsigned long long)metrics.busyRetries);
+        printf("-- Wrapper reconnections:       %llu\n", (unsigned long long)metrics.reconnects);
+        if (metrics.checkpoints) {
+            printf("-- Wrapper checkpoints:         %llu (%.3fms, p99 %.3fms, max %.3fms) %llu frames\n",
+                (unsigned long long)metrics.checkpoints, metrics.checkpointNs / 1e6,
+                metrics.checkpointP99Ns / 1e6, metrics.checkpointMaxNs / 1e6,
+                (unsigned long long)metrics.checkpointedFrames);
+            printf("-- Wrapper WAL backpressure:    %llu (%.3fms)\n",
+                (unsigned long long)metrics.backpressureWaits, metrics.backpressureWaitNs / 1e6);
         }
-        if (zTSet[0]) {
-            char* zSql, * zObj;
-            speedtest1_begin_test(999, "Reset the database");
-            while (1) {
-                zObj = speedtest1_once(
-                    "SELECT name FROM main.sqlite_master"
-                    " WHERE sql LIKE 'CREATE %%TABLE%%'");
-                if (zObj == 0) break;
-                zSql = sqlite3_a3d_mprintf("DROP TABLE main.\"%w\"", zObj);
-                speedtest1_exec(zSql);
-                sqlite3_a3d_free(zSql);
-                sqlite3_a3d_free(zObj);
-            }
-            while (1) {
-                zObj = speedtest1_once(
-                    "SELECT name FROM temp.sqlite_master"
-                    " WHERE sql LIKE 'CREATE %%TABLE%%'");
-                if (zObj == 0) break;
-                zSql = sqlite3_a3d_mprintf("DROP TABLE main.\"%w\"", zObj);
-                speedtest1_exec(zSql);
-                sqlite3_a3d_free(zSql);
-                sqlite3_a3d_free(zObj);
-            }
-            speedtest1_end_test();
+        /* Statements are sorted by total time, only show the most expensive */
+        for (i = 0; i < (int)metrics.statements.size() && i < 20; i++) {
+            A3D::SqliteStatementMetrics const& m = metrics.statements[i];
+            printf("-- %8llu calls %10.3fms p50 %8.3fms p99 %8.3fms p999 %8.3fms"
+                " lock %8.3fms %8llu rows %llu errors: %.60s\n",
+                (unsigned long long)m.calls, m.totalNs / 1e6, m.p50Ns / 1e6,
+                m.p99Ns / 1e6, m.p999Ns / 1e6, m.lockWaitNs / 1e6,
+                (unsigned long long)m.rows, (unsigned long long)m.errors,
+                m.statementText.c_str());
         }
-    } while (zTSet[0]);
-    speedtest1_final();
+    }
+
+    if (g.bResultCache && (showStats || showMetrics)) {
+        A3D::SqliteResultCacheStats cache = g.pWrapper->GetResultCacheStats();
+        printf("-- Result cache hits/misses:    %llu/%llu (%llu uncacheable)\n",
+            (unsigned long long)cache.hits, (unsigned long long)cache.misses,
+            (unsigned long long)cache.uncacheable);
+        printf("-- Result cache invalidations:  %llu (%llu evictions)\n",
+            (unsigned long long)cache.invalidations, (unsigned long long)cache.evictions);
+        printf("-- Result cache entries:        %llu (%llu bytes)\n",
+            (unsigned long long)cache.entries, (unsigned long long)cache.bytes);
+    }
 
     if (showStats) {
         sqlite3_a3d_exec(g.db, "PRAGMA compile_options", xCompileOptions, 0, 0);
@@ -2811,7 +3951,8 @@ int main(int argc, char** argv) {
     }
 #endif
 
-    sqlite3_a3d_close(g.db);
+    delete g.pWrapper;
+    g.db = 0;
 
 #if SQLITE_VERSION_NUMBER>=3006001
     /* Global memory usage statistics printed after the database connection
@@ -2832,6 +3973,18 @@ int main(int argc, char** argv) {
     }
 #endif
 
+    if (usePoolAllocator && (showStats || showMetrics)) {
+        A3D::SqlitePoolAllocatorStats pool = A3D::SqlitePoolAllocator::GetStats();
+        printf("-- Pool allocations:            %llu (%llu frees)\n",
+            (unsigned long long)pool.mallocs, (unsigned long long)pool.frees);
+        printf("-- Pool thread cache hits:      %llu\n", (unsigned long long)pool.threadCacheHits);
+        printf("-- Pool shared pool hits:       %llu\n", (unsigned long long)pool.sharedPoolHits);
+        printf("-- Pool system/large mallocs:   %llu/%llu\n",
+            (unsigned long long)pool.systemMallocs, (unsigned long long)pool.largeMallocs);
+        printf("-- Pool bytes used/cached:      %lld/%llu\n",
+            (long long)pool.bytesInUse, (unsigned long long)pool.bytesCached);
+    }
+
 #ifdef __linux__
     if (showStats) {
         displayLinuxIoStats(stdout);